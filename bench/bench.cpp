@@ -0,0 +1,662 @@
+/*
+ *  Microbenchmark suite (ai_water_sort_bench target):
+ *
+ *      Reproducible measurements of the solver's hot paths, from Bottle
+ *      primitives up to end-to-end solves of a fixed, seeded corpus.
+ *      Every input is derived from BENCH_SEED, so numbers are comparable
+ *      across builds and machines.
+ *
+ *      Each benchmark is calibrated to run for at least --min-time ms per
+ *      repetition and is repeated --repetitions times; the median and the
+ *      minimum time per operation are reported. Results are printed as a
+ *      table and, with --json FILE, written as machine-readable JSON.
+ *
+ *      A hash quality report compares State::hashValue() with the former
+ *      State::legacyHashValue() on the states met by real searches: exact
+ *      64-bit collisions, and the chains formed in tables indexed by the
+ *      hash modulo a prime (as std::unordered_set does) or masked to a power
+ *      of two (as open addressing tables do).
+ *
+ *  Usage:
+ *      ai_water_sort_bench [--filter TEXT] [--json FILE] [--repetitions R] [--min-time MS]
+ */
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "BFS.h"
+#include "State.h"
+#include "Bottle.h"
+#include "StateKey.h"
+#include "ClosedSet.h"
+#include "CompactStateSet.h"
+#include "StateRanker.h"
+#include "DenseBFS.h"
+#include "MemoryPool.h"
+#include "AnytimeSearch.h"
+
+constexpr unsigned int BENCH_SEED = 20240601;
+
+
+// Prevents the compiler from discarding a computed value.
+template <typename T>
+inline void doNotOptimize(const T& value)
+{
+#if defined(__GNUC__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+
+struct BenchResult
+{
+    std::string name;
+    std::string unit;               // Unit of a single operation.
+    uint64_t iterations;            // Operations per repetition.
+    double medianNs;                // Median time per operation.
+    double minNs;                   // Best time per operation.
+};
+
+struct BenchConfig
+{
+    std::string filter;
+    std::string jsonPath;
+    size_t repetitions = 5;
+    double minTimeMs = 100;
+};
+
+class BenchSuite
+{
+private:
+    BenchConfig m_config;
+
+    std::vector<BenchResult> m_results;
+
+public:
+    explicit BenchSuite(const BenchConfig& config) : m_config(config) {}
+
+    // `body(n)` must perform n operations; `fixedIterations` disables calibration.
+    void run(const std::string& name, const std::string& unit, const std::function<void(uint64_t)>& body, uint64_t fixedIterations = 0)
+    {
+        std::vector<double> samples;
+
+        uint64_t n = (fixedIterations != 0 ? fixedIterations : 1);
+        double ms;
+
+        if (!m_config.filter.empty() && name.find(m_config.filter) == std::string::npos) {
+            return;
+        }
+
+        // Calibration: grow the iteration count until a repetition lasts long enough.
+        while (fixedIterations == 0)
+        {
+            auto t0 = std::chrono::steady_clock::now();
+            body(n);
+            ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+            if (ms >= m_config.minTimeMs || n >= (1ULL << 40)) {
+                break;
+            }
+            n = (ms < 1) ? n * 10 : static_cast<uint64_t>(n * (m_config.minTimeMs * 1.2 / ms)) + 1;
+        }
+
+        for (size_t r = 0; r < m_config.repetitions; ++r)
+        {
+            auto t0 = std::chrono::steady_clock::now();
+            body(n);
+            samples.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / n);
+        }
+        std::sort(samples.begin(), samples.end());
+
+        m_results.push_back({ name, unit, n, samples[samples.size() / 2], samples.front() });
+
+        std::cout << std::left << std::setw(50) << name << std::right
+            << std::setw(16) << std::fixed << std::setprecision(2) << m_results.back().medianNs << " ns/" << std::left << std::setw(8) << unit
+            << std::right << std::setw(14) << std::setprecision(2) << m_results.back().minNs << " ns (min)"
+            << std::setw(14) << n << " ops" << std::endl;
+    }
+
+    bool writeJson() const
+    {
+        if (m_config.jsonPath.empty()) {
+            return true;
+        }
+        std::ofstream ofs(m_config.jsonPath, std::ios::out);
+
+        if (!ofs.is_open()) {
+            return false;
+        }
+        ofs << "{\n  \"seed\": " << BENCH_SEED << ",\n  \"repetitions\": " << m_config.repetitions << ",\n  \"benchmarks\": [\n";
+
+        for (size_t i = 0; i < m_results.size(); ++i)
+        {
+            ofs << "    {\"name\": \"" << m_results[i].name << "\", \"unit\": \"" << m_results[i].unit
+                << "\", \"iterations\": " << m_results[i].iterations
+                << ", \"median_ns\": " << std::fixed << std::setprecision(3) << m_results[i].medianNs
+                << ", \"min_ns\": " << m_results[i].minNs << "}" << (i + 1 < m_results.size() ? "," : "") << '\n';
+        }
+        ofs << "  ]\n}\n";
+
+        return ofs.good();
+    }
+};
+
+// Seeded random puzzles of `size` bottles.
+template <size_t size>
+std::vector<State<size>> makeCorpus(size_t count, unsigned int seed)
+{
+    std::vector<State<size>> corpus(count);
+    std::mt19937 generator(seed);
+
+    for (State<size>& s : corpus) {
+        s.init(generator);
+    }
+    return corpus;
+}
+
+// States met by a breadth-first sweep from the corpus' puzzles (non-goal, distinct).
+template <size_t size>
+std::vector<State<size>> reachableStates(const std::vector<State<size>>& roots, size_t limit)
+{
+    std::unordered_set<State<size>*, std::hash<State<size>*>, EqualContents<State<size>>> seen;
+    std::vector<State<size>*> queue;
+    std::vector<State<size>*> children;
+    std::vector<State<size>> result;
+
+    for (const State<size>& r : roots)
+    {
+        queue.push_back(new State<size>(r));
+        seen.insert(queue.back());
+    }
+    for (size_t head = 0; head < queue.size() && result.size() < limit; ++head)
+    {
+        result.push_back(*queue[head]);
+        result.back().setPrevious(nullptr);
+
+        queue[head]->expand(children);
+
+        for (State<size>* c : children)
+        {
+            if (seen.insert(c).second) {
+                queue.push_back(c);
+            }
+            else delete c;
+        }
+    }
+    for (State<size>* s : queue) {
+        delete s;
+    }
+    return result;
+}
+
+template <size_t size>
+void stateBenchmarks(BenchSuite& suite, size_t closedSetSize)
+{
+    const std::string tag = "<" + std::to_string(size) + ">";
+
+    std::vector<State<size>> states = reachableStates<size>(makeCorpus<size>(8, BENCH_SEED + size), closedSetSize * 2);
+    std::vector<State<size>*> children;
+
+    suite.run("State" + tag + "::hashValue", "state", [&](uint64_t n)
+    {
+        hash_t h = 0;
+
+        for (uint64_t i = 0; i < n; ++i) {
+            h ^= states[i % states.size()].hashValue();
+        }
+        doNotOptimize(h);
+    });
+
+    suite.run("State" + tag + "::legacyHashValue", "state", [&](uint64_t n)
+    {
+        hash_t h = 0;
+
+        for (uint64_t i = 0; i < n; ++i) {
+            h ^= states[i % states.size()].legacyHashValue();
+        }
+        doNotOptimize(h);
+    });
+
+    std::vector<StateKey<size>> keys;
+
+    for (const State<size>& s : states) {
+        keys.push_back(s.key());
+    }
+
+    suite.run("StateKey" + tag + "::operator==", "pair", [&](uint64_t n)
+    {
+        size_t equal = 0;
+
+        for (uint64_t i = 0; i < n; ++i) {
+            equal += (keys[i % keys.size()] == keys[(i + 1) % keys.size()]);
+        }
+        doNotOptimize(equal);
+    });
+
+    suite.run("State" + tag + "::operator==", "pair", [&](uint64_t n)
+    {
+        size_t equal = 0;
+
+        for (uint64_t i = 0; i < n; ++i) {
+            equal += (states[i % states.size()] == states[(i + 1) % states.size()]);
+        }
+        doNotOptimize(equal);
+    });
+
+    suite.run("State" + tag + "::expand (incl. delete)", "state", [&](uint64_t n)
+    {
+        for (uint64_t i = 0; i < n; ++i)
+        {
+            states[i % states.size()].expand(children);
+
+            for (State<size>* c : children) {
+                delete c;
+            }
+        }
+    });
+
+    suite.run("State" + tag + "::heuristic", "state", [&](uint64_t n)
+    {
+        int h = 0;
+
+        for (uint64_t i = 0; i < n; ++i) {
+            h += states[i % states.size()].heuristic();
+        }
+        doNotOptimize(h);
+    });
+
+    // Closed set probes: half of the states are members, the other half are not.
+    constexpr size_t BATCH = 16;
+
+    ClosedSet<size> closed(states.size(), false);
+
+    std::vector<uint64_t> hashes(BATCH);
+
+    size_t members = states.size() / 2;
+
+    for (size_t i = 0; i < members; ++i) {
+        closed.insert(&states[i], closed.hash(&states[i]));
+    }
+
+    suite.run("ClosedSet" + tag + "::contains (hit)", "probe", [&](uint64_t n)
+    {
+        size_t found = 0;
+        const State<size>* s;
+
+        for (uint64_t i = 0; i < n; ++i)
+        {
+            s = &states[(i * 7919) % members];
+            found += closed.contains(s, closed.hash(s));
+        }
+        doNotOptimize(found);
+    });
+
+    suite.run("ClosedSet" + tag + "::contains (miss)", "probe", [&](uint64_t n)
+    {
+        size_t found = 0;
+        const State<size>* s;
+
+        for (uint64_t i = 0; i < n; ++i)
+        {
+            s = &states[members + (i * 7919) % (states.size() - members)];
+            found += closed.contains(s, closed.hash(s));
+        }
+        doNotOptimize(found);
+    });
+
+    // As BFS() probes children: a batch is hashed and prefetched before any lookup.
+    suite.run("ClosedSet" + tag + "::contains (batches of " + std::to_string(BATCH) + ")", "probe", [&](uint64_t n)
+    {
+        size_t found = 0;
+        size_t j;
+
+        for (uint64_t i = 0; i < n; i += BATCH)
+        {
+            for (j = 0; j < BATCH; ++j)
+            {
+                hashes[j] = closed.hash(&states[((i + j) * 7919) % states.size()]);
+                closed.prefetch(hashes[j]);
+            }
+            for (j = 0; j < BATCH; ++j) {
+                found += closed.contains(&states[((i + j) * 7919) % states.size()], hashes[j]);
+            }
+        }
+        doNotOptimize(found);
+    });
+
+    // The same probes against the compressed set of the compact engine.
+    std::vector<std::vector<uint8_t>> sorted;
+
+    typename CompactStateSet<size>::Builder builder;
+    CompactStateSet<size> compact;
+
+    for (size_t i = 0; i < members; ++i) {
+        sorted.emplace_back(reinterpret_cast<uint8_t*>(states[i].getBottles()),
+            reinterpret_cast<uint8_t*>(states[i].getBottles()) + CompactStateSet<size>::KEY_BYTES);
+    }
+    std::sort(sorted.begin(), sorted.end());
+
+    for (const std::vector<uint8_t>& k : sorted) {
+        builder.append(k.data(), 0);
+    }
+    builder.finish(compact);
+
+    suite.run("CompactStateSet" + tag + "::find (hit, " + std::to_string(compact.bytes() / (double)members).substr(0, 4) + " B/state)", "probe", [&](uint64_t n)
+    {
+        size_t found = 0;
+
+        for (uint64_t i = 0; i < n; ++i) {
+            found += compact.contains(reinterpret_cast<uint8_t*>(states[(i * 7919) % members].getBottles()));
+        }
+        doNotOptimize(found);
+    });
+
+    suite.run("CompactStateSet" + tag + "::find (miss)", "probe", [&](uint64_t n)
+    {
+        size_t found = 0;
+
+        for (uint64_t i = 0; i < n; ++i) {
+            found += compact.contains(reinterpret_cast<uint8_t*>(states[members + (i * 7919) % (states.size() - members)].getBottles()));
+        }
+        doNotOptimize(found);
+    });
+}
+
+struct ChainStats
+{
+    double meanChain;       // Mean number of keys sharing a key's bucket (itself included).
+    size_t maxChain;
+};
+
+static ChainStats chainStats(const std::vector<uint64_t>& hashes, uint64_t buckets, bool mask)
+{
+    std::unordered_map<uint64_t, size_t> occupancy;
+
+    ChainStats stats { 0, 0 };
+
+    for (uint64_t h : hashes) {
+        occupancy[mask ? (h & (buckets - 1)) : (h % buckets)] += 1;
+    }
+    for (const auto& b : occupancy)
+    {
+        stats.meanChain += static_cast<double>(b.second) * b.second;
+        stats.maxChain = std::max(stats.maxChain, b.second);
+    }
+    stats.meanChain /= hashes.size();
+
+    return stats;
+}
+
+// Compares the hash functions on distinct states reached by BFS sweeps of the corpus.
+template <size_t size>
+void hashQualityReport(size_t count)
+{
+    std::vector<State<size>> states = reachableStates<size>(makeCorpus<size>(8, BENCH_SEED + size), count);
+
+    std::vector<uint64_t> hashes[2];
+
+    uint64_t primeBuckets;
+    uint64_t maskBuckets = 1;
+
+    const char* names[2] = { "legacyHashValue", "hashValue" };
+
+    for (const State<size>& s : states)
+    {
+        hashes[0].push_back(s.legacyHashValue());
+        hashes[1].push_back(s.hashValue());
+    }
+    while (maskBuckets < states.size()) {
+        maskBuckets *= 2;
+    }
+
+    // Bucket count std::unordered_set settles on for this many keys.
+    std::unordered_set<uint64_t> reference(hashes[1].begin(), hashes[1].end());
+    primeBuckets = reference.bucket_count();
+
+    std::cout << "\n> Hash quality of State<" << size << "> on " << states.size() << " distinct states\n"
+        << std::left << std::setw(18) << "  function" << std::right
+        << std::setw(12) << "collisions" << std::setw(20) << "prime mean/max" << std::setw(20) << "pow2 mean/max" << '\n';
+
+    for (int f = 0; f < 2; ++f)
+    {
+        std::unordered_set<uint64_t> distinct(hashes[f].begin(), hashes[f].end());
+
+        ChainStats prime = chainStats(hashes[f], primeBuckets, false);
+        ChainStats pow2 = chainStats(hashes[f], maskBuckets, true);
+
+        std::cout << "  " << std::left << std::setw(16) << names[f] << std::right
+            << std::setw(12) << states.size() - distinct.size()
+            << std::setw(14) << std::fixed << std::setprecision(3) << prime.meanChain << " / " << std::setw(3) << prime.maxChain
+            << std::setw(14) << pow2.meanChain << " / " << std::setw(3) << pow2.maxChain << '\n';
+    }
+    std::cout << "  (" << primeBuckets << " prime buckets, " << maskBuckets << " power-of-two buckets)" << std::endl;
+}
+
+void bottleBenchmarks(BenchSuite& suite)
+{
+    std::vector<State<8>> states = reachableStates<8>(makeCorpus<8>(8, BENCH_SEED), 4096);
+    std::vector<std::pair<Bottle, Bottle>> pairs;
+
+    for (State<8>& s : states) {
+        for (int i = 0; i < 8; ++i) {
+            for (int j = 0; j < 8; ++j) {
+                if (i != j) {
+                    pairs.push_back({ s.getBottles()[i], s.getBottles()[j] });
+                }
+            }
+        }
+    }
+
+    suite.run("Bottle::shouldPourTo", "pair", [&](uint64_t n)
+    {
+        size_t allowed = 0;
+
+        for (uint64_t i = 0; i < n; ++i) {
+            allowed += pairs[i % pairs.size()].first.shouldPourTo(pairs[i % pairs.size()].second);
+        }
+        doNotOptimize(allowed);
+    });
+
+    // Only legal pours are timed, as in State::expand().
+    std::vector<std::pair<Bottle, Bottle>> legal;
+
+    for (const auto& p : pairs) {
+        if (p.first.shouldPourTo(p.second)) {
+            legal.push_back(p);
+        }
+    }
+
+    suite.run("Bottle::pour", "pour", [&](uint64_t n)
+    {
+        Bottle from;
+        Bottle to;
+        color_t c = 0;
+
+        for (uint64_t i = 0; i < n; ++i)
+        {
+            from = legal[i % legal.size()].first;
+            to = legal[i % legal.size()].second;
+            c ^= from.pour(to);
+        }
+        doNotOptimize(c);
+    });
+}
+
+void poolBenchmarks(BenchSuite& suite)
+{
+    constexpr size_t BATCH = 4096;
+
+    MemoryPool pool(sizeof(State<8>), 64 * 1024 * 1024);
+    std::vector<void*> blocks(BATCH);
+
+    suite.run("MemoryPool::allocate+deallocate (batch 4096)", "unit", [&](uint64_t n)
+    {
+        for (uint64_t done = 0; done < n; done += BATCH)
+        {
+            for (size_t i = 0; i < BATCH; ++i) {
+                blocks[i] = pool.allocate();
+            }
+            for (size_t i = 0; i < BATCH; ++i) {
+                pool.deallocate(blocks[i]);
+            }
+        }
+    });
+}
+
+// BFS is skipped for sizes it cannot solve at benchmark latency.
+template <size_t size>
+void solverBenchmarks(BenchSuite& suite, size_t count, bool withBFS)
+{
+    const std::string tag = "<" + std::to_string(size) + ">";
+
+    std::vector<State<size>> corpus = makeCorpus<size>(count, BENCH_SEED);
+
+    uint64_t examined;
+    uint64_t memory;
+    bool optimal;
+
+    if (withBFS)
+    {
+        suite.run("BFS" + tag + " (seeded corpus)", "puzzle", [&](uint64_t n)
+        {
+            for (uint64_t i = 0; i < n; ++i) {
+                State<size>::deleteWholePath(BFS(corpus[i % corpus.size()], examined, memory));
+            }
+        }, corpus.size());
+    }
+
+    // A zero deadline stops the search at its first solution, a fixed amount
+    // of work, rather than at a wall-clock budget every run would hit.
+    AnytimeOptions options;
+
+    options.deadlineMs = 0;
+
+    suite.run("AnytimeBeamSearch" + tag + " (seeded corpus, first solution)", "puzzle", [&](uint64_t n)
+    {
+        for (uint64_t i = 0; i < n; ++i) {
+            State<size>::deleteWholePath(anytimeBeamSearch<size>(corpus[i % corpus.size()], options, examined, memory, optimal));
+        }
+    }, corpus.size());
+}
+
+// Ranking of the small puzzles the dense engine handles, and the dense engine against BFS.
+template <size_t size>
+void denseBenchmarks(BenchSuite& suite, size_t count)
+{
+    const std::string tag = "<" + std::to_string(size) + ">";
+
+    std::vector<State<size>> corpus = makeCorpus<size>(count, BENCH_SEED);
+    std::vector<State<size>> states = reachableStates<size>({ corpus[0] }, 100000);   // Same liquid as the ranker's.
+
+    StateRanker<size> ranker(corpus[0].getBottles());
+
+    Bottle bottles[size];
+
+    uint64_t examined;
+    uint64_t memory;
+    uint64_t tableBytes;
+    bool ranked;
+
+    suite.run("StateRanker" + tag + "::rank", "state", [&](uint64_t n)
+    {
+        uint64_t sum = 0;
+
+        for (uint64_t i = 0; i < n; ++i) {
+            sum += ranker.rank(states[i % states.size()].getBottles());
+        }
+        doNotOptimize(sum);
+    });
+
+    suite.run("StateRanker" + tag + "::unrank", "state", [&](uint64_t n)
+    {
+        for (uint64_t i = 0; i < n; ++i)
+        {
+            ranker.unrank((i * 2654435761ULL) % ranker.states(), bottles);
+            doNotOptimize(bottles[0]);
+        }
+    });
+
+    suite.run("BFS" + tag + " (seeded corpus)", "puzzle", [&](uint64_t n)
+    {
+        for (uint64_t i = 0; i < n; ++i) {
+            State<size>::deleteWholePath(BFS(corpus[i % corpus.size()], examined, memory));
+        }
+    }, corpus.size());
+
+    suite.run("DenseBFS" + tag + " (seeded corpus)", "puzzle", [&](uint64_t n)
+    {
+        for (uint64_t i = 0; i < n; ++i) {
+            State<size>::deleteWholePath(denseBFS(corpus[i % corpus.size()], examined, memory, tableBytes, ranked));
+        }
+    }, corpus.size());
+}
+
+int main(int argc, char* argv[])
+{
+    BenchConfig config;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "--filter") && i + 1 < argc) {
+            config.filter = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--json") && i + 1 < argc) {
+            config.jsonPath = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--repetitions") && i + 1 < argc) {
+            config.repetitions = std::max<size_t>(1, std::strtoull(argv[++i], nullptr, 10));
+        }
+        else if (!strcmp(argv[i], "--min-time") && i + 1 < argc) {
+            config.minTimeMs = std::strtod(argv[++i], nullptr);
+        }
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--filter TEXT] [--json FILE] [--repetitions R] [--min-time MS]\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    BenchSuite suite(config);
+
+    bottleBenchmarks(suite);
+
+    stateBenchmarks<8>(suite, 200000);
+    stateBenchmarks<12>(suite, 200000);
+
+    poolBenchmarks(suite);
+
+    denseBenchmarks<5>(suite, 10);
+
+    solverBenchmarks<6>(suite, 20, true);
+    solverBenchmarks<7>(suite, 5, true);
+
+    // Only when the build supports puzzles that large (see: dispatch.h).
+    if constexpr (MAX_BOTTLES >= 14) {
+        solverBenchmarks<14>(suite, 5, false);
+    }
+
+    if (config.filter.empty() || std::string("hash quality").find(config.filter) != std::string::npos)
+    {
+        hashQualityReport<8>(200000);
+        hashQualityReport<12>(200000);
+    }
+
+    if (!suite.writeJson())
+    {
+        std::cerr << "Could not write \"" << config.jsonPath << "\"" << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
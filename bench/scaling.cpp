@@ -0,0 +1,370 @@
+/*
+ *  Scaling study harness (ai_water_sort_scaling target):
+ *
+ *      Solves `--samples` seeded random puzzles for every bottle count in
+ *      [--min, --max] with BFS and records, per run: solution depth, examined
+ *      nodes, peak stored nodes, peak pool bytes, peak resident set size,
+ *      wall time and effective branching factor b*, the branching factor of
+ *      a uniform tree of the solution's depth with as many expanded nodes:
+ *
+ *          1 + b* + b*^2 + ... + b*^depth = examined + 1
+ *
+ *      On POSIX systems every run happens in a forked child, so its peak RSS
+ *      is measured in isolation (wait4) and it can be stopped by --timeout.
+ *      Elsewhere runs share the process and peak RSS is cumulative.
+ *
+ *      Two CSV files are written:
+ *      ->  PREFIX_runs.csv:  one row per run.
+ *      ->  PREFIX_fit.csv:   for each metric, an exponential model y = a * e^(b * N)
+ *                            fitted by least squares on log(y), with its R^2,
+ *                            growth per added bottle and the predictions for
+ *                            every N up to MAX_BOTTLES, for capacity planning.
+ *
+ *  Usage:
+ *      ai_water_sort_scaling [--min N] [--max N] [--samples K] [--seed S] [--timeout SEC] [--output PREFIX]
+ */
+
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+#if defined(_WIN32)
+#   include <windows.h>
+#   include <psapi.h>
+#else
+#   include <unistd.h>
+#   include <signal.h>
+#   include <sys/wait.h>
+#   include <sys/resource.h>
+#endif
+
+#include "State.h"
+#include "Solver.h"
+#include "dispatch.h"
+
+
+struct RunRecord
+{
+    int bottles;
+    int sample;
+    int status;                 // 0: solved, 1: unsolved, 2: timeout or crash.
+    int depth;
+    uint64_t examined;
+    uint64_t peakNodes;
+    uint64_t peakPoolBytes;
+    uint64_t peakRssKb;
+    double wallMs;
+    double branching;
+};
+
+// Random puzzle of `size` bottles drawn from the generator.
+template <size_t size>
+struct RandomPuzzle
+{
+    static int run(std::mt19937& generator, std::vector<Bottle>& bottles)
+    {
+        State<size> s;
+
+        s.init(generator);
+        bottles.assign(s.getBottles(), s.getBottles() + size);
+
+        return 0;
+    }
+};
+
+// Solves 1 + b + ... + b^depth = nodes for b by bisection.
+double effectiveBranchingFactor(uint64_t nodes, int depth)
+{
+    double lo = 1.0;
+    double hi = std::max(2.0, static_cast<double>(nodes));
+    double mid;
+    double sum;
+    double term;
+
+    if (depth <= 0 || nodes <= static_cast<uint64_t>(depth) + 1) {
+        return 1.0;
+    }
+    for (int it = 0; it < 200; ++it)
+    {
+        mid = (lo + hi) / 2;
+        sum = 0;
+        term = 1;
+
+        for (int i = 0; i <= depth && sum <= nodes; ++i, term *= mid) {
+            sum += term;
+        }
+        (sum > nodes ? hi : lo) = mid;
+    }
+    return (lo + hi) / 2;
+}
+
+uint64_t currentPeakRssKb()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return counters.PeakWorkingSetSize / 1024;
+    }
+    return 0;
+#else
+    struct rusage usage {};
+
+    getrusage(RUSAGE_SELF, &usage);
+
+    return static_cast<uint64_t>(usage.ru_maxrss);
+#endif
+}
+
+void solveRun(const std::vector<Bottle>& puzzle, RunRecord& record)
+{
+    SolveResult result;
+
+    solvePuzzle(puzzle.data(), puzzle.size(), SolverOptions(), result);
+
+    record.status = result.solved ? 0 : 1;
+    record.depth = result.depth;
+    record.examined = result.examined;
+    record.peakNodes = result.memory;
+    record.peakPoolBytes = result.peakBytes;
+    record.wallMs = result.elapsedMs;
+    record.branching = effectiveBranchingFactor(result.examined + 1, result.depth);
+    record.peakRssKb = currentPeakRssKb();
+}
+
+#if !defined(_WIN32)
+// Runs solveRun() in a child process, for an isolated peak RSS and a hard time limit.
+void isolatedRun(const std::vector<Bottle>& puzzle, unsigned int timeoutSec, RunRecord& record)
+{
+    struct rusage usage {};
+
+    int fds[2];
+    int status = 0;
+    pid_t pid;
+
+    record.status = 2;
+
+    if (pipe(fds) != 0 || (pid = fork()) < 0)
+    {
+        solveRun(puzzle, record);
+        return;
+    }
+    if (pid == 0)
+    {
+        close(fds[0]);
+
+        if (timeoutSec > 0) {
+            alarm(timeoutSec);
+        }
+        solveRun(puzzle, record);
+
+        ssize_t written = write(fds[1], &record, sizeof(record));
+        _exit(written == sizeof(record) ? 0 : 1);
+    }
+    close(fds[1]);
+
+    if (read(fds[0], &record, sizeof(record)) != sizeof(record)) {
+        record.status = 2;
+    }
+    close(fds[0]);
+
+    wait4(pid, &status, 0, &usage);
+
+    record.peakRssKb = static_cast<uint64_t>(usage.ru_maxrss);
+}
+#endif
+
+struct Fit
+{
+    double a = 0;
+    double b = 0;
+    double r2 = 0;
+    bool valid = false;
+};
+
+// Least squares fit of log(y) = log(a) + b * x over the samples with y > 0.
+Fit fitExponential(const std::vector<double>& x, const std::vector<double>& y)
+{
+    Fit fit;
+
+    double n = 0, sx = 0, sy = 0, sxx = 0, sxy = 0, ssTot = 0, ssRes = 0, mean;
+
+    for (size_t i = 0; i < x.size(); ++i)
+    {
+        if (y[i] <= 0) continue;
+
+        n += 1;
+        sx += x[i];
+        sy += std::log(y[i]);
+        sxx += x[i] * x[i];
+        sxy += x[i] * std::log(y[i]);
+    }
+    if (n < 2 || n * sxx - sx * sx == 0) {
+        return fit;
+    }
+    fit.b = (n * sxy - sx * sy) / (n * sxx - sx * sx);
+    fit.a = std::exp((sy - fit.b * sx) / n);
+    fit.valid = true;
+
+    mean = sy / n;
+
+    for (size_t i = 0; i < x.size(); ++i)
+    {
+        if (y[i] <= 0) continue;
+
+        ssTot += (std::log(y[i]) - mean) * (std::log(y[i]) - mean);
+        ssRes += (std::log(y[i]) - std::log(fit.a) - fit.b * x[i]) * (std::log(y[i]) - std::log(fit.a) - fit.b * x[i]);
+    }
+    fit.r2 = (ssTot > 0 ? 1 - ssRes / ssTot : 1);
+
+    return fit;
+}
+
+int main(int argc, char* argv[])
+{
+    size_t minBottles = 3;
+    size_t maxBottles = 10;
+    size_t samples = 10;
+    unsigned int seed = 1;
+    unsigned int timeoutSec = 0;
+    std::string prefix = "scaling";
+
+    std::vector<RunRecord> records;
+    std::vector<Bottle> puzzle;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "--min") && i + 1 < argc) {
+            minBottles = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--max") && i + 1 < argc) {
+            maxBottles = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--samples") && i + 1 < argc) {
+            samples = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+            seed = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (!strcmp(argv[i], "--timeout") && i + 1 < argc) {
+            timeoutSec = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (!strcmp(argv[i], "--output") && i + 1 < argc) {
+            prefix = argv[++i];
+        }
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--min N] [--max N] [--samples K] [--seed S] [--timeout SEC] [--output PREFIX]\n";
+            return EXIT_FAILURE;
+        }
+    }
+    if (minBottles < MIN_BOTTLES || maxBottles > MAX_BOTTLES || minBottles > maxBottles || samples == 0)
+    {
+        std::cerr << "Bottle counts must satisfy " << MIN_BOTTLES << " <= min <= max <= " << MAX_BOTTLES
+            << " and samples must be positive." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::ofstream runs(prefix + "_runs.csv", std::ios::out);
+
+    if (!runs.is_open())
+    {
+        std::cerr << "Could not open \"" << prefix << "_runs.csv\" for writing." << std::endl;
+        return EXIT_FAILURE;
+    }
+    runs << "bottles,sample,status,depth,examined,peak_nodes,peak_pool_bytes,peak_rss_kb,wall_ms,branching_factor\n";
+
+    for (size_t n = minBottles; n <= maxBottles; ++n)
+    {
+        for (size_t k = 0; k < samples; ++k)
+        {
+            std::mt19937 generator(seed + static_cast<unsigned int>(n * 100003 + k));
+
+            RunRecord record {};
+
+            dispatchBottles<RandomPuzzle>(n, 0, generator, puzzle);
+
+            record.bottles = static_cast<int>(n);
+            record.sample = static_cast<int>(k);
+
+#if defined(_WIN32)
+            solveRun(puzzle, record);
+#else
+            isolatedRun(puzzle, timeoutSec, record);
+#endif
+            records.push_back(record);
+
+            runs << record.bottles << ',' << record.sample << ','
+                << (record.status == 0 ? "solved" : record.status == 1 ? "unsolved" : "timeout") << ','
+                << record.depth << ',' << record.examined << ',' << record.peakNodes << ','
+                << record.peakPoolBytes << ',' << record.peakRssKb << ','
+                << std::fixed << std::setprecision(3) << record.wallMs << ','
+                << std::setprecision(4) << record.branching << '\n' << std::flush;
+
+            std::cout << "> N = " << std::setw(2) << n << ", sample " << std::setw(3) << k << ": "
+                << (record.status == 0 ? "depth " + std::to_string(record.depth) : std::string("not solved"))
+                << ", " << record.examined << " examined, " << std::setprecision(1) << record.wallMs << " ms" << std::endl;
+        }
+    }
+
+    // Per-count means of every solved run, fitted against the bottle count.
+    const char* metrics[] = { "examined", "peak_nodes", "peak_pool_bytes", "peak_rss_kb", "wall_ms", "depth" };
+
+    std::ofstream fitFile(prefix + "_fit.csv", std::ios::out);
+
+    fitFile << "metric,a,b,growth_per_bottle,r2";
+
+    for (size_t n = MIN_BOTTLES; n <= MAX_BOTTLES; ++n) {
+        fitFile << ",predicted_n" << n;
+    }
+    fitFile << '\n';
+
+    for (size_t m = 0; m < sizeof(metrics) / sizeof(metrics[0]); ++m)
+    {
+        std::vector<double> x;
+        std::vector<double> y;
+
+        for (size_t n = minBottles; n <= maxBottles; ++n)
+        {
+            double sum = 0;
+            size_t count = 0;
+
+            for (const RunRecord& r : records)
+            {
+                if (r.bottles != static_cast<int>(n) || r.status != 0) continue;
+
+                const double values[] = {
+                    static_cast<double>(r.examined), static_cast<double>(r.peakNodes),
+                    static_cast<double>(r.peakPoolBytes), static_cast<double>(r.peakRssKb),
+                    r.wallMs, static_cast<double>(r.depth)
+                };
+                sum += values[m];
+                count += 1;
+            }
+            if (count > 0)
+            {
+                x.push_back(static_cast<double>(n));
+                y.push_back(sum / count);
+            }
+        }
+
+        Fit fit = fitExponential(x, y);
+
+        fitFile << metrics[m] << ',' << std::scientific << std::setprecision(6) << fit.a << ','
+            << fit.b << ',' << std::exp(fit.b) << ',' << std::fixed << std::setprecision(4) << fit.r2;
+
+        for (size_t n = MIN_BOTTLES; n <= MAX_BOTTLES; ++n) {
+            fitFile << ',' << std::scientific << std::setprecision(3) << (fit.valid ? fit.a * std::exp(fit.b * n) : 0.0);
+        }
+        fitFile << '\n';
+    }
+
+    std::cout << "\n> Runs written to \"" << prefix << "_runs.csv\", fitted models to \"" << prefix << "_fit.csv\"" << std::endl;
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fstream>
+#include <cstddef>
+#include <cstdint>
+
+#include "MappedFile.h"
+
+
+/*
+ *  Binary allocation tracing:
+ *
+ *      Records every operation of a MemoryPool as a fixed-size binary event.
+ *      Events are appended to an in-memory ring buffer by the pool's thread
+ *      and written to disk by a background thread, so tracing costs a clock
+ *      read and a few stores per allocation and can be left enabled on real
+ *      runs. The pool's thread only waits if the writer falls a whole ring
+ *      behind (see: stalls()).
+ *
+ *      Trace file (all fields little-endian): a 32-byte header followed by
+ *      16-byte events, in the order they happened.
+ *
+ *          offset  size  field
+ *          0       4     magic "WSAT"
+ *          4       2     format version (TRACE_VERSION)
+ *          6       2     reserved (0)
+ *          8       4     unit size in bytes (see: MemoryPool)
+ *          12      4     reserved (0)
+ *          16      8     pocket size in bytes
+ *          24      8     reserved (0)
+ *
+ *      Event:
+ *          0       8     nanoseconds since the tracer was opened
+ *          8       4     unit offset within the pocket
+ *          12      2     pocket index
+ *          14      1     operation (TraceOp)
+ *          15      1     reserved (0)
+ *
+ *
+ *  AllocationTracer class:
+ *
+ *  ->  open(const std::string &path, size_t unitBytes, size_t pocketBytes):
+ *          Creates the trace file and starts the writer thread.
+ *
+ *  ->  record(TraceOp, size_t pocket, size_t offset):
+ *          Appends an event. Must always be called from the same thread.
+ *
+ *  ->  close():
+ *          Writes the remaining events and stops the writer thread.
+ *          Called by the destructor if omitted.
+ *
+ *
+ *  AllocationTraceReader class:
+ *
+ *  ->  open(const std::string &path, std::string &error):
+ *          Maps and validates a trace file.
+ *
+ *  ->  eventAt(size_t i):
+ *          The i-th event of the trace.
+ */
+
+enum TraceOp : uint8_t
+{
+    TRACE_POCKET = 0,       // A new pocket was allocated.
+    TRACE_ALLOCATE = 1,     // A unit was taken from the unused end of a pocket.
+    TRACE_REUSE = 2,        // A unit was taken from a gap left by a release.
+    TRACE_RELEASE = 3       // A unit was released, leaving a gap.
+};
+
+struct TraceEvent
+{
+    uint64_t time;
+    uint32_t offset;
+    uint16_t pocket;
+    uint8_t op;
+};
+
+constexpr uint16_t TRACE_VERSION = 1;
+constexpr size_t TRACE_HEADER_SIZE = 32;
+constexpr size_t TRACE_EVENT_SIZE = 16;
+
+class AllocationTracer
+{
+private:
+    static constexpr size_t RING_EVENTS = static_cast<size_t>(1) << 16;
+
+    std::ofstream m_file;
+
+    std::vector<TraceEvent> m_ring;
+
+    std::atomic<uint64_t> m_head;       // Next event to be recorded (owned by the pool's thread).
+    std::atomic<uint64_t> m_tail;       // Next event to be written (owned by the writer thread).
+    std::atomic<bool> m_stop;
+
+    uint64_t m_stalls;
+
+    std::chrono::steady_clock::time_point m_t0;
+
+    std::thread m_writer;
+
+    void drain();
+
+public:
+    AllocationTracer();
+
+    AllocationTracer(const AllocationTracer&) = delete;
+
+    ~AllocationTracer();
+
+    bool open(const std::string& path, size_t unitBytes, size_t pocketBytes);
+
+    void close();
+
+    void record(TraceOp op, size_t pocket, size_t offset)
+    {
+        uint64_t head = m_head.load(std::memory_order_relaxed);
+
+        while (head - m_tail.load(std::memory_order_acquire) >= RING_EVENTS)
+        {
+            m_stalls += 1;
+            std::this_thread::yield();
+        }
+        TraceEvent& e = m_ring[head & (RING_EVENTS - 1)];
+
+        e.time = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_t0).count());
+        e.offset = static_cast<uint32_t>(offset);
+        e.pocket = static_cast<uint16_t>(pocket);
+        e.op = op;
+
+        m_head.store(head + 1, std::memory_order_release);
+    }
+
+    // Number of times the pool had to wait for the writer thread.
+    uint64_t stalls() const { return m_stalls; }
+};
+
+class AllocationTraceReader
+{
+private:
+    MappedFile m_file;
+
+    size_t m_unitBytes;
+    size_t m_pocketBytes;
+    size_t m_count;
+
+public:
+    AllocationTraceReader() : m_unitBytes(0), m_pocketBytes(0), m_count(0) {}
+
+    bool open(const std::string& path, std::string& error);
+
+    size_t unitBytes() const { return m_unitBytes; }
+
+    size_t pocketBytes() const { return m_pocketBytes; }
+
+    size_t size() const { return m_count; }
+
+    TraceEvent eventAt(size_t i) const;
+};
@@ -0,0 +1,231 @@
+#pragma once
+
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <climits>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include <unordered_set>
+
+#include "State.h"
+#include "Cancel.h"
+#include "PatternDatabase.h"
+
+
+/*
+ *  Anytime Beam Search:
+ *
+ *      Non-optimal, low latency alternative to BFS(). The search space is
+ *      explored layer by layer (like BFS) but only the `width` most promising
+ *      states of each layer, as ranked by State::heuristic(), are kept. If a
+ *      pattern database matching the puzzle is given (see: PatternDatabase.h),
+ *      the larger of both lower bounds is used.
+ *
+ *      The search is restarted with a doubled beam width for as long as
+ *      the deadline allows. Each restart prunes every state that cannot
+ *      beat the best solution found so far (depth + heuristic >= best),
+ *      so every reported solution is strictly shorter than the previous one.
+ *      If an iteration never had to truncate a layer, the search was
+ *      exhaustive and the best solution is proven optimal.
+ *
+ *
+ *  Functions:
+ *
+ *  ->  beamSearch(initial, width, bound, deadline, examined, memory, truncated, pattern, cancel):
+ *          Single beam search pass. Returns the solution path (see also:
+ *          State::copyWholePath()) or nullptr if no solution shorter than
+ *          `bound` was found. `truncated` is set if any layer was cut down
+ *          to the beam width or the deadline expired (or `cancel` was set,
+ *          see: Cancel.h). `pattern` is an optional pattern database lookup.
+ *
+ *  ->  anytimeBeamSearch(initial, options, examined, memory, optimal, onImprovement, cancel):
+ *          Repeats beamSearch() with growing width until the deadline expires
+ *          or optimality is proven. The deadline is only enforced once a first
+ *          solution exists, so a valid answer is always returned for solvable
+ *          puzzles, unless `cancel` is set, which stops the search at once with
+ *          the best solution so far (if any). onImprovement() is invoked for every new
+ *          best solution with its depth, the beam width that found it and the
+ *          elapsed time in milliseconds.
+ */
+
+
+struct AnytimeOptions
+{
+    size_t beamWidth = 100;       // Beam width of the first iteration (doubled on every restart).
+    uint64_t deadlineMs = 1000;   // Time budget in milliseconds.
+    const PatternDatabase* database = nullptr;    // Optional, shared by every thread.
+};
+
+typedef std::chrono::steady_clock::time_point deadline_t;
+
+template <size_t size>
+using ImprovementCallback = std::function<void(const State<size>* solution, int depth, size_t width, uint64_t elapsedMs)>;
+
+
+template <size_t size>
+State<size>* beamSearch(
+    State<size>& initial, size_t width, int bound, const deadline_t& deadline,
+    uint64_t& examined, uint64_t& memory, bool& truncated,
+    const PatternHeuristic<size>* pattern = nullptr, const std::atomic<bool>* cancel = nullptr)
+{
+    std::unordered_set<State<size>*, std::hash<State<size>*>, EqualContents<State<size>>> closed(width);
+
+    std::vector<State<size>*> owned;        // Every state allocated by this pass.
+    std::vector<State<size>*> layer;        // States kept in the beam at current depth.
+    std::vector<std::pair<int, State<size>*>> candidates;
+    std::vector<State<size>*> children;
+
+    State<size>* result = nullptr;
+
+    int depth = 0;
+    int h;
+
+    auto estimate = [pattern](State<size>* s)
+    {
+        return (pattern != nullptr ? std::max(s->heuristic(), pattern->lookup(s->getBottles())) : s->heuristic());
+    };
+
+    auto clearMemory = [&]()
+    {
+        for (State<size>* s : owned) {
+            delete s;
+        }
+        owned.clear();
+    };
+
+    layer.push_back(new State<size>(initial));
+    owned.push_back(layer.front());
+    closed.insert(layer.front());
+
+    if (initial.isVictorious())
+    {
+        result = layer.front()->copyWholePath();
+        clearMemory();
+        return result;
+    }
+
+    while (!layer.empty() && result == nullptr && depth + 1 < bound)
+    {
+        if (std::chrono::steady_clock::now() >= deadline || cancelled(cancel))
+        {
+            truncated = true;
+            break;
+        }
+        candidates.clear();
+
+        for (State<size>* s : layer)
+        {
+            examined += 1;
+
+            s->expand(children);
+
+            for (State<size>* child : children)
+            {
+                if (result != nullptr || closed.find(child) != closed.end() || depth + 1 + (h = estimate(child)) >= bound)
+                {
+                    delete child;
+                    continue;
+                }
+                owned.push_back(child);
+
+                // Goal state reached: the shallowest one this beam can offer.
+                if (child->isVictorious())
+                {
+                    result = child->copyWholePath();
+                    continue;
+                }
+                closed.insert(child);
+                candidates.push_back({ h, child });
+            }
+        }
+
+        if (candidates.size() > width)
+        {
+            truncated = true;
+
+            std::nth_element(candidates.begin(), candidates.begin() + width, candidates.end(),
+                [](const std::pair<int, State<size>*>& a, const std::pair<int, State<size>*>& b) {
+                    return a.first < b.first;
+                }
+            );
+            for (size_t i = width; i < candidates.size(); ++i) {
+                closed.erase(candidates[i].second);
+            }
+            candidates.resize(width);
+        }
+
+        layer.clear();
+
+        for (const auto& c : candidates) {
+            layer.push_back(c.second);
+        }
+
+        if (owned.size() > memory) {
+            memory = owned.size();
+        }
+        depth += 1;
+    }
+    clearMemory();
+
+    return result;
+}
+
+template <size_t size>
+State<size>* anytimeBeamSearch(
+    State<size>& initial, const AnytimeOptions& options,
+    uint64_t& examined, uint64_t& memory, bool& optimal,
+    const ImprovementCallback<size>& onImprovement = nullptr, const std::atomic<bool>* cancel = nullptr)
+{
+    const auto t0 = std::chrono::steady_clock::now();
+    const deadline_t deadline = t0 + std::chrono::milliseconds(options.deadlineMs);
+
+    PatternHeuristic<size> pattern(options.database, initial.getBottles());
+
+    State<size>* best = nullptr;
+    State<size>* s;
+
+    int bestDepth = INT_MAX;
+    size_t width = std::max<size_t>(options.beamWidth, 1);
+    bool truncated;
+
+    examined = 0;
+    memory = 1;
+    optimal = false;
+
+    while (true)
+    {
+        truncated = false;
+
+        s = beamSearch(initial, width, bestDepth, (best != nullptr ? deadline : deadline_t::max()), examined, memory, truncated,
+            (pattern.active() ? &pattern : nullptr), cancel);
+
+        if (s != nullptr)
+        {
+            // Only paths strictly shorter than the bound can be returned.
+            State<size>::deleteWholePath(best);
+
+            best = s;
+            bestDepth = s->getDepth();
+
+            if (onImprovement)
+            {
+                onImprovement(best, bestDepth, width,
+                    static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t0).count()));
+            }
+        }
+
+        if (!truncated)
+        {
+            // Exhaustive pass: nothing shorter than `best` exists.
+            optimal = true;
+            break;
+        }
+        if ((best != nullptr && std::chrono::steady_clock::now() >= deadline) || cancelled(cancel)) {
+            break;
+        }
+        width *= 2;
+    }
+    return best;
+}
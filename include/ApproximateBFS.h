@@ -0,0 +1,150 @@
+#pragma once
+
+#include <queue>
+#include <cmath>
+#include <vector>
+#include <cstdint>
+
+#include "BFS.h"
+#include "State.h"
+#include "Cancel.h"
+#include "BloomFilter.h"
+
+
+/*
+ *  Approximate Breadth First Search:
+ *
+ *      Memory-lean variant of BFS() whose visited set is a BloomFilter of
+ *      state hashes instead of a hash set of states. Duplicates are detected
+ *      as soon as a child is generated, so the frontier never holds the same
+ *      state twice, and expanded states are only kept (unhashed) as the
+ *      parents of the solution path.
+ *
+ *      A false positive of the filter discards a state that was never
+ *      visited, so the search may miss the shortest solution or, in the worst
+ *      case, every solution. Every state of an optimal path with d moves was
+ *      tested against the filter once, when the fill level gave it at most
+ *      the final false positive probability p, hence the returned solution
+ *      is optimal with probability at least (1 - p)^d (see: missProbability).
+ *      If no solution is found, the puzzle is solved again by the exact BFS().
+ *
+ *
+ *  ->  approximateBFS(initial, options, examined, memory, report, cancel):
+ *          Returns the solution path (see also: State::copyWholePath())
+ *          or nullptr if the exact fallback found none either, or if the
+ *          search was cancelled (see: Cancel.h).
+ */
+
+struct ApproximateOptions
+{
+    uint64_t expectedNodes = 10000000;      // Number of distinct states the filter is sized for.
+    double falsePositiveRate = 1e-4;        // Target false positive probability at that size.
+};
+
+struct ApproximateReport
+{
+    double missProbability = 0;             // Upper bound on the chance that a shorter solution was missed.
+    double falsePositiveRate = 0;           // Final false positive probability of the filter.
+    uint64_t filterBytes = 0;
+    bool exactFallback = false;             // Whether the exact search had to be run.
+};
+
+template <size_t size>
+State<size>* approximateBFS(
+    State<size>& initial, const ApproximateOptions& options,
+    uint64_t& examined, uint64_t& memory, ApproximateReport& report,
+    const std::atomic<bool>* cancel = nullptr)
+{
+    BloomFilter visited(options.expectedNodes, options.falsePositiveRate);
+
+    std::queue<State<size>*> frontier;
+
+    std::vector<State<size>*> expanded;     // Parents of the frontier's states.
+    std::vector<State<size>*> children;
+
+    State<size>* result = nullptr;
+    State<size>* s;
+
+    uint64_t fallbackExamined;
+    uint64_t fallbackMemory;
+
+    auto clearMemory = [&]()
+    {
+        while (!frontier.empty())
+        {
+            delete frontier.front();
+
+            frontier.pop();
+        }
+        for (State<size>* t : expanded) {
+            delete t;
+        }
+        expanded.clear();
+    };
+
+    report = ApproximateReport();
+    report.filterBytes = visited.bytes();
+
+    examined = 0;
+    memory = 1;
+
+    frontier.push(new State<size>(initial));
+    visited.insert(initial.hashValue());
+
+    while (!frontier.empty() && result == nullptr && !cancelled(cancel))
+    {
+        if (frontier.size() + expanded.size() > memory) {
+            memory = frontier.size() + expanded.size();
+        }
+
+        s = frontier.front();
+
+        frontier.pop();
+
+        examined += 1;
+
+        // Goal state reached.
+        if (s->isVictorious())
+        {
+            result = s->copyWholePath();
+
+            delete s;
+            break;
+        }
+        expanded.push_back(s);
+
+        s->expand(children);
+
+        for (State<size>* child : children)
+        {
+            if (!visited.insert(child->hashValue()))
+                frontier.push(child);
+            else
+                delete child;
+        }
+    }
+    clearMemory();
+
+    report.falsePositiveRate = visited.falsePositiveRate();
+
+    if (result != nullptr)
+    {
+        // 1 - (1 - p)^d, without rounding to 0 for the tiny p of a lightly filled filter.
+        report.missProbability = -std::expm1(result->getDepth() * std::log1p(-report.falsePositiveRate));
+        return result;
+    }
+
+    if (cancelled(cancel)) {
+        return nullptr;
+    }
+
+    // Every path to a goal was cut by false positives (or there is none).
+    report.exactFallback = true;
+
+    result = BFS<size>(initial, fallbackExamined, fallbackMemory, nullptr, nullptr, false, cancel);
+
+    examined += fallbackExamined;
+    memory = std::max(memory, fallbackMemory);
+
+    return result;
+}
@@ -0,0 +1,247 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <cstdint>
+
+#include "State.h"
+#include "Cancel.h"
+#include "ClosedSet.h"
+#include "SearchStats.h"
+#include "EndgameDatabase.h"
+
+
+/*
+ *  Breadth First Search:
+ *
+ *      Implementation of the Breadth First Search AI algorithm. Returns the
+ *      path to the shallowest victorious state (see also: State::copyWholePath())
+ *      or nullptr if none was found. Every other state allocated during the
+ *      search is released before returning.
+ *
+ *      `examined` is set to the number of states expanded and `memory` to the
+ *      peak number of states stored (frontier + closed set).
+ *
+ *      If `stats` is given, the search is instrumented (see: SearchStats);
+ *      the caller is expected to have called stats->start() beforehand.
+ *
+ *      If `endgame` is given, the search stops at the first state found in
+ *      the endgame database, which lies on an optimal path, and completes
+ *      the solution from the database (see: EndgameDatabase.h).
+ *
+ *      If `relabel` is set, states that only differ in the naming of their
+ *      colors count as duplicates (see: State::colorKey()). They are equally
+ *      far from the goal, so the solution stays optimal, and the solution's
+ *      states are the real ones: nothing needs to be mapped back.
+ *
+ *      If `cancel` is given, the search stops and returns nullptr as soon as
+ *      it is set (see: Cancel.h).
+ *
+ *      Closed set lookups are batched (see: ClosedSet.h): the children of a
+ *      state are all hashed and their slots prefetched before any of them
+ *      is looked up, and every frontier state keeps the hash computed for
+ *      it as a child, with which the slot of the state
+ *      BFS_PREFETCH_DISTANCE places ahead in the frontier is prefetched,
+ *      along with the state. The order of the search, hence its result, is
+ *      the same as with one lookup at a time.
+ */
+
+constexpr size_t BFS_PREFETCH_DISTANCE = 8;
+
+template <size_t size>
+State<size>* BFS(
+    State<size>& initial, uint64_t& examined, uint64_t& memory,
+    SearchStats* stats = nullptr, const EndgameLookup<size>* endgame = nullptr, bool relabel = false,
+    const std::atomic<bool>* cancel = nullptr)
+{
+    struct Queued
+    {
+        State<size>* state;
+        uint64_t hash;                  // Closed set hash of the state.
+    };
+
+    std::deque<Queued> frontier;
+
+    ClosedSet<size> closed(size * size * 1024, relabel);
+
+    std::vector<State<size>*> children;
+    std::vector<uint64_t> hashes;
+
+    State<size>* s;
+    uint64_t h;
+
+    MemoryPool& pool = getPool<size>();
+
+    size_t layerRemaining = 1;     // States of the current layer still in the frontier.
+    size_t nextLayer = 0;          // States of the next layer pushed so far.
+    int depth = 0;
+    int distance;                  // Moves left to the goal, if known.
+
+    bool sampled;
+    bool duplicate;
+
+    auto clearMemory = [&]()
+    {
+        for (const Queued& q : frontier) {
+            delete q.state;
+        }
+        frontier.clear();
+
+        closed.forEach([](State<size>* t) { delete t; });
+        closed.clear();
+    };
+
+    s = new State<size>(initial);
+
+    frontier.push_back(Queued{ s, closed.hash(s) });
+    examined = 0;
+    memory = 1;
+
+    if (stats != nullptr) {
+        stats->beginLayer(0);
+    }
+
+    while (!frontier.empty())
+    {
+        if (cancelled(cancel))
+        {
+            clearMemory();
+            return nullptr;
+        }
+        if (frontier.size() + closed.count() > memory) {
+            memory = frontier.size() + closed.count();
+        }
+
+        if (stats != nullptr)
+        {
+            // The frontier is FIFO: every state of the current layer precedes those of the next one.
+            if (layerRemaining == 0)
+            {
+                stats->endLayer(frontier.size(), closed.count(), pool.bytesInUse());
+                stats->beginLayer(++depth);
+
+                layerRemaining = nextLayer;
+                nextLayer = 0;
+            }
+            layerRemaining -= 1;
+
+            if ((examined & 1023) == 0) {
+                stats->progress(frontier.size(), closed.count(), pool.bytesInUse());
+            }
+        }
+
+        if (frontier.size() > BFS_PREFETCH_DISTANCE)
+        {
+            closed.prefetch(frontier[BFS_PREFETCH_DISTANCE].hash);
+            PREFETCH(frontier[BFS_PREFETCH_DISTANCE].state);
+        }
+        s = frontier.front().state;
+        h = frontier.front().hash;
+
+        frontier.pop_front();
+
+        duplicate = closed.contains(s, h);
+
+        if (stats != nullptr) {
+            stats->countLookup(duplicate);
+        }
+
+        if (!duplicate)
+        {
+            examined += 1;
+
+            // Goal state reached, or a state whose distance to it is known.
+            distance = (s->isVictorious() ? 0 : endgame != nullptr ? endgame->distance(s->getBottles()) : -1);
+
+            if (distance >= 0)
+            {
+                State<size>* result = s->copyWholePath();
+
+                if (distance > 0) {
+                    result = endgame->finish(result, distance);
+                }
+
+                if (stats != nullptr) {
+                    stats->endLayer(frontier.size(), closed.count(), pool.bytesInUse());
+                }
+                delete s;
+
+                clearMemory();
+
+                return result;
+            }
+            closed.insert(s, h);
+
+            sampled = (stats != nullptr && stats->sample());
+
+            if (sampled)
+            {
+                stats->beginSample();
+                {
+                    SearchStats::ScopedPhase phase(stats, PHASE_EXPAND);
+
+                    s->expand(children);
+                }
+                for (State<size>* child : children)
+                {
+                    SearchStats::ScopedPhase phase(stats, PHASE_HASH);
+
+                    volatile uint64_t v = closed.hash(child);
+                    (void)v;
+                }
+                for (State<size>* child : children)
+                {
+                    SearchStats::ScopedPhase phase(stats, PHASE_LOOKUP);
+
+                    closed.contains(child, closed.hash(child));
+                }
+                for (State<size>* child : children) {
+                    stats->countProbe(closed.probeLength(child, closed.hash(child)));
+                }
+            }
+            else s->expand(children);
+
+            if (stats != nullptr) {
+                stats->countGenerated(children.size());
+            }
+
+            // First pass: hash every child and prefetch its slot; second
+            // pass: resolve membership, the slots being (mostly) cached.
+            hashes.resize(children.size());
+
+            for (size_t i = 0; i < children.size(); ++i)
+            {
+                hashes[i] = closed.hash(children[i]);
+                closed.prefetch(hashes[i]);
+            }
+            for (size_t i = 0; i < children.size(); ++i)
+            {
+                duplicate = closed.contains(children[i], hashes[i]);
+
+                if (stats != nullptr) {
+                    stats->countLookup(duplicate);
+                }
+
+                if (!duplicate)
+                {
+                    frontier.push_back(Queued{ children[i], hashes[i] });
+                    nextLayer += 1;
+                }
+                else delete children[i];
+            }
+            if (sampled) {
+                stats->endSample();
+            }
+        }
+        else
+        {
+            delete s;
+        }
+    }
+    if (stats != nullptr) {
+        stats->endLayer(frontier.size(), closed.count(), pool.bytesInUse());
+    }
+    clearMemory();
+
+    return nullptr;
+}
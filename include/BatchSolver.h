@@ -0,0 +1,59 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <cstdint>
+#include <functional>
+
+#include "Bottle.h"
+#include "Solver.h"
+
+
+/*
+ *  Batch solving:
+ *
+ *      Solves a set of puzzles concurrently on a pool of worker threads.
+ *      Each worker runs one solver at a time on its own state pool arena
+ *      (see also: getPool()), which is reused by every puzzle it picks up.
+ *
+ *
+ *  ->  runBatch(count, source, options, out, log):
+ *          Solves puzzles 0 to count - 1, as handed out by `source` (which
+ *          returns the bottles of a puzzle and their number, and must be safe
+ *          to call concurrently, e.g. text puzzles or a CorpusReader).
+ *          Streams one JSON record per puzzle to `out` (JSON Lines), in order
+ *          of completion, and reports the aggregate throughput to `log`.
+ *          Puzzles are checked first (see: checkPuzzle()), as corpus
+ *          records are not parsed; an invalid one gets a record with an
+ *          "error" instead of being searched.
+ *          Returns the number of puzzles solved.
+ *
+ *  ->  toJson(uint64_t id, size_t bottles, const SolveResult &):
+ *          Formats a single record, e.g.:
+ *
+ *          {"id":0,"bottles":5,"solved":true,"optimal":true,"cached":false,"depth":8,"moves":[[1,4],...],
+ *           "examined":512,"peak_nodes":1258,"peak_bytes":28934,"elapsed_ms":1.204}
+ *
+ *          `id` is the index of the puzzle in its input file and moves are
+ *          written as [from, to] pairs of 1-based bottle numbers. A puzzle
+ *          that could not be searched carries an "error" message (see:
+ *          solvePuzzle()). Records of the approximate engine always give
+ *          its "miss_probability", even when it is 0. Portfolio results
+ *          also name the winning engine and every engine's outcome:
+ *
+ *          ...,"engine":"bfs","race":[{"engine":"bfs","solved":true,"optimal":true,"cancelled":false,
+ *           "depth":8,"elapsed_ms":1.090},...]}
+ */
+
+struct BatchOptions
+{
+    size_t threads = 1;
+    SolverOptions solver;
+};
+
+typedef std::function<const Bottle*(uint64_t i, size_t& n)> PuzzleSource;
+
+uint64_t runBatch(uint64_t count, const PuzzleSource& source, const BatchOptions& options, std::ostream& out, std::ostream& log);
+
+std::string toJson(uint64_t id, size_t bottles, const SolveResult& result);
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+
+/*
+ *  BloomFilter class:
+ *
+ *      Approximate set of 64-bit hashes. Membership tests never miss an
+ *      inserted hash but may wrongly report a hash that was never inserted
+ *      (false positive). The filter is sized for an expected number of
+ *      insertions and a target false positive probability p:
+ *
+ *          bits   m = -n * ln(p) / ln(2)^2
+ *          hashes k = (m / n) * ln(2)
+ *
+ *      The k bit positions are derived from the single 64-bit hash by
+ *      double hashing, so the input hash must be well mixed (see: StateKey::hash()).
+ *
+ *
+ *  Class' methods:
+ *
+ *  ->  BloomFilter(uint64_t expected, double falsePositiveRate):
+ *          Allocates a zeroed filter of the size described above.
+ *
+ *  ->  insert(uint64_t hash):
+ *          Adds the hash; returns true if it was (possibly) already present.
+ *
+ *  ->  contains(uint64_t hash):
+ *          True if the hash was (possibly) inserted.
+ *
+ *  ->  falsePositiveRate():
+ *          Probability that a hash never inserted is reported as present,
+ *          given the number of insertions so far: (1 - e^(-k * n / m))^k.
+ */
+
+class BloomFilter
+{
+private:
+    std::vector<uint64_t> m_words;
+
+    uint64_t m_bits;
+    uint64_t m_inserted;
+
+    unsigned int m_hashes;
+
+public:
+    BloomFilter(uint64_t expected, double falsePositiveRate);
+
+    bool insert(uint64_t hash);
+
+    bool contains(uint64_t hash) const;
+
+    double falsePositiveRate() const;
+
+    uint64_t size() const { return m_inserted; }
+
+    uint64_t bits() const { return m_bits; }
+
+    unsigned int hashes() const { return m_hashes; }
+
+    size_t bytes() const { return m_words.size() * sizeof(uint64_t); }
+};
@@ -1,12 +1,19 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <type_traits>
+
 #include "colors.h"
 
-#define NUM_OF_COLORS   4
-#define BOTTLE_SIZE     2
+// Capacity of the bottles in layers (mL), set at configure time (see: README).
+#ifndef WATERSORT_CAPACITY
+#   define WATERSORT_CAPACITY   4
+#endif
 
-#define LSB_MASK    static_cast<color_t>(0b00001111)
-#define MSB_MASK    static_cast<color_t>(0b11110000)
+#define NUM_OF_COLORS   WATERSORT_CAPACITY
+#define BOTTLE_SIZE     ((NUM_OF_COLORS * COLOR_BITS + 7) / 8)
 
 #if defined(__GNUC__)
 #   define PUSH_PACK /* */
@@ -21,61 +28,119 @@
 
 
 /*
- *  Bottle class:
- * 
- *      The following class represents a bottle of 4mL capacity.
- *      An array of these objects will be used for the representation
- *      of different snapshots (states) of the puzzle.
+ *  BasicBottle class template:
+ *
+ *      The following class represents a bottle of `capacity` mL, each
+ *      layer holding a color code of `colorBits` bits. An array of these
+ *      objects will be used for the representation of different snapshots
+ *      (states) of the puzzle.
+ *
+ *      The layers are packed into the fewest bytes that hold them, most
+ *      significant bits first: the top layer is in the high bits of the
+ *      first byte and the padding (if any) in the low bits of the last one,
+ *      so that bytewise order is the order of the layers. The bytes are read
+ *      and written as the smallest unsigned integer holding them (word_t).
+ *      With the default 4 layers of 4 bits a bottle takes 2 bytes, the top
+ *      layer in the high nibble of the first one.
+ *
+ *      The engines work on Bottle, the instance chosen at configure time
+ *      (WATERSORT_CAPACITY, WATERSORT_COLOR_BITS), whose capacity is
+ *      NUM_OF_COLORS and whose size in bytes is BOTTLE_SIZE.
  *
  *      The class also provides some degree of encapsulation for easier
  *      and safer code programming.
  *
- * 
+ *
  *  Class' methods:
- * 
+ *
+ *  ->  BasicBottle(top, ...):
+ *          Bottle of the given layers (exactly `capacity`, from the top);
+ *          exits if liquid floats above an empty layer.
+ *
+ *  ->  filled(color_t):
+ *          Bottle full of the given color (empty for NO_COLOR).
+ *
  *  ->  hasFreeSpace():
  *          True if the bottle is not full, false otherwise.
- * 
+ *
  *  ->  isEmpty():
  *          True if completely empty, meaning contents[i] = NO_COLOR
- *          for every i in [0, 4), false otherwise.
- * 
+ *          for every i in [0, capacity), false otherwise.
+ *
  *  ->  isComplete():
  *          True if empty or full of the same color, false otherwise
- * 
- *  ->  shouldPourTo(const Bottle &):
+ *
+ *  ->  shouldPourTo(const BasicBottle &):
  *          True if k mL of a continuous colored liquid can be moved from
  *          the of the bottle (without other colors intervening) either in
  *          some empty bottle or a bottle that has liquid of the same color
  *          at its top and has k mL empty space.
- * 
+ *
  *  ->  top():
  *          Returns the color at the bottle's top.
- * 
+ *
  *  ->  top(int &):
  *          Overloaded function of top() that returns the layer of the
  *          color (equivalent to free space) by reference.
- * 
- *  ->  pour(Bottle &):
+ *
+ *  ->  pour(BasicBottle &):
  *          Pours liquid from the bottle to the referring bottle.
  *          If successful the color of the poured liquid is returned,
  *          NO_COLOR otherwise.
- * 
+ *
  *  ->  getColor(size_t i):
  *          returns contents[i]
+ *
+ *  ->  getByte(size_t i):
+ *          returns the i-th packed byte, in [0, BYTES).
+ *
+ *  ->  segments():
+ *          Returns the number of continuous single-colored layers found
+ *          in the bottle (0 if empty).
  */
 
+// Smallest unsigned integer type of at least `bits` bits.
+template <size_t bits>
+struct PackedWord
+{
+    static_assert(bits <= 64, "Packed bottles must fit in 64 bits.");
+
+    typedef typename std::conditional<bits <= 8, uint8_t,
+        typename std::conditional<bits <= 16, uint16_t,
+        typename std::conditional<bits <= 32, uint32_t, uint64_t>::type>::type>::type type;
+};
+
 PUSH_PACK
 
-class Bottle
+template <size_t capacity, size_t colorBits>
+class BasicBottle
 {
+    static_assert(capacity > 1 && capacity < 16, "Bottles must hold 2 to 15 layers.");
+    static_assert(colorBits > 0 && colorBits <= 8 * sizeof(color_t), "Color codes must fit in color_t.");
+
+public:
+    static constexpr size_t BYTES = (capacity * colorBits + 7) / 8;
+
+    typedef typename PackedWord<8 * BYTES>::type word_t;
+
 private:
-    color_t contents[BOTTLE_SIZE] = {};
+    static constexpr word_t MASK = static_cast<word_t>((1u << colorBits) - 1);
+
+    color_t contents[BYTES] = {};
+
+    static constexpr size_t shift(size_t i) { return 8 * BYTES - (i + 1) * colorBits; }
+
+    word_t load() const;
+
+    void store(word_t w);
 
 public:
-    Bottle();
+    BasicBottle();
+
+    template <typename... Layers>
+    explicit BasicBottle(color_t top, Layers... below);
 
-    Bottle(color_t, color_t, color_t, color_t);
+    static BasicBottle filled(color_t c);
 
     bool hasFreeSpace() const;
 
@@ -83,22 +148,247 @@ public:
 
     bool isComplete() const;
 
-    bool shouldPourTo(const Bottle&) const;
+    bool shouldPourTo(const BasicBottle&) const;
 
     color_t top() const;
 
     color_t top(int&) const;
 
-    color_t pour(Bottle&);
+    color_t pour(BasicBottle&);
 
     color_t getColor(size_t) const;
 
     color_t getByte(size_t) const;
 
-    void setColor(size_t, color_t);
+    int segments() const;
 
-    bool operator == (const Bottle&) const;
+    void setColor(size_t, color_t);
 
-    Bottle& operator = (const Bottle&);
+    bool operator == (const BasicBottle&) const;
 }
 POP_PACK;
+
+typedef BasicBottle<NUM_OF_COLORS, COLOR_BITS> Bottle;
+
+static_assert(std::is_trivially_copyable<Bottle>::value, "Bottles are copied with memcpy.");
+static_assert(sizeof(Bottle) == BOTTLE_SIZE, "Bottles must be packed.");
+
+// Layout of Bottle, recorded by the binary formats holding packed bottles:
+// 0 for the default 4 layers of 4 bits (the only layout of files written
+// before layouts could be configured), capacity << 4 | color bits otherwise.
+constexpr uint8_t BOTTLE_LAYOUT = (NUM_OF_COLORS == 4 && COLOR_BITS == 4 ? 0
+    : static_cast<uint8_t>(NUM_OF_COLORS << 4 | COLOR_BITS));
+
+
+/* ------------------------------ IMPLEMENTATION ------------------------------ */
+
+template <size_t capacity, size_t colorBits>
+typename BasicBottle<capacity, colorBits>::word_t BasicBottle<capacity, colorBits>::load() const
+{
+    word_t w = contents[0];
+
+    for (size_t i = 1; i < BYTES; ++i) {
+        w = static_cast<word_t>(w << 8 | contents[i]);
+    }
+    return w;
+}
+
+template <size_t capacity, size_t colorBits>
+void BasicBottle<capacity, colorBits>::store(word_t w)
+{
+    for (size_t i = BYTES; i-- > 0;)
+    {
+        contents[i] = static_cast<color_t>(w & 0xFF);
+        w = static_cast<word_t>(w >> 8);
+    }
+}
+
+template <size_t capacity, size_t colorBits>
+BasicBottle<capacity, colorBits>::BasicBottle() {}
+
+template <size_t capacity, size_t colorBits>
+template <typename... Layers>
+BasicBottle<capacity, colorBits>::BasicBottle(color_t top, Layers... below)
+{
+    static_assert(sizeof...(below) + 1 == capacity, "A bottle takes exactly `capacity` layers.");
+
+    const color_t layers[capacity] = { top, static_cast<color_t>(below)... };
+
+    bool flag = true;
+    int i;
+
+    for (i = 0; i < static_cast<int>(capacity); ++i) {
+        setColor(i, layers[i]);
+    }
+
+    for (i = capacity - 1; i >= 0 && (flag || getColor(i) == NO_COLOR); --i)
+    {
+        if (getColor(i) == NO_COLOR) {
+            flag = false;
+        }
+    }
+
+    if (i >= 0) {
+        exit(-1);
+    }
+}
+
+template <size_t capacity, size_t colorBits>
+BasicBottle<capacity, colorBits> BasicBottle<capacity, colorBits>::filled(color_t c)
+{
+    BasicBottle b;
+
+    for (size_t i = 0; i < capacity; ++i) {
+        b.setColor(i, c);
+    }
+    return b;
+}
+
+template <size_t capacity, size_t colorBits>
+void BasicBottle<capacity, colorBits>::setColor(size_t i, color_t c)
+{
+    const word_t w = load() & static_cast<word_t>(~(MASK << shift(i)));
+
+    store(static_cast<word_t>(w | static_cast<word_t>(c) << shift(i)));
+}
+
+template <size_t capacity, size_t colorBits>
+color_t BasicBottle<capacity, colorBits>::getColor(size_t i) const {
+    return static_cast<color_t>((load() >> shift(i)) & MASK);
+}
+
+template <size_t capacity, size_t colorBits>
+color_t BasicBottle<capacity, colorBits>::getByte(size_t i) const {
+    return contents[i];
+}
+
+template <size_t capacity, size_t colorBits>
+int BasicBottle<capacity, colorBits>::segments() const
+{
+    int count = 0;
+    color_t c;
+    color_t last = NO_COLOR;
+
+    for (size_t i = 0; i < capacity; ++i)
+    {
+        c = getColor(i);
+
+        if (c != NO_COLOR && c != last) {
+            count += 1;
+        }
+        last = c;
+    }
+    return count;
+}
+
+template <size_t capacity, size_t colorBits>
+bool BasicBottle<capacity, colorBits>::hasFreeSpace() const {
+    return getColor(0) == NO_COLOR;
+}
+
+template <size_t capacity, size_t colorBits>
+bool BasicBottle<capacity, colorBits>::isComplete() const
+{
+    if (this->isEmpty()) {
+        return true;
+    }
+    if (getColor(0) == NO_COLOR) {
+        return false;
+    }
+    for (size_t i = 1; i < capacity; ++i) {
+        if (getColor(i) != getColor(i - 1)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <size_t capacity, size_t colorBits>
+bool BasicBottle<capacity, colorBits>::shouldPourTo(const BasicBottle& other) const
+{
+    color_t c;
+    int l1;
+    int l2;
+    int continuous_ml = 0;
+
+    if (this->isEmpty() || !other.hasFreeSpace()) {
+        return false;
+    }
+    if (other.isEmpty()) {
+        return true;
+    }
+    if ((c = this->top(l1)) != other.top(l2)) {
+        return false;
+    }
+    for (int i = l1; i < static_cast<int>(capacity) && getColor(i) == c; ++i) {
+        continuous_ml += 1;
+    }
+    if (continuous_ml > l2) {
+        return false;
+    }
+    return true;
+}
+
+template <size_t capacity, size_t colorBits>
+color_t BasicBottle<capacity, colorBits>::top() const
+{
+    for (size_t i = 0; i < capacity; ++i)
+    {
+        if (getColor(i) != NO_COLOR) {
+            return getColor(i);
+        }
+    }
+    return NO_COLOR;
+}
+
+template <size_t capacity, size_t colorBits>
+color_t BasicBottle<capacity, colorBits>::top(int& i) const
+{
+    for (i = 0; i < static_cast<int>(capacity); ++i) {
+        if (getColor(i) != NO_COLOR) {
+            return getColor(i);
+        }
+    }
+    return NO_COLOR;
+}
+
+template <size_t capacity, size_t colorBits>
+color_t BasicBottle<capacity, colorBits>::pour(BasicBottle& to)
+{
+    int i;
+    int pos1;
+    int pos2;
+
+    color_t color_to_be_poured = this->top(pos1);
+    color_t top_of_other = to.top(pos2);
+
+    if (top_of_other == NO_COLOR)
+    {
+        for (i = 0; ((pos1 + i) < static_cast<int>(capacity)) && (getColor(pos1 + i) == color_to_be_poured) && to.hasFreeSpace(); ++i) {
+            setColor(pos1 + i, NO_COLOR);
+            to.setColor(capacity - 1 - i, color_to_be_poured);
+        }
+    }
+    else
+    {
+        if (top_of_other != color_to_be_poured) {
+            return NO_COLOR;
+        }
+        for (i = 0; ((pos1 + i) < static_cast<int>(capacity)) && (getColor(pos1 + i) == color_to_be_poured) && to.hasFreeSpace(); ++i) {
+            setColor(pos1 + i, NO_COLOR);
+            to.setColor(pos2 - i - 1, color_to_be_poured);
+        }
+    }
+    return color_to_be_poured;
+}
+
+template <size_t capacity, size_t colorBits>
+bool BasicBottle<capacity, colorBits>::operator == (const BasicBottle& other) const
+{
+    return load() == other.load();
+}
+
+template <size_t capacity, size_t colorBits>
+bool BasicBottle<capacity, colorBits>::isEmpty() const {
+    return getColor(capacity - 1) == NO_COLOR;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <atomic>
+
+
+/*
+ *  Cooperative cancellation:
+ *
+ *      The search engines take an optional flag that another thread may set
+ *      to stop them early (e.g. once a concurrent engine has found a solution,
+ *      see: solvePuzzle()). An engine polls the flag between two expansions,
+ *      releases its states and returns what it would return for an unsolved
+ *      puzzle, nullptr for the exact ones. Polling is a relaxed load, so an
+ *      engine without a flag, or whose flag is never set, runs as before.
+ *
+ *
+ *  ->  cancelled(const std::atomic<bool> *cancel):
+ *          True if the flag is given and set.
+ */
+
+inline bool cancelled(const std::atomic<bool>* cancel)
+{
+    return cancel != nullptr && cancel->load(std::memory_order_relaxed);
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Bottle.h"
+
+
+/*
+ *  Canonical puzzle encoding:
+ *
+ *      Puzzles that only differ in the order of their bottles or in the
+ *      naming of their colors share the same solutions (up to renumbering
+ *      the bottles). canonicalize() maps such puzzles onto a common
+ *      representative:
+ *
+ *      1.  Colors are ranked by a signature that ignores their names: the
+ *          sorted list of (bottle layout, layer) pairs in which they occur.
+ *      2.  Bottles are sorted by the ranks of their colors.
+ *      3.  Colors are renumbered 1, 2, ... by order of first appearance,
+ *          scanning bottles in order from top to bottom, and bottles are
+ *          sorted again by their renumbered contents until stable.
+ *
+ *      Equivalent puzzles whose colors cannot be told apart by their
+ *      signatures may still end up with different encodings; this only
+ *      costs a missed reuse, as the encoding itself is always a valid
+ *      relabeling of its own input.
+ *
+ *
+ *  ->  canonicalize(const Bottle *bottles, size_t n, Bottle *canonical, size_t *perm):
+ *          Writes the canonical encoding of the n bottles to `canonical`,
+ *          such that canonical[i] is bottles[perm[i]] with renumbered colors.
+ *
+ *  ->  canonicalHash(const Bottle *canonical, size_t n):
+ *          64-bit FNV-1a hash of an encoding's bytes, never 0.
+ *
+ *  ->  relabelColors(const Bottle *bottles, size_t n, Bottle *relabeled, color_t *original):
+ *          Renumbers the colors 1, 2, ... by order of first appearance (bottles
+ *          in order, top to bottom), keeping the bottles in place. Unlike
+ *          canonicalize(), this is exact: two sets of bottles are relabeled
+ *          alike if and only if they differ only in the naming of their colors.
+ *          If `original` is given (TOTAL_COLORS + 1 entries), original[k] is
+ *          set to the color renumbered k, for restoreColors().
+ *
+ *  ->  restoreColors(Bottle *bottles, size_t n, const color_t *original):
+ *          Inverse of relabelColors(), e.g. for displaying a solution found
+ *          on relabeled bottles. Moves need no mapping, as the bottles keep
+ *          their positions.
+ */
+
+void canonicalize(const Bottle* bottles, size_t n, Bottle* canonical, size_t* perm);
+
+uint64_t canonicalHash(const Bottle* canonical, size_t n);
+
+void relabelColors(const Bottle* bottles, size_t n, Bottle* relabeled, color_t* original = nullptr);
+
+void restoreColors(Bottle* bottles, size_t n, const color_t* original);
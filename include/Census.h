@@ -0,0 +1,525 @@
+#pragma once
+
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#include "State.h"
+#include "Cancel.h"
+#include "Retrograde.h"
+#include "PartitionTable.h"
+
+
+/*
+ *  Reachable-state census:
+ *
+ *      Enumerates every state reachable from a start position, to measure
+ *      the search space a puzzle opens: how many states lie at each depth,
+ *      how many moves they offer, how many are dead ends and how far the
+ *      farthest of them is from the goal. No path is kept: states are
+ *      packed keys in the same partitioned tables as pipelinedBFS() (see:
+ *      PartitionTable), plus the keys of the current and next layers.
+ *
+ *      The census runs in two passes, layer by layer, on `threads` workers:
+ *
+ *      ->  forward: workers claim chunks of CENSUS_CHUNK_KEYS states of the
+ *          layer, count their pours (the branching histogram, goals and dead
+ *          ends, i.e. states with no legal pour that are not goals) and
+ *          batch their children by partition. A full batch of
+ *          CENSUS_BATCH_KEYS children is inserted under its partition's
+ *          lock, after prefetching the slots of the whole batch, and the
+ *          new ones make up the partition's share of the next layer. Goals
+ *          are expanded too: the census covers the whole reachable graph.
+ *
+ *      ->  backward: a breadth-first search from every goal, restricted to
+ *          the states found forward, retags every state with its distance to
+ *          the nearest goal. As every successor of a reachable state is
+ *          reachable, these are the lengths of the optimal solutions; the
+ *          largest is the eccentricity, and the states never retagged cannot
+ *          be solved. While the last layer is small, its predecessors are
+ *          generated (see: Retrograde.h) and batched as above. A state has
+ *          about four times more predecessors than pours, though, and most
+ *          distances are short: once the states left are fewer than
+ *          CENSUS_PULL_RATIO times the last layer, every state left instead
+ *          checks whether one of its pours lands on the last layer, which
+ *          halves the time of the pass on 8-bottle puzzles.
+ *
+ *      Partitions (by the high bits of the key hash) only spread the locks;
+ *      several per worker keep the workers from waiting on one another.
+ *
+ *
+ *  ->  census(start, options, report, cancel):
+ *          Fills `report` for the `size` bottles of `start`. Returns false
+ *          if the census was cut short, by `cancel` (see: Cancel.h) or by
+ *          options.maxStates, in which case only the forward layers done so
+ *          far are reported.
+ *
+ *  ->  takeCensus(bottles, n, options, report, cancel):
+ *          The same for n bottles known at runtime; false also if n is
+ *          unsupported.
+ *
+ *  ->  censusJson(uint64_t id, const CensusReport &):
+ *          Formats a report as a single JSON record, e.g.:
+ *
+ *          {"id":0,"bottles":5,"complete":true,"states":1237,"goals":60,"dead_ends":0,"solvable":1237,
+ *           "start_distance":8,"depth":11,"eccentricity":8,"layers":[1,6,15,...],"distances":[60,480,...],
+ *           "branching":[0,0,26,...],"peak_bytes":370688,"elapsed_ms":3.544}
+ *
+ *          where `layers` counts the states at each depth from the start,
+ *          `distances` the states at each distance from the goal and
+ *          `branching` the states offering each number of pours.
+ */
+
+constexpr size_t CENSUS_CHUNK_KEYS = 4096;
+constexpr size_t CENSUS_BATCH_KEYS = 256;
+constexpr uint64_t CENSUS_PULL_RATIO = 4;
+
+struct CensusOptions
+{
+    size_t threads = 0;                     // Worker threads (0: number of cores).
+    size_t partitions = 0;                  // Parts of the visited states, each with its lock (0: 4 per worker).
+    uint64_t maxStates = 0;                 // States after which the census stops (0: unlimited).
+};
+
+struct CensusReport
+{
+    size_t bottles = 0;
+    bool complete = false;                  // Whether every reachable state was enumerated.
+    uint64_t states = 0;                    // Reachable states, including the start.
+    uint64_t goals = 0;
+    uint64_t deadEnds = 0;                  // States with no legal pour, goals excepted.
+    uint64_t solvable = 0;                  // States from which a goal can be reached.
+    int startDistance = -1;                 // Optimal solution of the start (-1 if none).
+    int depth = 0;                          // Moves to the farthest state from the start.
+    int eccentricity = -1;                  // Longest optimal solution of a reachable state.
+    std::vector<uint64_t> layers;           // States by depth from the start.
+    std::vector<uint64_t> distances;        // Solvable states by distance to the goal.
+    std::vector<uint64_t> branching;        // States by number of legal pours.
+    uint64_t peakBytes = 0;                 // Peak memory of the tables and layers.
+    double elapsedMs = 0;
+};
+
+bool takeCensus(const Bottle* bottles, size_t n, const CensusOptions& options, CensusReport& report,
+    const std::atomic<bool>* cancel = nullptr);
+
+std::string censusJson(uint64_t id, const CensusReport& report);
+
+template <size_t size>
+bool census(const Bottle* start, const CensusOptions& options, CensusReport& report, const std::atomic<bool>* cancel = nullptr)
+{
+    constexpr size_t KEY_BYTES = PartitionTable<size>::KEY_BYTES;
+    constexpr uint8_t UNKNOWN = UINT8_MAX;  // Tag of a state whose distance is not known (yet).
+
+    typedef std::array<uint8_t, KEY_BYTES> raw_key_t;
+
+    struct Batch
+    {
+        size_t count = 0;
+        uint64_t hashes[CENSUS_BATCH_KEYS];
+        raw_key_t keys[CENSUS_BATCH_KEYS];
+    };
+
+    // Pours counted by a worker during the forward pass.
+    struct Tally
+    {
+        std::vector<uint64_t> branching = std::vector<uint64_t>(size * (size - 1) + 1, 0);
+        std::vector<raw_key_t> goals;
+        uint64_t deadEnds = 0;
+    };
+
+    const size_t T = (options.threads > 0 ? options.threads : std::max<size_t>(std::thread::hardware_concurrency(), 1));
+    const size_t P = (options.partitions > 0 ? options.partitions : 4 * T);
+
+    std::vector<PartitionTable<size>> tables;
+    std::vector<std::mutex> locks(P);
+    std::vector<std::vector<raw_key_t>> layer(P);   // Current layer, by partition.
+    std::vector<std::vector<raw_key_t>> next(P);
+    std::vector<std::pair<size_t, size_t>> chunks;  // Partition and first key of every chunk of the layer.
+
+    std::vector<Tally> tallies(T);
+    std::vector<std::thread> threads;
+
+    std::atomic<size_t> nextChunk;
+
+    raw_key_t key;
+
+    uint8_t tag;
+
+    uint64_t unknown;                               // States whose distance is not known yet.
+    uint64_t frontier;                              // States of the last backward layer.
+
+    int distance = 0;
+
+    auto t0 = std::chrono::steady_clock::now();
+
+    auto hashOf = [](const uint8_t* k) { return StateKey<size>(reinterpret_cast<const Bottle*>(k)).hash(); };
+
+    auto partitionOf = [P](uint64_t hash) { return static_cast<size_t>(((hash >> 32) * P) >> 32); };
+
+    auto account = [&]()
+    {
+        uint64_t bytes = 0;
+
+        for (size_t p = 0; p < P; ++p) {
+            bytes += tables[p].bytes() + (layer[p].capacity() + next[p].capacity()) * sizeof(raw_key_t);
+        }
+        report.peakBytes = std::max(report.peakBytes, bytes);
+    };
+
+    // Runs f(worker) on every worker.
+    auto parallel = [&](auto f)
+    {
+        for (size_t w = 0; w < T; ++w) {
+            threads.emplace_back(f, w);
+        }
+        for (std::thread& t : threads) {
+            t.join();
+        }
+        threads.clear();
+    };
+
+    auto swapLayers = [&]()
+    {
+        account();
+
+        layer.swap(next);
+
+        for (std::vector<raw_key_t>& keys : next) {
+            keys.clear();
+        }
+    };
+
+    // Runs `visit(worker, key, emit)` on every state of the layer; the keys emitted and accepted by
+    // `accept(table, key, hash)` make up the next layer.
+    auto pass = [&](auto visit, auto accept)
+    {
+        chunks.clear();
+
+        for (size_t p = 0; p < P; ++p) {
+            for (size_t i = 0; i < layer[p].size(); i += CENSUS_CHUNK_KEYS) {
+                chunks.push_back({ p, i });
+            }
+        }
+        nextChunk = 0;
+
+        auto work = [&](size_t w)
+        {
+            std::vector<Batch> batches(P);
+
+            auto flush = [&](size_t p)
+            {
+                Batch& batch = batches[p];
+
+                std::lock_guard<std::mutex> lock(locks[p]);
+
+                // The slots of the whole batch are fetched together, then probed.
+                for (size_t i = 0; i < batch.count; ++i) {
+                    tables[p].prefetch(batch.hashes[i]);
+                }
+                for (size_t i = 0; i < batch.count; ++i) {
+                    if (accept(tables[p], batch.keys[i].data(), batch.hashes[i])) {
+                        next[p].push_back(batch.keys[i]);
+                    }
+                }
+                batch.count = 0;
+            };
+
+            auto emit = [&](const Bottle* k)
+            {
+                const uint64_t hash = hashOf(reinterpret_cast<const uint8_t*>(k));
+                const size_t p = partitionOf(hash);
+
+                batches[p].hashes[batches[p].count] = hash;
+                memcpy(batches[p].keys[batches[p].count].data(), k, KEY_BYTES);
+
+                if (++batches[p].count == CENSUS_BATCH_KEYS) {
+                    flush(p);
+                }
+            };
+
+            for (size_t c; !cancelled(cancel) && (c = nextChunk.fetch_add(1)) < chunks.size(); )
+            {
+                const std::vector<raw_key_t>& keys = layer[chunks[c].first];
+                const size_t end = std::min(chunks[c].second + CENSUS_CHUNK_KEYS, keys.size());
+
+                for (size_t i = chunks[c].second; i < end; ++i) {
+                    visit(w, keys[i], emit);
+                }
+            }
+            for (size_t p = 0; p < P; ++p) {
+                if (batches[p].count > 0) {
+                    flush(p);
+                }
+            }
+        };
+
+        parallel(work);
+        swapLayers();
+    };
+
+    // Every state still tagged UNKNOWN with a pour onto a state tagged `last` is retagged `tagged` and makes up the
+    // next layer. The tables are only read while the workers search them, and retagged afterwards.
+    auto pull = [&](uint8_t last, uint8_t tagged)
+    {
+        std::vector<std::vector<std::vector<raw_key_t>>> found(T, std::vector<std::vector<raw_key_t>>(P));
+
+        chunks.clear();
+
+        for (size_t p = 0; p < P; ++p) {
+            for (size_t i = 0; i < tables[p].capacity(); i += CENSUS_CHUNK_KEYS) {
+                chunks.push_back({ p, i });
+            }
+        }
+        nextChunk = 0;
+
+        auto search = [&](size_t w)
+        {
+            Bottle bottles[size];
+
+            raw_key_t children[size * (size - 1)];
+            uint64_t hashes[size * (size - 1)];
+
+            size_t n;
+
+            uint8_t t;
+
+            for (size_t c; !cancelled(cancel) && (c = nextChunk.fetch_add(1)) < chunks.size(); )
+            {
+                const PartitionTable<size>& table = tables[chunks[c].first];
+                const size_t end = std::min(chunks[c].second + CENSUS_CHUNK_KEYS, table.capacity());
+
+                for (size_t i = chunks[c].second; i < end; ++i)
+                {
+                    if (table.at(i)[KEY_BYTES] != UNKNOWN) continue;
+
+                    memcpy(bottles, table.at(i), KEY_BYTES);
+                    n = 0;
+
+                    for (size_t from = 0; from < size; ++from)
+                    {
+                        for (size_t to = 0; to < size; ++to)
+                        {
+                            if (from == to || !bottles[from].shouldPourTo(bottles[to])) continue;
+
+                            Bottle* child = reinterpret_cast<Bottle*>(children[n].data());
+
+                            memcpy(child, bottles, KEY_BYTES);
+                            child[from].pour(child[to]);
+
+                            hashes[n] = hashOf(children[n].data());
+                            tables[partitionOf(hashes[n])].prefetch(hashes[n]);
+                            n += 1;
+                        }
+                    }
+                    for (size_t j = 0; j < n; ++j)
+                    {
+                        if (tables[partitionOf(hashes[j])].find(children[j].data(), hashes[j], t) && t == last)
+                        {
+                            found[w][chunks[c].first].emplace_back();
+                            memcpy(found[w][chunks[c].first].back().data(), table.at(i), KEY_BYTES);
+                            break;
+                        }
+                    }
+                }
+            }
+        };
+
+        // Worker w retags partitions w, w + T, ...
+        auto retag = [&](size_t w)
+        {
+            for (size_t p = w; p < P; p += T)
+            {
+                for (size_t v = 0; v < T; ++v)
+                {
+                    for (const raw_key_t& k : found[v][p])
+                    {
+                        tables[p].retag(k.data(), hashOf(k.data()), UNKNOWN, tagged);
+                        next[p].push_back(k);
+                    }
+                    std::vector<raw_key_t>().swap(found[v][p]);
+                }
+            }
+        };
+
+        parallel(search);
+        parallel(retag);
+        swapLayers();
+    };
+
+    // Forward: every pour of every state.
+    auto expand = [&](size_t w, const raw_key_t& k, auto& emit)
+    {
+        Bottle bottles[size];
+        Bottle child[size];
+
+        size_t pours = 0;
+
+        memcpy(bottles, k.data(), KEY_BYTES);
+
+        for (size_t from = 0; from < size; ++from)
+        {
+            for (size_t to = 0; to < size; ++to)
+            {
+                if (from == to || !bottles[from].shouldPourTo(bottles[to])) continue;
+
+                memcpy(child, bottles, KEY_BYTES);
+                child[from].pour(child[to]);
+
+                emit(child);
+                pours += 1;
+            }
+        }
+        tallies[w].branching[pours] += 1;
+
+        if (isGoal<size>(bottles)) {
+            tallies[w].goals.push_back(k);
+        }
+        else if (pours == 0) {
+            tallies[w].deadEnds += 1;
+        }
+    };
+
+    // Backward: the reachable predecessors of every state, not yet reached from a goal.
+    auto retract = [&](size_t, const raw_key_t& k, auto& emit)
+    {
+        forEachPredecessor<size>(reinterpret_cast<const Bottle*>(k.data()), [&](const Bottle* predecessor, int, int)
+        {
+            emit(predecessor);
+            return false;
+        });
+    };
+
+    auto visitForward = [](PartitionTable<size>& table, const uint8_t* k, uint64_t hash)
+    {
+        return table.insert(k, hash, UNKNOWN);
+    };
+
+    report = CensusReport();
+    report.bottles = size;
+
+    for (size_t p = 0; p < P; ++p) {
+        tables.emplace_back(size * size * 1024 / P);
+    }
+    memcpy(key.data(), start, KEY_BYTES);
+
+    tables[partitionOf(hashOf(key.data()))].insert(key.data(), hashOf(key.data()), UNKNOWN);
+    layer[partitionOf(hashOf(key.data()))].push_back(key);
+
+    report.layers.push_back(1);
+    report.states = 1;
+
+    while (true)
+    {
+        uint64_t count = 0;
+
+        pass(expand, visitForward);
+
+        if (cancelled(cancel)) break;
+
+        for (const std::vector<raw_key_t>& keys : layer) {
+            count += keys.size();
+        }
+        if (count == 0)
+        {
+            report.complete = true;
+            break;
+        }
+        report.layers.push_back(count);
+        report.states += count;
+
+        if (options.maxStates > 0 && report.states > options.maxStates) break;
+    }
+    report.branching.assign(size * (size - 1) + 1, 0);
+
+    for (const Tally& tally : tallies)
+    {
+        for (size_t i = 0; i < report.branching.size(); ++i) {
+            report.branching[i] += tally.branching[i];
+        }
+        report.goals += tally.goals.size();
+        report.deadEnds += tally.deadEnds;
+    }
+    while (report.branching.size() > 1 && report.branching.back() == 0) {
+        report.branching.pop_back();
+    }
+    report.depth = static_cast<int>(report.layers.size()) - 1;
+
+    if (!report.complete)
+    {
+        report.elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        return false;
+    }
+
+    // Distances are tagged as distance + 1, the goals first.
+    for (size_t p = 0; p < P; ++p) {
+        layer[p].clear();
+    }
+    for (Tally& tally : tallies)
+    {
+        for (const raw_key_t& k : tally.goals)
+        {
+            tables[partitionOf(hashOf(k.data()))].retag(k.data(), hashOf(k.data()), UNKNOWN, 1);
+            layer[partitionOf(hashOf(k.data()))].push_back(k);
+        }
+        std::vector<raw_key_t>().swap(tally.goals);
+    }
+    if (report.goals > 0) {
+        report.distances.push_back(report.goals);
+    }
+
+    unknown = report.states - report.goals;
+    frontier = report.goals;
+
+    while (frontier > 0 && distance + 2 < UNKNOWN)
+    {
+        auto visitBackward = [distance](PartitionTable<size>& table, const uint8_t* k, uint64_t hash)
+        {
+            return table.retag(k, hash, UNKNOWN, static_cast<uint8_t>(distance + 2));
+        };
+
+        uint64_t count = 0;
+
+        // Predecessors of the last layer while it is small, pours of the states left afterwards (see above).
+        if (CENSUS_PULL_RATIO * frontier < unknown) {
+            pass(retract, visitBackward);
+        }
+        else pull(static_cast<uint8_t>(distance + 1), static_cast<uint8_t>(distance + 2));
+
+        if (cancelled(cancel)) break;
+
+        for (const std::vector<raw_key_t>& keys : layer) {
+            count += keys.size();
+        }
+        if (count == 0) break;
+
+        report.distances.push_back(count);
+        unknown -= count;
+        frontier = count;
+        distance += 1;
+    }
+    if (cancelled(cancel))
+    {
+        report.complete = false;
+        report.distances.clear();
+        report.elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        return false;
+    }
+    for (uint64_t count : report.distances) {
+        report.solvable += count;
+    }
+    report.eccentricity = static_cast<int>(report.distances.size()) - 1;
+
+    if (tables[partitionOf(hashOf(key.data()))].find(key.data(), hashOf(key.data()), tag) && tag != UNKNOWN) {
+        report.startDistance = tag - 1;
+    }
+    report.elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+    return true;
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <string>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+
+/*
+ *  Search checkpoints:
+ *
+ *      Snapshot of a layered search (see: CompactBFS.h) taken between two
+ *      layers, from which an interrupted search can be resumed. The whole
+ *      state of the search at that point is its visited set: the current
+ *      layer is made of the visited states tagged with the current depth,
+ *      and no parent pointers exist. The set's front-coded entries (see:
+ *      CompactStateSet.h) are written as they are, so a checkpoint takes
+ *      about as much disk as the set takes memory.
+ *
+ *      A checkpoint is written to `<directory>/checkpoint.wsck.tmp` by a
+ *      background thread while the search goes on, then renamed over the
+ *      previous checkpoint, so that an interruption (or the process being
+ *      killed) at any time leaves the last complete checkpoint in place.
+ *
+ *      File (all fields little-endian): a 32-byte header, the key of the
+ *      initial state (a checkpoint is only resumed for the same puzzle) and
+ *      the encoded entries of the visited set.
+ *
+ *          offset  size  field
+ *          0       4     magic "WSCK"
+ *          4       2     format version (CHECKPOINT_VERSION)
+ *          6       1     number of bottles
+ *          7       1     depth of the current layer
+ *          8       8     number of visited states
+ *          16      8     states examined so far
+ *          24      1     bottle layout (BOTTLE_LAYOUT, see: Bottle.h)
+ *          25      7     reserved (0)
+ *
+ *
+ *  ->  readCheckpoint(directory, header, puzzle, data, error):
+ *          Reads the checkpoint of a directory. Returns false if there is
+ *          none or it cannot be read (error is left empty in the former case).
+ *
+ *
+ *  CheckpointWriter class:
+ *
+ *  ->  due():
+ *          True once the interval has passed since the last checkpoint and
+ *          no write is in progress.
+ *
+ *  ->  start(header, puzzle, keyBytes, data, bytes):
+ *          Starts writing a checkpoint in the background. The buffers must
+ *          stay unchanged until wait() returns.
+ *
+ *  ->  wait():
+ *          Waits for the write in progress, if any.
+ */
+
+constexpr uint16_t CHECKPOINT_VERSION = 1;
+constexpr size_t CHECKPOINT_HEADER_SIZE = 32;
+
+struct CheckpointOptions
+{
+    std::string directory;              // Existing directory holding the checkpoint.
+    uint64_t intervalMs = 60000;        // Minimum time between two checkpoints.
+    bool resume = false;                // Continue from the directory's checkpoint, if any.
+};
+
+struct CheckpointHeader
+{
+    size_t bottles = 0;
+    int depth = 0;
+    uint64_t count = 0;
+    uint64_t examined = 0;
+};
+
+struct CheckpointReport
+{
+    int resumedDepth = -1;              // Depth the search resumed from (-1 if it started afresh).
+    uint64_t written = 0;               // Checkpoints completed.
+    int lastDepth = -1;                 // Depth of the last checkpoint completed.
+    std::string error;                  // Why the search could not be resumed or checkpointed.
+};
+
+std::string checkpointPath(const std::string& directory);
+
+bool readCheckpoint(const std::string& directory, CheckpointHeader& header,
+    std::vector<uint8_t>& puzzle, std::vector<uint8_t>& data, std::string& error);
+
+class CheckpointWriter
+{
+private:
+    std::string m_directory;
+    std::chrono::steady_clock::time_point m_last;
+    uint64_t m_intervalMs;
+
+    std::thread m_thread;
+
+    CheckpointReport* m_report;
+    int m_depth;                        // Depth of the write in progress.
+    bool m_failed;
+
+    void write(CheckpointHeader header, const uint8_t* puzzle, size_t keyBytes, const uint8_t* data, size_t bytes);
+
+public:
+    CheckpointWriter(const CheckpointOptions& options, CheckpointReport* report);
+
+    ~CheckpointWriter() { wait(); }
+
+    bool due() const;
+
+    void start(const CheckpointHeader& header, const uint8_t* puzzle, size_t keyBytes, const uint8_t* data, size_t bytes);
+
+    void wait();
+};
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "State.h"
+
+#if defined(__GNUC__)
+#   define PREFETCH(address) __builtin_prefetch(address)
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#   include <xmmintrin.h>
+#   define PREFETCH(address) _mm_prefetch(reinterpret_cast<const char*>(address), _MM_HINT_T0)
+#else
+#   define PREFETCH(address) ((void)(address))
+#endif
+
+
+/*
+ *  ClosedSet class:
+ *
+ *      Closed set of BFS(): a flat, open-addressing (linear probing) hash set
+ *      of state pointers. Every slot holds a state and its full hash, so a
+ *      probe only reads the state itself when the hashes match, and growing
+ *      the table never touches the states. The table has a power of two
+ *      number of slots (the state hash mixes every bit, see: StateKey) and
+ *      is kept at most 3/4 full.
+ *
+ *      The caller computes the hashes (hash()), so that a batch of states is
+ *      hashed first, the slots of all of them are prefetched (prefetch())
+ *      and membership is resolved afterwards (contains()): the cache misses
+ *      of the batch overlap instead of following one another. States are
+ *      compared up to a renaming of their colors if `relabel` is set (see:
+ *      ClosedHash, ClosedEqual).
+ *
+ *
+ *  Class' methods:
+ *
+ *  ->  hash(const State *):
+ *          Hash of a state, as used by the other methods.
+ *
+ *  ->  prefetch(uint64_t hash):
+ *          Hints the slot of the hash into the cache.
+ *
+ *  ->  contains(const State *, uint64_t hash):
+ *          True if an equal state is in the set.
+ *
+ *  ->  insert(State *, uint64_t hash):
+ *          Adds a state that is not in the set (the set does not own it).
+ *
+ *  ->  probeLength(const State *, uint64_t hash):
+ *          Number of slots contains() reads for the state.
+ *
+ *  ->  forEach(Function f):
+ *          Calls f(State *) for every state of the set.
+ *
+ *  ->  count():
+ *          Number of states in the set.
+ */
+
+template <size_t size>
+class ClosedSet
+{
+private:
+    struct Slot
+    {
+        uint64_t hash;
+        State<size>* state;                     // nullptr if free.
+    };
+
+    std::vector<Slot> m_slots;
+    size_t m_mask;
+    size_t m_count;
+
+    ClosedHash<size> m_hash;
+    ClosedEqual<size> m_equal;
+
+    void grow()
+    {
+        std::vector<Slot> old(2 * m_slots.size(), Slot{ 0, nullptr });
+
+        size_t i;
+
+        old.swap(m_slots);
+        m_mask = m_slots.size() - 1;
+
+        for (const Slot& slot : old)
+        {
+            if (slot.state == nullptr) continue;
+
+            for (i = slot.hash & m_mask; m_slots[i].state != nullptr; i = (i + 1) & m_mask);
+
+            m_slots[i] = slot;
+        }
+    }
+
+public:
+    ClosedSet(size_t capacity, bool relabel) : m_count(0), m_hash{ relabel }, m_equal{ relabel }
+    {
+        size_t slots = 16;
+
+        while (slots < capacity) {
+            slots *= 2;
+        }
+        m_slots.assign(slots, Slot{ 0, nullptr });
+        m_mask = slots - 1;
+    }
+
+    uint64_t hash(const State<size>* s) const { return m_hash(s); }
+
+    void prefetch(uint64_t hash) const { PREFETCH(&m_slots[hash & m_mask]); }
+
+    bool contains(const State<size>* s, uint64_t hash) const
+    {
+        for (size_t i = hash & m_mask; m_slots[i].state != nullptr; i = (i + 1) & m_mask)
+        {
+            if (m_slots[i].hash == hash && m_equal(m_slots[i].state, s)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void insert(State<size>* s, uint64_t hash)
+    {
+        size_t i;
+
+        if (4 * (m_count + 1) > 3 * m_slots.size()) {
+            grow();
+        }
+        for (i = hash & m_mask; m_slots[i].state != nullptr; i = (i + 1) & m_mask);
+
+        m_slots[i] = Slot{ hash, s };
+        m_count += 1;
+    }
+
+    size_t probeLength(const State<size>* s, uint64_t hash) const
+    {
+        size_t length = 1;
+
+        for (size_t i = hash & m_mask; m_slots[i].state != nullptr; i = (i + 1) & m_mask, ++length)
+        {
+            if (m_slots[i].hash == hash && m_equal(m_slots[i].state, s)) {
+                break;
+            }
+        }
+        return length;
+    }
+
+    template <typename Function>
+    void forEach(Function f) const
+    {
+        for (const Slot& slot : m_slots) {
+            if (slot.state != nullptr) {
+                f(slot.state);
+            }
+        }
+    }
+
+    void clear()
+    {
+        m_slots.assign(m_slots.size(), Slot{ 0, nullptr });
+        m_count = 0;
+    }
+
+    size_t count() const { return m_count; }
+};
@@ -0,0 +1,340 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <algorithm>
+
+#include "State.h"
+#include "Cancel.h"
+#include "Checkpoint.h"
+#include "Retrograde.h"
+#include "CompactStateSet.h"
+#include "EndgameDatabase.h"
+
+
+/*
+ *  Compact Breadth First Search:
+ *
+ *      Exact, memory-lean variant of BFS() that stores no State objects.
+ *      The search proceeds layer by layer and every visited state is kept
+ *      only as its packed key, tagged with its depth, in a CompactStateSet.
+ *
+ *      The children of a layer are gathered in chunks of COMPACT_CHUNK_KEYS
+ *      raw keys; each chunk is sorted, stripped of duplicates and of visited
+ *      states and encoded as a sorted run. At the end of the layer the runs
+ *      are merged into the next layer, which is then merged into the visited
+ *      set.
+ *
+ *      As no parent pointers are kept, the solution is recovered backwards
+ *      from the goal: for every state, the pours that could have produced it
+ *      are undone (see: Retrograde.h) and a visited predecessor one layer
+ *      shallower is looked up.
+ *
+ *
+ *      Between two layers the visited set is the whole state of the search,
+ *      so it can be checkpointed and resumed (see: Checkpoint.h). The set is
+ *      written while the next layer is expanded, which only reads it; the
+ *      write must complete before the set is replaced at the end of that
+ *      layer.
+ *
+ *
+ *  ->  compactBFS(initial, examined, memory, peakBytes, endgame, checkpoint, report, cancel):
+ *          Returns the solution path (see also: State::copyWholePath()) or
+ *          nullptr if none exists. `memory` is set to the peak number of
+ *          states stored and `peakBytes` to the peak memory they took.
+ *          If `endgame` is given, the search stops at the first state found
+ *          in the endgame database, as BFS() does.
+ *          If `checkpoint` is given, the search is checkpointed to its
+ *          directory and possibly resumed from it; the outcome (or why the
+ *          search could not be resumed, in which case nullptr is returned)
+ *          is written to `report`.
+ *          If `cancel` is set (see: Cancel.h), the search stops and returns
+ *          nullptr; the partial layer is not checkpointed.
+ *
+ *  ->  findPredecessor(key, accept, predecessor, from, to):
+ *          Finds a state accepted by `accept` (e.g. one visited at a given
+ *          depth) from which pouring bottle `from` into bottle `to` (0-based)
+ *          yields `key`.
+ */
+
+constexpr size_t COMPACT_CHUNK_KEYS = static_cast<size_t>(1) << 20;
+
+template <size_t size, typename Accept>
+bool findPredecessor(const uint8_t* key, Accept accept, uint8_t* predecessor, int& from, int& to)
+{
+    Bottle state[size];
+
+    memcpy(state, key, sizeof(state));
+
+    return forEachPredecessor<size>(state, [&](const Bottle* candidate, int f, int t)
+    {
+        if (!accept(reinterpret_cast<const uint8_t*>(candidate))) {
+            return false;
+        }
+        memcpy(predecessor, candidate, sizeof(state));
+        from = f;
+        to = t;
+
+        return true;
+    });
+}
+
+template <size_t size>
+State<size>* compactBFS(
+    State<size>& initial, uint64_t& examined, uint64_t& memory, uint64_t& peakBytes,
+    const EndgameLookup<size>* endgame = nullptr,
+    const CheckpointOptions* checkpoint = nullptr, CheckpointReport* report = nullptr,
+    const std::atomic<bool>* cancel = nullptr)
+{
+    constexpr size_t KEY_BYTES = CompactStateSet<size>::KEY_BYTES;
+
+    typedef std::array<uint8_t, KEY_BYTES> raw_key_t;
+
+    CompactStateSet<size> visited;
+    CompactStateSet<size> layer;
+    CompactStateSet<size> merged;
+
+    std::vector<CompactStateSet<size>> runs;    // Sorted chunks of the next layer.
+    std::vector<raw_key_t> chunk;
+
+    std::vector<std::pair<int, int>> moves;     // Pours of the solution, from the goal backwards.
+
+    CheckpointReport unreported;
+    CheckpointReport& checkpoints = (report != nullptr ? *report : unreported);
+
+    std::unique_ptr<CheckpointWriter> writer;   // Destroyed (thus done writing) before the sets it reads.
+
+    Bottle bottles[size];
+    Bottle child[size];
+
+    uint8_t start[KEY_BYTES];
+    uint8_t goal[KEY_BYTES];
+    uint8_t key[KEY_BYTES];
+
+    State<size>* result;
+
+    int depth = 0;
+    int distance = 0;                           // Moves left from the state found to the goal.
+    int from;
+    int to;
+
+    uint8_t tag;
+
+    bool found = false;
+
+    auto endgameDistance = [endgame](const Bottle* b) { return (endgame != nullptr ? endgame->distance(b) : -1); };
+
+    auto account = [&]()
+    {
+        uint64_t states = visited.count() + chunk.size();
+        uint64_t bytes = visited.bytes() + layer.bytes() + merged.bytes() + chunk.capacity() * sizeof(raw_key_t);
+
+        for (const CompactStateSet<size>& r : runs)
+        {
+            states += r.count();
+            bytes += r.bytes();
+        }
+        memory = std::max(memory, states);
+        peakBytes = std::max(peakBytes, bytes);
+    };
+
+    // Sorted, deduplicated and unvisited keys of the chunk become a run of the next layer.
+    auto flush = [&]()
+    {
+        typename CompactStateSet<size>::Builder builder;
+
+        std::sort(chunk.begin(), chunk.end(), [](const raw_key_t& a, const raw_key_t& b) {
+            return CompactStateSet<size>::less(a.data(), b.data());
+        });
+        chunk.erase(std::unique(chunk.begin(), chunk.end()), chunk.end());
+
+        for (const raw_key_t& k : chunk) {
+            if (!visited.contains(k.data())) {
+                builder.append(k.data(), static_cast<uint8_t>(depth + 1));
+            }
+        }
+        runs.emplace_back();
+        builder.finish(runs.back());
+
+        account();
+        chunk.clear();
+    };
+
+    // Visited set and current layer of the directory's checkpoint, if any (false if it cannot be used).
+    auto resume = [&]()
+    {
+        typename CompactStateSet<size>::Builder builder;
+
+        CheckpointHeader header;
+
+        std::vector<uint8_t> puzzle;
+        std::vector<uint8_t> data;
+
+        if (!readCheckpoint(checkpoint->directory, header, puzzle, data, checkpoints.error)) {
+            return checkpoints.error.empty();
+        }
+        if (header.bottles != size || memcmp(puzzle.data(), start, KEY_BYTES) != 0)
+        {
+            checkpoints.error = "the checkpoint belongs to another puzzle";
+            return false;
+        }
+        if (!visited.assign(std::move(data), header.count))
+        {
+            checkpoints.error = "the checkpoint is corrupt";
+            return false;
+        }
+        typename CompactStateSet<size>::Cursor cursor(visited);
+
+        while (cursor.next()) {
+            if (cursor.tag() == header.depth) {
+                builder.append(cursor.key(), cursor.tag());
+            }
+        }
+        builder.finish(layer);
+
+        depth = header.depth;
+        examined = header.examined;
+        checkpoints.resumedDepth = depth;
+
+        return true;
+    };
+
+    examined = 0;
+    memory = 1;
+    peakBytes = 0;
+
+    memcpy(start, initial.getBottles(), KEY_BYTES);
+
+    if (initial.isVictorious()) {
+        return initial.copyWholePath();
+    }
+    if ((distance = endgameDistance(initial.getBottles())) >= 0) {
+        return endgame->finish(initial.copyWholePath(), distance);
+    }
+
+    if (checkpoint != nullptr)
+    {
+        writer.reset(new CheckpointWriter(*checkpoint, &checkpoints));
+
+        if (checkpoint->resume && !resume()) {
+            return nullptr;
+        }
+    }
+    if (checkpoints.resumedDepth < 0)
+    {
+        typename CompactStateSet<size>::Builder builder;
+
+        builder.append(start, 0);
+        builder.finish(layer);
+        mergeSets(layer, CompactStateSet<size>(), visited);
+    }
+    while (!layer.empty() && !found && depth < 254)
+    {
+        typename CompactStateSet<size>::Cursor cursor(layer);
+
+        while (!found && !cancelled(cancel) && cursor.next())
+        {
+            examined += 1;
+
+            memcpy(bottles, cursor.key(), KEY_BYTES);
+
+            for (from = 0; from < static_cast<int>(size) && !found; ++from)
+            {
+                for (to = 0; to < static_cast<int>(size); ++to)
+                {
+                    if (from == to || !bottles[from].shouldPourTo(bottles[to])) continue;
+
+                    memcpy(child, bottles, KEY_BYTES);
+                    child[from].pour(child[to]);
+
+                    // Goal state (or endgame state) reached: its parent and the pour are known.
+                    if ((distance = (isGoal<size>(child) ? 0 : endgameDistance(child))) >= 0)
+                    {
+                        memcpy(goal, cursor.key(), KEY_BYTES);
+                        moves.push_back({ from, to });
+                        found = true;
+                        break;
+                    }
+                    chunk.emplace_back();
+                    memcpy(chunk.back().data(), child, KEY_BYTES);
+
+                    if (chunk.size() >= COMPACT_CHUNK_KEYS) {
+                        flush();
+                    }
+                }
+            }
+        }
+        if (found || cancelled(cancel)) break;
+
+        flush();
+
+        // Merge of the runs into the next layer, pairwise.
+        while (runs.size() > 1)
+        {
+            mergeSets(runs[runs.size() - 2], runs[runs.size() - 1], merged);
+
+            runs.pop_back();
+            runs.back() = std::move(merged);
+            merged = CompactStateSet<size>();
+
+            account();
+        }
+        layer = std::move(runs.back());
+        runs.clear();
+
+        mergeSets(visited, layer, merged);
+        account();
+
+        // A checkpoint of the previous set must be complete before the set is released.
+        if (writer != nullptr) {
+            writer->wait();
+        }
+        visited = std::move(merged);
+        merged = CompactStateSet<size>();
+
+        depth += 1;
+
+        if (writer != nullptr && writer->due())
+        {
+            CheckpointHeader header;
+
+            header.bottles = size;
+            header.depth = depth;
+            header.count = visited.count();
+            header.examined = examined;
+
+            writer->start(header, start, KEY_BYTES, visited.data().data(), visited.data().size());
+        }
+    }
+    writer.reset();
+
+    chunk = std::vector<raw_key_t>();
+    runs.clear();
+
+    if (!found) {
+        return nullptr;
+    }
+
+    // Walk back from the goal's parent (at `depth`) to the initial state.
+    for (int d = depth; d > 0; --d)
+    {
+        auto visitedAt = [&](const uint8_t* k) { return visited.find(k, tag) && tag == d - 1; };
+
+        if (!findPredecessor<size>(goal, visitedAt, key, from, to)) {
+            return nullptr;
+        }
+        moves.push_back({ from, to });
+        memcpy(goal, key, KEY_BYTES);
+    }
+    std::reverse(moves.begin(), moves.end());
+
+    result = new State<size>(initial);
+
+    for (const auto& m : moves) {
+        result = result->move(m.first, m.second);
+    }
+    return (distance > 0 ? endgame->finish(result, distance) : result);
+}
@@ -0,0 +1,338 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#include "Bottle.h"
+
+
+/*
+ *  CompactStateSet class:
+ *
+ *      Exact, read-only set of packed state keys (the raw bytes of a state's
+ *      bottles, see: StateKey), each tagged with a small value (its depth).
+ *      Keys are kept sorted (byte-wise) and front coded in blocks of
+ *      BLOCK_ENTRIES: every entry stores only the number of leading bytes it
+ *      shares with the previous key, the remaining bytes and its tag. The
+ *      first key of each block is also kept uncompressed in a small index,
+ *      so a lookup is a binary search over the index (mostly on the keys'
+ *      leading 8 bytes) followed by a sequential scan of a single block.
+ *
+ *      Neighbouring keys of a sorted set share most of their bottles, so an
+ *      entry takes a few bytes instead of a full State plus the nodes of a
+ *      hash set.
+ *
+ *      Entry:  [shared prefix length : 1] [suffix : KEY_BYTES - prefix] [tag : 1]
+ *
+ *
+ *  Class' methods:
+ *
+ *  ->  find(const uint8_t *key, uint8_t &tag):
+ *          True if the key is in the set; its tag is returned by reference.
+ *
+ *  ->  bytes():
+ *          Memory held by the encoded entries and the index.
+ *
+ *  ->  data():
+ *          The encoded entries, e.g. for saving the set (see: Checkpoint.h).
+ *
+ *  ->  assign(std::vector<uint8_t> &&data, uint64_t count):
+ *          Takes over `count` encoded entries and rebuilds the index; false
+ *          (and an empty set) if they are not a valid encoding.
+ *
+ *
+ *  CompactStateSet::Builder class:
+ *
+ *  ->  append(const uint8_t *key, uint8_t tag):
+ *          Appends a key, which must be greater than the previous one.
+ *
+ *  ->  finish(CompactStateSet &):
+ *          Moves the built set into the given one.
+ *
+ *
+ *  CompactStateSet::Cursor class:
+ *
+ *      Sequential reader of the set's entries, in key order.
+ *
+ *  ->  next():
+ *          Advances to the next entry; false once past the last one.
+ *
+ *  ->  key(), tag():
+ *          Contents of the current entry.
+ *
+ *
+ *  ->  mergeSets(const CompactStateSet &a, const CompactStateSet &b, CompactStateSet &out):
+ *          Union of two sets (the entry of `a` wins for keys found in both).
+ */
+
+template <size_t size>
+class CompactStateSet
+{
+public:
+    static constexpr size_t KEY_BYTES = size * BOTTLE_SIZE;
+    static constexpr size_t BLOCK_ENTRIES = 32;
+
+    // Byte-wise order of the keys.
+    static bool less(const uint8_t* a, const uint8_t* b) { return memcmp(a, b, KEY_BYTES) < 0; }
+
+    // First 8 bytes of a key as an integer of the same order.
+    static uint64_t leadingWord(const uint8_t* key)
+    {
+        uint64_t w = 0;
+
+        for (size_t i = 0; i < 8; ++i) {
+            w = (w << 8) | (i < KEY_BYTES ? key[i] : 0);
+        }
+        return w;
+    }
+
+    class Builder;
+    class Cursor;
+
+private:
+    std::vector<uint8_t> m_data;            // Encoded entries.
+    std::vector<uint8_t> m_firstKeys;       // First key of every block.
+    std::vector<uint64_t> m_firstWords;     // Leading word of the first key of every block.
+    std::vector<uint64_t> m_offsets;        // Offset of every block in m_data.
+
+    uint64_t m_count = 0;
+
+public:
+    uint64_t count() const { return m_count; }
+
+    bool empty() const { return m_count == 0; }
+
+    size_t bytes() const
+    {
+        return m_data.capacity() + m_firstKeys.capacity() + (m_firstWords.capacity() + m_offsets.capacity()) * sizeof(uint64_t);
+    }
+
+    const std::vector<uint8_t>& data() const { return m_data; }
+
+    bool assign(std::vector<uint8_t>&& data, uint64_t count)
+    {
+        size_t pos = 0;
+        size_t prefix;
+
+        clear();
+
+        for (uint64_t i = 0; i < count; ++i)
+        {
+            if (pos >= data.size() || (prefix = data[pos]) > KEY_BYTES || (i % BLOCK_ENTRIES == 0 && prefix != 0)
+                || pos + 2 + KEY_BYTES - prefix > data.size())
+            {
+                clear();
+                return false;
+            }
+            if (i % BLOCK_ENTRIES == 0)
+            {
+                m_offsets.push_back(pos);
+                m_firstKeys.insert(m_firstKeys.end(), data.begin() + pos + 1, data.begin() + pos + 1 + KEY_BYTES);
+                m_firstWords.push_back(leadingWord(&data[pos + 1]));
+            }
+            pos += 2 + KEY_BYTES - prefix;
+        }
+        if (pos != data.size())
+        {
+            clear();
+            return false;
+        }
+        m_data = std::move(data);
+        m_count = count;
+
+        return true;
+    }
+
+    void clear()
+    {
+        std::vector<uint8_t>().swap(m_data);
+        std::vector<uint8_t>().swap(m_firstKeys);
+        std::vector<uint64_t>().swap(m_firstWords);
+        std::vector<uint64_t>().swap(m_offsets);
+
+        m_count = 0;
+    }
+
+    bool find(const uint8_t* key, uint8_t& tag) const
+    {
+        size_t lo = 0;
+        size_t hi = m_offsets.size();
+        size_t mid;
+        size_t end;
+        size_t prefix;
+        size_t match = 0;       // Leading bytes the previous entry shares with the key.
+        size_t pos;
+        size_t i;
+
+        const uint64_t word = leadingWord(key);
+
+        if (m_count == 0 || less(key, m_firstKeys.data())) {
+            return false;
+        }
+
+        // Last block whose first key is not greater than the key (whole keys are
+        // only compared when their leading words are equal).
+        while (hi - lo > 1)
+        {
+            mid = (lo + hi) / 2;
+
+            if (word != m_firstWords[mid] ? word < m_firstWords[mid] : less(key, m_firstKeys.data() + mid * KEY_BYTES))
+                hi = mid;
+            else
+                lo = mid;
+        }
+        pos = m_offsets[lo];
+        end = (lo + 1 < m_offsets.size() ? m_offsets[lo + 1] : m_data.size());
+
+        // Entries are never fully decoded: the previous entry is smaller than the key
+        // and agrees with it on `match` bytes, so each entry's shared prefix alone
+        // tells whether it is still smaller, already greater, or must be compared.
+        while (pos < end)
+        {
+            prefix = m_data[pos];
+
+            if (prefix < match) {
+                return false;
+            }
+            if (prefix == match)
+            {
+                for (i = match; i < KEY_BYTES && m_data[pos + 1 + i - prefix] == key[i]; ++i);
+
+                if (i == KEY_BYTES)
+                {
+                    tag = m_data[pos + 1 + KEY_BYTES - prefix];
+                    return true;
+                }
+                if (m_data[pos + 1 + i - prefix] > key[i]) {
+                    return false;
+                }
+                match = i;
+            }
+            pos += 2 + KEY_BYTES - prefix;
+        }
+        return false;
+    }
+
+    bool contains(const uint8_t* key) const
+    {
+        uint8_t tag;
+
+        return find(key, tag);
+    }
+
+    class Builder
+    {
+    private:
+        CompactStateSet m_set;
+
+        uint8_t m_previous[KEY_BYTES];
+
+    public:
+        void append(const uint8_t* key, uint8_t tag)
+        {
+            size_t prefix = 0;
+
+            if (m_set.m_count % BLOCK_ENTRIES == 0)
+            {
+                // Blocks start with a whole key, so that they can be decoded on their own.
+                m_set.m_offsets.push_back(m_set.m_data.size());
+                m_set.m_firstKeys.insert(m_set.m_firstKeys.end(), key, key + KEY_BYTES);
+                m_set.m_firstWords.push_back(leadingWord(key));
+            }
+            else
+            {
+                while (prefix < KEY_BYTES && key[prefix] == m_previous[prefix]) {
+                    prefix += 1;
+                }
+            }
+            m_set.m_data.push_back(static_cast<uint8_t>(prefix));
+            m_set.m_data.insert(m_set.m_data.end(), key + prefix, key + KEY_BYTES);
+            m_set.m_data.push_back(tag);
+
+            memcpy(m_previous, key, KEY_BYTES);
+            m_set.m_count += 1;
+        }
+
+        void finish(CompactStateSet& out)
+        {
+            m_set.m_data.shrink_to_fit();
+            m_set.m_firstKeys.shrink_to_fit();
+            m_set.m_firstWords.shrink_to_fit();
+            m_set.m_offsets.shrink_to_fit();
+
+            out = std::move(m_set);
+            m_set = CompactStateSet();
+        }
+    };
+
+    class Cursor
+    {
+    private:
+        const CompactStateSet* m_set;
+
+        size_t m_pos = 0;
+
+        uint8_t m_key[KEY_BYTES];
+        uint8_t m_tag = 0;
+
+    public:
+        explicit Cursor(const CompactStateSet& set) : m_set(&set) {}
+
+        bool next()
+        {
+            size_t prefix;
+
+            if (m_pos >= m_set->m_data.size()) {
+                return false;
+            }
+            prefix = m_set->m_data[m_pos++];
+
+            memcpy(m_key + prefix, &m_set->m_data[m_pos], KEY_BYTES - prefix);
+            m_pos += KEY_BYTES - prefix;
+            m_tag = m_set->m_data[m_pos++];
+
+            return true;
+        }
+
+        const uint8_t* key() const { return m_key; }
+
+        uint8_t tag() const { return m_tag; }
+    };
+};
+
+template <size_t size>
+void mergeSets(const CompactStateSet<size>& a, const CompactStateSet<size>& b, CompactStateSet<size>& out)
+{
+    typename CompactStateSet<size>::Builder builder;
+    typename CompactStateSet<size>::Cursor ca(a);
+    typename CompactStateSet<size>::Cursor cb(b);
+
+    bool hasA = ca.next();
+    bool hasB = cb.next();
+
+    int cmp;
+
+    while (hasA || hasB)
+    {
+        cmp = (!hasA ? 1 : !hasB ? -1 : memcmp(ca.key(), cb.key(), CompactStateSet<size>::KEY_BYTES));
+
+        if (cmp <= 0)
+        {
+            builder.append(ca.key(), ca.tag());
+
+            if (cmp == 0) {
+                hasB = cb.next();
+            }
+            hasA = ca.next();
+        }
+        else
+        {
+            builder.append(cb.key(), cb.tag());
+            hasB = cb.next();
+        }
+    }
+    builder.finish(out);
+}
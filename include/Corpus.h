@@ -0,0 +1,123 @@
+#pragma once
+
+#include <string>
+#include <fstream>
+#include <cstddef>
+#include <cstdint>
+
+#include "Bottle.h"
+#include "State.h"
+#include "MappedFile.h"
+
+
+/*
+ *  Binary puzzle corpus:
+ *
+ *      A versioned file of start positions sharing the same number of bottles.
+ *      It consists of a fixed 32-byte header followed by fixed-size records,
+ *      each holding the packed bytes of a puzzle's bottles (see Bottle::getByte())
+ *      in bottle order. All header fields are stored little-endian.
+ *
+ *          offset  size  field
+ *          0       4     magic "WSPC"
+ *          4       2     format version (CORPUS_VERSION)
+ *          6       2     number of bottles per puzzle
+ *          8       4     record size in bytes (bottles * BOTTLE_SIZE)
+ *          12      1     bottle layout (BOTTLE_LAYOUT, see: Bottle.h)
+ *          13      3     reserved (0)
+ *          16      8     number of records
+ *          24      8     reserved (0)
+ *
+ *
+ *  CorpusWriter class:
+ *
+ *  ->  open(const std::string &path, size_t bottles):
+ *          Creates the corpus file (truncating any existing one).
+ *
+ *  ->  write(const Bottle *):
+ *          Appends a record made of the given bottles.
+ *
+ *  ->  close():
+ *          Patches the record count into the header and closes the file.
+ *          Called by the destructor if omitted.
+ *
+ *
+ *  CorpusReader class:
+ *
+ *      Memory-maps the corpus, so that records are read in place
+ *      and loading costs nothing compared to solving them.
+ *
+ *  ->  open(const std::string &path, std::string &error):
+ *          Maps and validates the corpus.
+ *
+ *  ->  bottlesAt(size_t i):
+ *          View of the i-th record's bottles, pointing into the mapping.
+ *
+ *  ->  stateAt<size>(size_t i):
+ *          The i-th record as an initial State<size>.
+ *
+ *  ->  isCorpus(const std::string &path):
+ *          True if the file starts with the corpus magic.
+ */
+
+constexpr char     CORPUS_MAGIC[4] = { 'W', 'S', 'P', 'C' };
+constexpr uint16_t CORPUS_VERSION = 1;
+constexpr size_t   CORPUS_HEADER_SIZE = 32;
+
+class CorpusWriter
+{
+private:
+    std::ofstream m_file;
+
+    size_t m_bottles;
+    uint64_t m_count;
+
+public:
+    CorpusWriter() : m_bottles(0), m_count(0) {}
+
+    CorpusWriter(const CorpusWriter&) = delete;
+
+    ~CorpusWriter() { close(); }
+
+    bool open(const std::string& path, size_t bottles);
+
+    bool write(const Bottle* bottles);
+
+    bool close();
+
+    uint64_t count() const { return m_count; }
+};
+
+class CorpusReader
+{
+private:
+    MappedFile m_mapping;
+
+    const uint8_t* m_records;
+
+    size_t m_bottles;
+    size_t m_recordBytes;
+    uint64_t m_count;
+
+public:
+    CorpusReader() : m_records(nullptr), m_bottles(0), m_recordBytes(0), m_count(0) {}
+
+    CorpusReader(const CorpusReader&) = delete;
+
+    bool open(const std::string& path, std::string& error);
+
+    static bool isCorpus(const std::string& path);
+
+    size_t bottles() const { return m_bottles; }
+
+    uint64_t size() const { return m_count; }
+
+    const Bottle* bottlesAt(uint64_t i) const {
+        return reinterpret_cast<const Bottle*>(m_records + i * m_recordBytes);
+    }
+
+    template <size_t size>
+    State<size> stateAt(uint64_t i) const {
+        return State<size>(bottlesAt(i));
+    }
+};
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <algorithm>
+
+#include "BFS.h"
+#include "State.h"
+#include "Cancel.h"
+#include "CompactBFS.h"
+#include "StateRanker.h"
+
+
+/*
+ *  Dense Breadth First Search:
+ *
+ *      Variant of BFS() for puzzles whose whole state space can be ranked
+ *      (see: StateRanker.h) within DENSE_MAX_STATES. Instead of a hash set
+ *      of states, a flat array holds one byte per rank: 0 for states never
+ *      seen and depth + 1 for visited ones. The frontier is a list of ranks
+ *      and states are only materialized (unranked) to be expanded, so the
+ *      search takes one byte per possible state plus 8 per frontier state,
+ *      with no hashing, no allocation and no collisions.
+ *
+ *      The depths also replace the parent pointers: the solution is walked
+ *      back from the goal by undoing pours (see: findPredecessor()) and
+ *      looking for a predecessor visited one layer shallower. A pour cannot
+ *      be undone from its bottles alone (the amount poured is unknown), so
+ *      a parent move per state would not be enough.
+ *
+ *      Larger puzzles are solved by the regular BFS().
+ *
+ *
+ *  ->  denseBFS(initial, examined, memory, tableBytes, ranked, cancel):
+ *          Returns the solution path (see also: State::copyWholePath()) or
+ *          nullptr if none exists or the search was cancelled (see: Cancel.h).
+ *          `tableBytes` is set to the memory of the depth table and frontier,
+ *          and `ranked` to whether the dense search was used rather than BFS().
+ */
+
+constexpr uint64_t DENSE_MAX_STATES = static_cast<uint64_t>(1) << 30;   // One gigabyte of depths
+
+template <size_t size>
+State<size>* denseBFS(State<size>& initial, uint64_t& examined, uint64_t& memory, uint64_t& tableBytes, bool& ranked,
+    const std::atomic<bool>* cancel = nullptr)
+{
+    constexpr size_t KEY_BYTES = size * BOTTLE_SIZE;
+
+    StateRanker<size> ranker(initial.getBottles());
+
+    std::vector<uint8_t> depths;                // Depth + 1 of every rank, 0 if never seen.
+    std::vector<uint64_t> layer;
+    std::vector<uint64_t> next;
+
+    std::vector<std::pair<int, int>> moves;     // Pours of the solution, from the goal backwards.
+
+    Bottle bottles[size];
+    Bottle child[size];
+    Bottle goal[size];
+    Bottle predecessor[size];
+
+    State<size>* result;
+
+    uint64_t r;
+    uint64_t visited = 1;
+
+    int depth = 0;
+    int from;
+    int to;
+
+    bool found = false;
+
+    ranked = ranker.rankable() && ranker.states() <= DENSE_MAX_STATES;
+    tableBytes = 0;
+
+    if (!ranked) {
+        return BFS<size>(initial, examined, memory, nullptr, nullptr, false, cancel);
+    }
+
+    examined = 0;
+    memory = 1;
+
+    if (initial.isVictorious()) {
+        return initial.copyWholePath();
+    }
+    depths.assign(ranker.states(), 0);
+
+    r = ranker.rank(initial.getBottles());
+    depths[r] = 1;
+    layer.push_back(r);
+
+    while (!layer.empty() && !found && depth < 254 && !cancelled(cancel))
+    {
+        for (size_t i = 0; i < layer.size() && !found && !cancelled(cancel); ++i)
+        {
+            examined += 1;
+
+            ranker.unrank(layer[i], bottles);
+
+            for (from = 0; from < static_cast<int>(size) && !found; ++from)
+            {
+                for (to = 0; to < static_cast<int>(size); ++to)
+                {
+                    if (from == to || !bottles[from].shouldPourTo(bottles[to])) continue;
+
+                    memcpy(child, bottles, KEY_BYTES);
+                    child[from].pour(child[to]);
+
+                    // Goal state reached: its parent and the pour are known.
+                    if (isGoal<size>(child))
+                    {
+                        memcpy(goal, bottles, KEY_BYTES);
+                        moves.push_back({ from, to });
+                        found = true;
+                        break;
+                    }
+                    r = ranker.rank(child);
+
+                    if (depths[r] == 0)
+                    {
+                        depths[r] = static_cast<uint8_t>(depth + 2);
+                        next.push_back(r);
+                        visited += 1;
+                    }
+                }
+            }
+        }
+        memory = std::max(memory, visited);
+        tableBytes = std::max<uint64_t>(tableBytes, depths.size() + (layer.capacity() + next.capacity()) * sizeof(uint64_t));
+
+        layer.swap(next);
+        next.clear();
+
+        depth += (found ? 0 : 1);
+    }
+    std::vector<uint64_t>().swap(layer);
+    std::vector<uint64_t>().swap(next);
+
+    if (!found) {
+        return nullptr;
+    }
+
+    // Walk back from the goal's parent (at `depth`) to the initial state.
+    for (int d = depth; d > 0; --d)
+    {
+        auto visitedAt = [&](const uint8_t* k) {
+            return depths[ranker.rank(reinterpret_cast<const Bottle*>(k))] == d;
+        };
+
+        if (!findPredecessor<size>(reinterpret_cast<const uint8_t*>(goal), visitedAt,
+            reinterpret_cast<uint8_t*>(predecessor), from, to))
+        {
+            return nullptr;
+        }
+        moves.push_back({ from, to });
+        memcpy(goal, predecessor, KEY_BYTES);
+    }
+    std::reverse(moves.begin(), moves.end());
+
+    result = new State<size>(initial);
+
+    for (const auto& m : moves) {
+        result = result->move(m.first, m.second);
+    }
+    return result;
+}
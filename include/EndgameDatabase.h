@@ -0,0 +1,257 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "Bottle.h"
+#include "State.h"
+#include "MappedFile.h"
+
+
+/*
+ *  Endgame databases:
+ *
+ *      Exact distance to the goal of every state within `radius` moves of
+ *      it, generated by retrograde analysis: a BFS from the solved position
+ *      over the inverse of Bottle::pour() (see: Retrograde.h).
+ *
+ *      The distance of a state does not depend on the order of its bottles
+ *      nor on the names of its colors, so states are stored canonically:
+ *      the puzzle's colors are renumbered 1, 2, ... in increasing order of
+ *      their codes (a renaming fixed for the whole puzzle, as pours never
+ *      change the set of colors) and the bottles are sorted. Every state of
+ *      the endgame thus has exactly one entry, and puzzles of the same
+ *      numbers of bottles and colors share the database.
+ *
+ *      Since the database holds every state within `radius` moves, the first
+ *      entry met by a breadth-first search lies on an optimal solution: an
+ *      optimal path of d moves passes through an entry at depth d - radius,
+ *      so no entry is met before it. The search can stop there, skipping
+ *      its deepest and widest layers, and the rest of the solution is read
+ *      from the database (see: EndgameLookup::finish()).
+ *
+ *      File (all fields little-endian): a 32-byte header followed by the
+ *      records, sorted by key. A record is the canonical bottles
+ *      (BOTTLE_SIZE bytes per bottle, see: BOTTLE_LAYOUT in Bottle.h)
+ *      followed by their distance (1 byte).
+ *
+ *          offset  size  field
+ *          0       4     magic "WSEG"
+ *          4       2     format version (ENDGAME_VERSION)
+ *          6       1     number of bottles
+ *          7       1     number of colors
+ *          8       1     radius
+ *          9       1     bottle layout (BOTTLE_LAYOUT, see: Bottle.h)
+ *          10      6     reserved (0)
+ *          16      8     number of records
+ *          24      8     reserved (0)
+ *
+ *
+ *  ->  buildEndgameDatabase(path, options, report, error):
+ *          Generates a database and writes it to `path`.
+ *
+ *
+ *  EndgameDatabase class:
+ *
+ *      Read-only, memory-mapped database, safe to share between threads.
+ *
+ *  ->  open(const std::string &path, std::string &error):
+ *          Maps and validates a database file.
+ *
+ *  ->  find(const uint8_t *key, int &distance):
+ *          Binary search of a canonical key.
+ *
+ *
+ *  EndgameLookup class:
+ *
+ *      Lookup of a database for the states of a given puzzle, which must
+ *      have the database's numbers of bottles and colors (see: active()).
+ *
+ *  ->  lookup(const Bottle *):
+ *          Distance of the given bottles to the goal, -1 if not in the database.
+ *
+ *  ->  distance(const Bottle *):
+ *          Same as lookup(), but only searches the database for states whose
+ *          admissible heuristic (see: State::heuristic()) is within its
+ *          radius, which spares the lookup of most states met by a search.
+ *
+ *  ->  finish(State *, int distance):
+ *          Extends the path of a state found at the given distance with an
+ *          optimal sequence of pours to the goal, following the database.
+ */
+
+constexpr uint16_t ENDGAME_VERSION = 1;
+constexpr size_t ENDGAME_HEADER_SIZE = 32;
+
+struct EndgameBuildOptions
+{
+    size_t bottles = 8;
+    size_t colors = 0;                  // Defaults to bottles - 2.
+    int radius = 6;
+};
+
+struct EndgameBuildReport
+{
+    uint64_t records = 0;
+    std::vector<uint64_t> histogram;    // Number of records at every distance.
+    double elapsedMs = 0;
+};
+
+bool buildEndgameDatabase(const std::string& path, const EndgameBuildOptions& options, EndgameBuildReport& report, std::string& error);
+
+// Sorts the n bottles in place, in byte order, so that permutations of a state share a key.
+inline void sortBottles(Bottle* bottles, size_t n)
+{
+    Bottle b;
+
+    size_t i;
+    size_t j;
+
+    for (i = 1; i < n; ++i)
+    {
+        b = bottles[i];
+
+        for (j = i; j > 0 && memcmp(&bottles[j - 1], &b, BOTTLE_SIZE) > 0; --j) {
+            bottles[j] = bottles[j - 1];
+        }
+        bottles[j] = b;
+    }
+}
+
+class EndgameDatabase
+{
+private:
+    MappedFile m_file;
+
+    size_t m_bottles;
+    size_t m_colors;
+    int m_radius;
+    uint64_t m_records;
+
+public:
+    EndgameDatabase() : m_bottles(0), m_colors(0), m_radius(0), m_records(0) {}
+
+    bool open(const std::string& path, std::string& error);
+
+    bool isOpen() const { return m_file.isOpen(); }
+
+    size_t bottles() const { return m_bottles; }
+
+    size_t colors() const { return m_colors; }
+
+    int radius() const { return m_radius; }
+
+    uint64_t records() const { return m_records; }
+
+    bool find(const uint8_t* key, int& distance) const;
+};
+
+template <size_t size>
+class EndgameLookup
+{
+private:
+    const EndgameDatabase* m_database = nullptr;
+
+    std::array<color_t, TOTAL_COLORS + 1> m_codes;      // Canonical number of every color.
+
+public:
+    EndgameLookup(const EndgameDatabase* database, const Bottle* puzzle)
+    {
+        int counts[TOTAL_COLORS + 1] = {};
+
+        size_t colors = 0;
+        size_t i;
+        size_t j;
+
+        m_codes.fill(NO_COLOR);
+
+        if (database == nullptr || !database->isOpen() || database->bottles() != size) {
+            return;
+        }
+        for (i = 0; i < size; ++i) {
+            for (j = 0; j < NUM_OF_COLORS; ++j) {
+                counts[puzzle[i].getColor(j)] += 1;
+            }
+        }
+        for (i = 1; i <= TOTAL_COLORS; ++i)
+        {
+            if (counts[i] == 0) continue;
+
+            if (counts[i] != NUM_OF_COLORS) {
+                return;
+            }
+            m_codes[i] = static_cast<color_t>(++colors);
+        }
+        if (colors == database->colors()) {
+            m_database = database;
+        }
+    }
+
+    bool active() const { return m_database != nullptr; }
+
+    int radius() const { return (m_database != nullptr ? m_database->radius() : -1); }
+
+    int lookup(const Bottle* bottles) const
+    {
+        Bottle key[size];
+
+        int distance;
+
+        size_t i;
+        size_t j;
+
+        if (m_database == nullptr) {
+            return -1;
+        }
+        for (i = 0; i < size; ++i) {
+            for (j = 0; j < NUM_OF_COLORS; ++j) {
+                key[i].setColor(j, m_codes[bottles[i].getColor(j)]);
+            }
+        }
+        sortBottles(key, size);
+
+        return (m_database->find(reinterpret_cast<const uint8_t*>(key), distance) ? distance : -1);
+    }
+
+    int distance(const Bottle* bottles) const
+    {
+        return (m_database != nullptr && State<size>(bottles).heuristic() <= m_database->radius() ? lookup(bottles) : -1);
+    }
+
+    State<size>* finish(State<size>* s, int distance) const
+    {
+        State<size>* child;
+
+        int from;
+        int to;
+
+        while (distance > 0)
+        {
+            // Some pour leads one move closer to the goal.
+            for (child = nullptr, from = 0; from < static_cast<int>(size) && child == nullptr; ++from)
+            {
+                for (to = 0; to < static_cast<int>(size); ++to)
+                {
+                    if ((child = s->move(from, to)) == nullptr) continue;
+
+                    if (lookup(child->getBottles()) == distance - 1) break;
+
+                    delete child;
+                    child = nullptr;
+                }
+            }
+            if (child == nullptr)
+            {
+                State<size>::deleteWholePath(s);
+                return nullptr;
+            }
+            s = child;
+            distance -= 1;
+        }
+        return s;
+    }
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+
+/*
+ *  Little-endian fields:
+ *
+ *      Every binary format of the project (corpora, databases, checkpoints,
+ *      allocation traces) stores its integers little-endian, whatever the
+ *      byte order of the machine that wrote them.
+ *
+ *
+ *  ->  putLE<T>(uint8_t *at, T value):
+ *          Writes the sizeof(T) bytes of an unsigned integer at `at`.
+ *
+ *  ->  getLE<T>(const uint8_t *at):
+ *          Reads an unsigned integer written by putLE().
+ */
+
+template <typename T>
+inline void putLE(uint8_t* at, T value)
+{
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        at[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+template <typename T>
+inline T getLE(const uint8_t* at)
+{
+    T value = 0;
+
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        value |= static_cast<T>(at[i]) << (8 * i);
+    }
+    return value;
+}
@@ -0,0 +1,347 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+#include "State.h"
+#include "StateKey.h"
+#include "PartitionTable.h"
+
+
+/*
+ *  Hint oracle:
+ *
+ *      Answers "what is the best move from here?" for the successive
+ *      positions of a game in progress, without searching again after
+ *      every move. The oracle keeps a distance map: the exact number of
+ *      moves to the goal of every state it has proven, and a move that
+ *      achieves it. A position found in the map is answered by a single
+ *      hash lookup.
+ *
+ *      A position outside the map is solved by a bounded search from it
+ *      that treats the states of the map as solved: a breadth-first search
+ *      over packed keys which stops at goal states and at known states
+ *      (whose distance is added to their depth) and expands nothing that
+ *      cannot beat the best total found so far (depth + State::heuristic(),
+ *      an admissible bound). The search ends once no unexpanded state can
+ *      beat that total, so the distance found is exact, and so is the
+ *      distance of every state on the path to the known state: they are all
+ *      added to the map. The first query of a game is thus an ordinary
+ *      (pruned) BFS; later ones mostly reach the known path in a few moves.
+ *
+ *      Players rarely follow every hint, so after a search the positions
+ *      up to `radius` moves off the new path are solved as well (their
+ *      searches are short, as the path is known), and the next query after
+ *      any move from a known position is usually a lookup.
+ *
+ *      An oracle is bound to a number of bottles and is not thread-safe: a
+ *      game (or a thread) owns its oracle. Hinter is the same interface for
+ *      callers that only know the number of bottles at runtime.
+ *
+ *
+ *  Class' methods:
+ *
+ *  ->  hint(const Bottle *, HintResult &):
+ *          Best move from the position, searching only if it is unknown.
+ *          Returns false if the position cannot be solved, or if a search
+ *          would have to expand more than options.maxStates states.
+ *
+ *  ->  known():
+ *          Number of states in the distance map.
+ *
+ *  ->  clear():
+ *          Forgets every state (e.g. for a new game).
+ *
+ *
+ *  ->  makeHinter(size_t n, const HintOptions &):
+ *          Oracle for puzzles of n bottles, or nullptr if n is unsupported.
+ */
+
+struct HintOptions
+{
+    int radius = 1;                     // Moves off a new solution path whose positions are solved in advance.
+    uint64_t maxStates = 10000000;      // States a single search may expand before giving up.
+};
+
+struct HintResult
+{
+    int from = -1;                      // Best pour (0-based), -1 if the position is solved already.
+    int to = -1;
+    int distance = -1;                  // Moves left to the goal with the best play.
+    bool searched = false;              // Whether the position had to be searched.
+    uint64_t expanded = 0;              // States expanded by the searches of this query.
+    double elapsedUs = 0;               // Time to answer the query.
+};
+
+class Hinter
+{
+public:
+    virtual ~Hinter() = default;
+
+    virtual bool hint(const Bottle* bottles, HintResult& result) = 0;
+
+    virtual size_t known() const = 0;
+
+    virtual void clear() = 0;
+};
+
+std::unique_ptr<Hinter> makeHinter(size_t n, const HintOptions& options);
+
+template <size_t size>
+class HintOracle : public Hinter
+{
+private:
+    static constexpr size_t KEY_BYTES = size * BOTTLE_SIZE;
+
+    typedef std::array<uint8_t, KEY_BYTES> raw_key_t;
+
+    struct Entry
+    {
+        uint8_t distance;
+        int8_t from;                    // Move toward the goal (-1 at the goal).
+        int8_t to;
+    };
+
+    struct Node
+    {
+        raw_key_t key;
+        size_t parent;                  // Index of the parent node.
+        int8_t from;                    // Pour from the parent.
+        int8_t to;
+        int16_t heuristic;
+    };
+
+    HintOptions m_options;
+
+    std::unordered_map<StateKey<size>, Entry> m_known;
+
+    static StateKey<size> keyOf(const uint8_t* key) { return StateKey<size>(reinterpret_cast<const Bottle*>(key)); }
+
+    // Exact distance of a position from the known states (see above); false if none was proven.
+    bool search(const Bottle* start, uint64_t& expanded);
+
+    // Positions up to `radius` moves off the path starting at `start` (see: HintOptions).
+    void solveAround(const Bottle* start, uint64_t& expanded);
+
+public:
+    explicit HintOracle(const HintOptions& options = HintOptions()) : m_options(options) {}
+
+    bool hint(const Bottle* bottles, HintResult& result) override;
+
+    size_t known() const override { return m_known.size(); }
+
+    void clear() override { m_known.clear(); }
+};
+
+
+
+/* ---------------- IMPLEMENTATION ---------------- */
+
+
+template <size_t size>
+bool HintOracle<size>::search(const Bottle* start, uint64_t& expanded)
+{
+    std::vector<Node> nodes;
+    PartitionTable<size> seen(1024);
+
+    Bottle bottles[size];
+    Bottle child[size];
+
+    size_t begin = 0;
+    size_t end = 1;
+    size_t bestNode = 0;
+
+    uint64_t count = 0;                 // States expanded by this search.
+
+    int best = INT_MAX;
+    int bound;
+    int depth = 0;
+    int total;
+
+    auto distanceOf = [this](const Bottle* b)
+    {
+        if (isGoal<size>(b)) {
+            return 0;
+        }
+        auto it = m_known.find(StateKey<size>(b));
+
+        return (it != m_known.end() ? static_cast<int>(it->second.distance) : -1);
+    };
+
+    nodes.push_back(Node{ {}, 0, -1, -1, static_cast<int16_t>(State<size>(start).heuristic()) });
+    memcpy(nodes.back().key.data(), start, KEY_BYTES);
+    seen.insert(reinterpret_cast<const uint8_t*>(start), StateKey<size>(start).hash(), 1);
+
+    while (begin < end)
+    {
+        bound = INT_MAX;
+
+        // Solved states of the layer end their branch; the others bound what remains to be found.
+        for (size_t i = begin; i < end; ++i)
+        {
+            if ((total = distanceOf(reinterpret_cast<const Bottle*>(nodes[i].key.data()))) >= 0)
+            {
+                if (depth + total < best)
+                {
+                    best = depth + total;
+                    bestNode = i;
+                }
+            }
+            else bound = std::min(bound, depth + nodes[i].heuristic);
+        }
+        if (bound >= best) break;
+
+        for (size_t i = begin; i < end; ++i)
+        {
+            memcpy(bottles, nodes[i].key.data(), KEY_BYTES);
+
+            if (depth + nodes[i].heuristic >= best || distanceOf(bottles) >= 0) continue;
+
+            if (++count > m_options.maxStates) {
+                return false;
+            }
+            expanded += 1;
+
+            for (int from = 0; from < static_cast<int>(size); ++from)
+            {
+                for (int to = 0; to < static_cast<int>(size); ++to)
+                {
+                    if (from == to || !bottles[from].shouldPourTo(bottles[to])) continue;
+
+                    memcpy(child, bottles, KEY_BYTES);
+                    child[from].pour(child[to]);
+
+                    if (!seen.insert(reinterpret_cast<const uint8_t*>(child), StateKey<size>(child).hash(), 1)) continue;
+
+                    nodes.push_back(Node{ {}, i, static_cast<int8_t>(from), static_cast<int8_t>(to),
+                        static_cast<int16_t>(State<size>(child).heuristic()) });
+                    memcpy(nodes.back().key.data(), child, KEY_BYTES);
+                }
+            }
+        }
+        begin = end;
+        end = nodes.size();
+        depth += 1;
+    }
+    if (best == INT_MAX || best > UINT8_MAX) {
+        return false;
+    }
+
+    // Every state on the path to the solved state lies as far from the goal as the search proved.
+    std::vector<size_t> path;
+
+    for (size_t i = bestNode; ; i = nodes[i].parent)
+    {
+        path.push_back(i);
+
+        if (i == 0) break;
+    }
+    const int solvedDistance = distanceOf(reinterpret_cast<const Bottle*>(nodes[bestNode].key.data()));
+
+    for (size_t j = 1; j < path.size(); ++j)
+    {
+        const Node& next = nodes[path[j - 1]];
+
+        m_known.emplace(keyOf(nodes[path[j]].key.data()),
+            Entry{ static_cast<uint8_t>(solvedDistance + j), next.from, next.to });
+    }
+    if (solvedDistance == 0) {
+        m_known.emplace(keyOf(nodes[bestNode].key.data()), Entry{ 0, -1, -1 });
+    }
+    return true;
+}
+
+template <size_t size>
+void HintOracle<size>::solveAround(const Bottle* start, uint64_t& expanded)
+{
+    std::vector<raw_key_t> path;
+    std::vector<raw_key_t> layer;
+    std::vector<raw_key_t> next;
+
+    Bottle bottles[size];
+    Bottle child[size];
+
+    raw_key_t key;
+
+    memcpy(key.data(), start, KEY_BYTES);
+
+    // The path from the position, as far as the map knows it.
+    for (auto it = m_known.find(keyOf(key.data())); it != m_known.end() && it->second.from >= 0; it = m_known.find(keyOf(key.data())))
+    {
+        path.push_back(key);
+
+        memcpy(bottles, key.data(), KEY_BYTES);
+        bottles[it->second.from].pour(bottles[it->second.to]);
+        memcpy(key.data(), bottles, KEY_BYTES);
+    }
+    layer = path;
+
+    for (int r = 0; r < m_options.radius && !layer.empty(); ++r)
+    {
+        next.clear();
+
+        for (const raw_key_t& k : layer)
+        {
+            memcpy(bottles, k.data(), KEY_BYTES);
+
+            for (int from = 0; from < static_cast<int>(size); ++from)
+            {
+                for (int to = 0; to < static_cast<int>(size); ++to)
+                {
+                    if (from == to || !bottles[from].shouldPourTo(bottles[to])) continue;
+
+                    memcpy(child, bottles, KEY_BYTES);
+                    child[from].pour(child[to]);
+
+                    if (isGoal<size>(child) || m_known.count(StateKey<size>(child)) > 0) continue;
+
+                    if (search(child, expanded))
+                    {
+                        next.emplace_back();
+                        memcpy(next.back().data(), child, KEY_BYTES);
+                    }
+                }
+            }
+        }
+        layer.swap(next);
+    }
+}
+
+template <size_t size>
+bool HintOracle<size>::hint(const Bottle* bottles, HintResult& result)
+{
+    auto t0 = std::chrono::steady_clock::now();
+
+    auto it = m_known.find(StateKey<size>(bottles));
+
+    result = HintResult();
+
+    if (it == m_known.end() && isGoal<size>(bottles)) {
+        it = m_known.emplace(StateKey<size>(bottles), Entry{ 0, -1, -1 }).first;
+    }
+    if (it == m_known.end())
+    {
+        result.searched = true;
+
+        if (search(bottles, result.expanded))
+        {
+            solveAround(bottles, result.expanded);
+            it = m_known.find(StateKey<size>(bottles));
+        }
+    }
+    if (it != m_known.end())
+    {
+        result.from = it->second.from;
+        result.to = it->second.to;
+        result.distance = it->second.distance;
+    }
+    result.elapsedUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+
+    return it != m_known.end();
+}
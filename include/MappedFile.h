@@ -0,0 +1,61 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+
+/*
+ *  MappedFile class:
+ *
+ *      Maps a whole file into memory (POSIX mmap or Win32 file mapping),
+ *      so that large binary inputs can be accessed without being copied.
+ *      The mapping is released upon destruction.
+ *
+ *
+ *  Class' methods:
+ *
+ *  ->  open(const std::string &path, bool writable, std::string &error):
+ *          Maps the file at `path`. If writable, changes to the mapped bytes
+ *          are written back to the file. Returns false on failure.
+ *
+ *  ->  data(), size():
+ *          Address and length of the mapping (nullptr and 0 if not open).
+ *
+ *  ->  sync():
+ *          Flushes changes of a writable mapping to disk.
+ */
+
+class MappedFile
+{
+private:
+    uint8_t* m_data;
+
+    size_t m_size;
+
+#if defined(_WIN32)
+    void* m_file;
+    void* m_mapping;
+#else
+    int m_fd;
+#endif
+
+public:
+    MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+
+    ~MappedFile();
+
+    bool open(const std::string& path, bool writable, std::string& error);
+
+    void close();
+
+    bool sync();
+
+    bool isOpen() const { return m_data != nullptr; }
+
+    uint8_t* data() const { return m_data; }
+
+    size_t size() const { return m_size; }
+};
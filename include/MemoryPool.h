@@ -2,10 +2,15 @@
 
 #include <set>
 #include <queue>
+#include <vector>
 #include <utility>
+#include <memory>
+#include <string>
 #include <fstream>
 #include <unordered_map>
 
+#include "AllocationTrace.h"
+
 
 class MemoryPool
 {
@@ -16,6 +21,8 @@ private:
 
     static inline void logMessage(const char* format...);
 
+    static std::string& tracePrefix();
+
 private:
     const size_t m_unitByteSize;
     const size_t m_allocationBytes;
@@ -34,10 +41,15 @@ private:
 
     int m_pocketIndex;
 
+    size_t m_unitsInUse;
+    size_t m_peakUnitsInUse;
+
     std::vector<pocket> m_allocatedPockets;
 
     std::unordered_map<size_t, size_t> m_pocketsWithGaps;
 
+    std::unique_ptr<AllocationTracer> m_tracer;     // Binary event trace (disabled if null).
+
     void init(pocket& p) const;
 
 public:
@@ -52,4 +64,13 @@ public:
     void* allocate();
 
     void deallocate(void* mem);
+
+    size_t bytesInUse() const { return m_unitsInUse * m_unitByteSize; }
+
+    size_t peakBytesInUse() const { return m_peakUnitsInUse * m_unitByteSize; }
+
+    void resetPeak() { m_peakUnitsInUse = m_unitsInUse; }
+
+    // Pools constructed from now on trace their operations to "PREFIX.<pool number>.wsat" (see: AllocationTrace.h).
+    static void enableTracing(const std::string& prefix);
 };
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "Bottle.h"
+#include "StateKey.h"
+#include "ClosedSet.h"
+
+
+/*
+ *  PartitionTable class:
+ *
+ *      Flat, open-addressing (linear probing) hash set of packed states of
+ *      `size` bottles, each followed by a tag byte that the owner is free
+ *      to use (a depth, a distance...), 0 marking a free slot. Keys are
+ *      stored by value, so the table holds no pointers and grows without
+ *      touching anything else. It has a power of two number of slots and is
+ *      kept at most 3/4 full.
+ *
+ *      A table is not thread-safe. Its intended use is as one partition of
+ *      a sharded visited set, the partition being chosen by the high bits
+ *      of the key hash while the table uses the low bits, and owned by one
+ *      thread at a time (see: pipelinedBFS(), census()). As with ClosedSet,
+ *      callers compute the hashes, so that a batch of keys can have its
+ *      slots prefetched before it is probed.
+ *
+ *
+ *  Class' methods:
+ *
+ *  ->  prefetch(uint64_t hash):
+ *          Hints the slot of the hash into the cache.
+ *
+ *  ->  insert(const uint8_t *key, uint64_t hash, uint8_t tag):
+ *          Adds a key with the given tag (not 0) unless it is in the table
+ *          already; true if it was added.
+ *
+ *  ->  find(const uint8_t *key, uint64_t hash, uint8_t &tag):
+ *          True and the key's tag if the key is in the table.
+ *
+ *  ->  retag(const uint8_t *key, uint64_t hash, uint8_t expected, uint8_t desired):
+ *          Changes the tag of a key from `expected` to `desired`; false if
+ *          the key is absent or tagged otherwise.
+ *
+ *  ->  capacity(), at(size_t i):
+ *          Number of slots, and slot i (its key followed by its tag), to
+ *          scan the whole table in order.
+ *
+ *  ->  count(), bytes():
+ *          Number of keys, and memory of the slots.
+ */
+
+template <size_t size>
+class PartitionTable
+{
+public:
+    static constexpr size_t KEY_BYTES = size * BOTTLE_SIZE;
+    static constexpr size_t SLOT_BYTES = KEY_BYTES + 1;
+
+private:
+    std::vector<uint8_t> m_slots;
+    size_t m_mask;
+    size_t m_count;
+
+    uint8_t* slot(size_t i) { return &m_slots[i * SLOT_BYTES]; }
+    const uint8_t* slot(size_t i) const { return &m_slots[i * SLOT_BYTES]; }
+
+    void grow()
+    {
+        std::vector<uint8_t> old((2 * (m_mask + 1)) * SLOT_BYTES, 0);
+
+        size_t i;
+
+        old.swap(m_slots);
+        m_mask = 2 * m_mask + 1;
+
+        for (size_t j = 0; j < old.size(); j += SLOT_BYTES)
+        {
+            if (old[j + KEY_BYTES] == 0) continue;
+
+            for (i = StateKey<size>(reinterpret_cast<const Bottle*>(&old[j])).hash() & m_mask;
+                slot(i)[KEY_BYTES] != 0; i = (i + 1) & m_mask);
+
+            memcpy(slot(i), &old[j], SLOT_BYTES);
+        }
+    }
+
+public:
+    explicit PartitionTable(size_t capacity) : m_count(0)
+    {
+        size_t slots = 16;
+
+        while (slots < capacity) {
+            slots *= 2;
+        }
+        m_slots.assign(slots * SLOT_BYTES, 0);
+        m_mask = slots - 1;
+    }
+
+    void prefetch(uint64_t hash) const { PREFETCH(slot(hash & m_mask)); }
+
+    bool insert(const uint8_t* key, uint64_t hash, uint8_t tag)
+    {
+        size_t i;
+
+        if (4 * (m_count + 1) > 3 * (m_mask + 1)) {
+            grow();
+        }
+        for (i = hash & m_mask; slot(i)[KEY_BYTES] != 0; i = (i + 1) & m_mask)
+        {
+            if (memcmp(slot(i), key, KEY_BYTES) == 0) {
+                return false;
+            }
+        }
+        memcpy(slot(i), key, KEY_BYTES);
+        slot(i)[KEY_BYTES] = tag;
+        m_count += 1;
+
+        return true;
+    }
+
+    bool find(const uint8_t* key, uint64_t hash, uint8_t& tag) const
+    {
+        for (size_t i = hash & m_mask; slot(i)[KEY_BYTES] != 0; i = (i + 1) & m_mask)
+        {
+            if (memcmp(slot(i), key, KEY_BYTES) == 0)
+            {
+                tag = slot(i)[KEY_BYTES];
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool retag(const uint8_t* key, uint64_t hash, uint8_t expected, uint8_t desired)
+    {
+        for (size_t i = hash & m_mask; slot(i)[KEY_BYTES] != 0; i = (i + 1) & m_mask)
+        {
+            if (memcmp(slot(i), key, KEY_BYTES) == 0)
+            {
+                if (slot(i)[KEY_BYTES] != expected) {
+                    return false;
+                }
+                slot(i)[KEY_BYTES] = desired;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    size_t count() const { return m_count; }
+
+    size_t capacity() const { return m_mask + 1; }
+
+    const uint8_t* at(size_t i) const { return slot(i); }
+
+    size_t bytes() const { return m_slots.size(); }
+};
@@ -0,0 +1,232 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+
+#include "Bottle.h"
+#include "MappedFile.h"
+#include "StateRanker.h"
+
+
+/*
+ *  Pattern databases:
+ *
+ *      Admissible lower bound on the number of moves left, precomputed for
+ *      an abstraction of the puzzle. The abstraction keeps `pattern` colors
+ *      apart (codes 1 to pattern) and merges every other color into a single
+ *      one (code pattern + 1). Since merged layers look alike, pouring may
+ *      move any part of the top run in the abstract game. Every pour of the
+ *      real game is then also an abstract pour and every goal state an abstract
+ *      goal, so the abstract distance to a goal never overestimates the
+ *      real one.
+ *
+ *      The abstract states are ranked densely (see: StateRanker.h) and the
+ *      database holds one byte per rank: the exact distance to the nearest
+ *      abstract goal, computed by a parallel backward BFS from every goal,
+ *      or PDB_UNREACHABLE. Colors are interchangeable, so the same database
+ *      serves every choice of pattern colors: a state is looked up once per
+ *      subset of `pattern` colors, keeping the maximum.
+ *
+ *      File (all fields little-endian): a 32-byte header followed by the
+ *      distances, in rank order.
+ *
+ *          offset  size  field
+ *          0       4     magic "WSPD"
+ *          4       2     format version (PDB_VERSION)
+ *          6       1     number of bottles
+ *          7       1     number of colors
+ *          8       1     number of pattern colors
+ *          9       1     bottle layout (BOTTLE_LAYOUT, see: Bottle.h)
+ *          10      6     reserved (0)
+ *          16      8     number of entries
+ *          24      8     reserved (0)
+ *
+ *
+ *  ->  buildPatternDatabase(path, options, report, error):
+ *          Computes a database and writes it to `path`.
+ *
+ *
+ *  PatternDatabase class:
+ *
+ *      Read-only, memory-mapped database, safe to share between threads.
+ *
+ *  ->  open(const std::string &path, std::string &error):
+ *          Maps and validates a database file.
+ *
+ *  ->  distance(uint64_t rank):
+ *          Distance of the abstract state of the given rank.
+ *
+ *
+ *  PatternHeuristic class:
+ *
+ *      Lookup of a database for the states of a given puzzle, which must
+ *      have the database's numbers of bottles and colors (see: active()).
+ *
+ *  ->  lookup(const Bottle *):
+ *          Largest distance over the subsets of pattern colors, 0 if inactive.
+ */
+
+constexpr uint16_t PDB_VERSION = 1;
+constexpr size_t PDB_HEADER_SIZE = 32;
+constexpr uint8_t PDB_UNREACHABLE = 255;
+constexpr uint64_t PDB_MAX_ENTRIES = static_cast<uint64_t>(1) << 32;
+
+struct PatternBuildOptions
+{
+    size_t bottles = 6;
+    size_t colors = 0;                  // Defaults to bottles - 2.
+    size_t pattern = 1;                 // Colors kept apart by the abstraction.
+    size_t threads = 1;
+};
+
+struct PatternBuildReport
+{
+    uint64_t entries = 0;
+    uint64_t reachable = 0;             // Entries from which a goal can be reached.
+    std::vector<uint64_t> histogram;    // Number of entries at every distance.
+    double elapsedMs = 0;
+};
+
+bool buildPatternDatabase(const std::string& path, const PatternBuildOptions& options, PatternBuildReport& report, std::string& error);
+
+// Abstract state of `colors` full bottles, the first `pattern` of them of colors 1, 2, ... and the rest of color pattern + 1.
+void patternTemplate(size_t colors, size_t pattern, Bottle* bottles, size_t n);
+
+class PatternDatabase
+{
+private:
+    MappedFile m_file;
+
+    size_t m_bottles;
+    size_t m_colors;
+    size_t m_pattern;
+    uint64_t m_entries;
+
+public:
+    PatternDatabase() : m_bottles(0), m_colors(0), m_pattern(0), m_entries(0) {}
+
+    bool open(const std::string& path, std::string& error);
+
+    bool isOpen() const { return m_file.isOpen(); }
+
+    size_t bottles() const { return m_bottles; }
+
+    size_t colors() const { return m_colors; }
+
+    size_t pattern() const { return m_pattern; }
+
+    uint64_t entries() const { return m_entries; }
+
+    uint8_t distance(uint64_t rank) const { return m_file.data()[PDB_HEADER_SIZE + rank]; }
+};
+
+template <size_t size>
+class PatternHeuristic
+{
+private:
+    typedef std::array<color_t, TOTAL_COLORS + 1> codes_t;
+
+    const PatternDatabase* m_database;
+
+    std::array<Bottle, size> m_template;
+    StateRanker<size> m_ranker;
+
+    std::vector<codes_t> m_codes;       // Abstract code of every color, for every subset of pattern colors.
+
+    static std::array<Bottle, size> abstractTemplate(const PatternDatabase* database)
+    {
+        std::array<Bottle, size> bottles;
+
+        if (database != nullptr && database->bottles() == size) {
+            patternTemplate(database->colors(), database->pattern(), bottles.data(), size);
+        }
+        return bottles;
+    }
+
+public:
+    PatternHeuristic(const PatternDatabase* database, const Bottle* puzzle)
+        : m_database(database), m_template(abstractTemplate(database)), m_ranker(m_template.data())
+    {
+        std::vector<color_t> colors;
+        std::vector<bool> chosen;
+
+        int counts[TOTAL_COLORS + 1] = {};
+
+        codes_t codes;
+
+        size_t i;
+        size_t j;
+        size_t k;
+
+        if (database == nullptr || !database->isOpen() || database->bottles() != size
+            || !m_ranker.rankable() || m_ranker.states() != database->entries())
+        {
+            return;
+        }
+        for (i = 0; i < size; ++i) {
+            for (j = 0; j < NUM_OF_COLORS; ++j) {
+                counts[puzzle[i].getColor(j)] += 1;
+            }
+        }
+        for (i = 1; i <= TOTAL_COLORS; ++i)
+        {
+            if (counts[i] == 0) continue;
+
+            if (counts[i] != NUM_OF_COLORS) {
+                return;
+            }
+            colors.push_back(static_cast<color_t>(i));
+        }
+        if (colors.size() != database->colors()) {
+            return;
+        }
+
+        // Every subset of pattern colors, as the first `pattern` of a permutation of selection flags.
+        chosen.assign(colors.size(), false);
+        std::fill(chosen.begin(), chosen.begin() + database->pattern(), true);
+
+        do
+        {
+            codes.fill(static_cast<color_t>(database->pattern() + 1));
+            codes[NO_COLOR] = NO_COLOR;
+
+            for (i = 0, k = 0; i < colors.size(); ++i) {
+                if (chosen[i]) {
+                    codes[colors[i]] = static_cast<color_t>(++k);
+                }
+            }
+            m_codes.push_back(codes);
+        }
+        while (std::prev_permutation(chosen.begin(), chosen.end()));
+    }
+
+    bool active() const { return !m_codes.empty(); }
+
+    // Number of lookups (subsets of pattern colors) per state.
+    size_t patterns() const { return m_codes.size(); }
+
+    int lookup(const Bottle* bottles) const
+    {
+        Bottle abstract[size];
+
+        int h = 0;
+
+        size_t i;
+        size_t j;
+
+        for (const codes_t& codes : m_codes)
+        {
+            for (i = 0; i < size; ++i) {
+                for (j = 0; j < NUM_OF_COLORS; ++j) {
+                    abstract[i].setColor(j, codes[bottles[i].getColor(j)]);
+                }
+            }
+            h = std::max<int>(h, m_database->distance(m_ranker.rank(abstract)));
+        }
+        return h;
+    }
+};
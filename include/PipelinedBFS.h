@@ -0,0 +1,433 @@
+#pragma once
+
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#include "State.h"
+#include "Cancel.h"
+#include "ClosedSet.h"
+#include "CompactBFS.h"
+#include "SpscQueue.h"
+#include "PartitionTable.h"
+#include "EndgameDatabase.h"
+
+
+/*
+ *  Pipelined Breadth First Search:
+ *
+ *      Exact, multi-threaded variant of compactBFS() in which expanding states
+ *      and deduplicating their children are separate stages running on their
+ *      own threads. Visited states are kept as packed keys tagged with their
+ *      depth, as in compactBFS(), but in hash tables rather than sorted sets.
+ *
+ *      The visited set is split into `partitions` by the high bits of the key
+ *      hash; every partition is a flat open-addressing table of keys tagged
+ *      with depth + 1 (see: PartitionTable) owned by one dedupe thread,
+ *      which alone reads and writes it during a layer, so the tables take
+ *      no locks. The search proceeds layer by layer:
+ *
+ *      ->  `expanders` threads claim chunks of PIPELINE_CHUNK_KEYS states of
+ *          the current layer, generate their children and append each child
+ *          (key and hash) to a batch of PIPELINE_BATCH_KEYS children bound for
+ *          the child's partition;
+ *
+ *      ->  full batches go through a bounded, lock-free queue (see: SpscQueue)
+ *          between every expander and every dedupe thread, holding at most
+ *          PIPELINE_QUEUE_BATCHES batches;
+ *
+ *      ->  every dedupe thread takes the batches of its partition, prefetches
+ *          the table slots of the whole batch, inserts the children not yet
+ *          visited and keeps them as its part of the next layer.
+ *
+ *      Backpressure: an expander that finds its queue full waits until the
+ *      dedupe thread has made room, so the children in flight never exceed
+ *      the queues' capacity however far the expanders run ahead. The time
+ *      every stage spends working, waiting on a full queue (expanders) and
+ *      waiting for input (dedupe threads) is reported in a PipelineReport.
+ *
+ *      The solution is recovered backwards from the goal as in compactBFS().
+ *      As the expanders stop at the first goal found, the number of states
+ *      examined in the last layer may vary from run to run; the solution's
+ *      length does not.
+ *
+ *
+ *  ->  pipelinedBFS(initial, options, examined, memory, peakBytes, report, endgame, cancel):
+ *          Returns the solution path (see also: State::copyWholePath()) or
+ *          nullptr if none exists. `memory` is set to the peak number of
+ *          states stored and `peakBytes` to the peak memory of the tables,
+ *          layers and queues. If `endgame` is given, the search stops at the
+ *          first state found in the endgame database, as BFS() does.
+ *          If `cancel` is set (see: Cancel.h), the expanders stop claiming
+ *          states and nullptr is returned at the end of the layer.
+ */
+
+constexpr size_t PIPELINE_CHUNK_KEYS = 4096;
+constexpr size_t PIPELINE_BATCH_KEYS = 256;
+constexpr size_t PIPELINE_QUEUE_BATCHES = 16;
+
+struct PipelineOptions
+{
+    size_t expanders = 0;                   // Expansion threads (0: half of the cores, at least 1).
+    size_t partitions = 0;                  // Dedupe threads, one per partition (0: the other cores, at least 1).
+};
+
+struct PipelineReport
+{
+    size_t expanders = 0;
+    size_t partitions = 0;
+    uint64_t batches = 0;                   // Batches passed from the expanders to the dedupe threads.
+    uint64_t stalls = 0;                    // Times an expander found its queue full.
+    double expandBusyMs = 0;                // Time of each stage, summed over its threads:
+    double expandStalledMs = 0;             //   expanders waiting for room in a queue,
+    double dedupeBusyMs = 0;
+    double dedupeIdleMs = 0;                //   dedupe threads waiting for batches.
+
+    // Share of a stage's time spent working.
+    double expandUtilization() const { return expandBusyMs / std::max(expandBusyMs + expandStalledMs, 1e-9); }
+    double dedupeUtilization() const { return dedupeBusyMs / std::max(dedupeBusyMs + dedupeIdleMs, 1e-9); }
+};
+
+template <size_t size>
+State<size>* pipelinedBFS(
+    State<size>& initial, const PipelineOptions& options,
+    uint64_t& examined, uint64_t& memory, uint64_t& peakBytes, PipelineReport& report,
+    const EndgameLookup<size>* endgame = nullptr, const std::atomic<bool>* cancel = nullptr)
+{
+    constexpr size_t KEY_BYTES = PartitionTable<size>::KEY_BYTES;
+
+    typedef std::array<uint8_t, KEY_BYTES> raw_key_t;
+    typedef std::chrono::steady_clock clock;
+
+    struct Batch
+    {
+        size_t count;
+        uint64_t hashes[PIPELINE_BATCH_KEYS];
+        raw_key_t keys[PIPELINE_BATCH_KEYS];
+    };
+
+    const size_t cores = std::max<size_t>(std::thread::hardware_concurrency(), 2);
+    const size_t E = (options.expanders > 0 ? options.expanders : std::max<size_t>(cores / 2, 1));
+    const size_t P = (options.partitions > 0 ? options.partitions : std::max<size_t>(cores - E, 1));
+
+    std::vector<PartitionTable<size>> tables;
+    std::vector<std::vector<raw_key_t>> layer(P);   // Current layer, by partition.
+    std::vector<std::vector<raw_key_t>> next(P);
+
+    std::vector<std::unique_ptr<SpscQueue<Batch>>> queues;      // Expander e to partition p: queues[e * P + p].
+    std::vector<std::pair<size_t, size_t>> chunks;  // Partition and first key of every chunk of the layer.
+
+    std::vector<std::thread> threads;
+
+    std::vector<std::pair<int, int>> moves;         // Pours of the solution, from the goal backwards.
+
+    std::atomic<size_t> nextChunk;
+    std::atomic<size_t> expandersDone;
+    std::atomic<uint64_t> examinedCount(0);
+    std::atomic<bool> found(false);
+
+    std::mutex mutex;                               // Guards the goal and the report's totals.
+
+    uint8_t start[KEY_BYTES];
+    uint8_t goal[KEY_BYTES];
+    uint8_t key[KEY_BYTES];
+
+    State<size>* result;
+
+    int depth = 0;
+    int distance = 0;                               // Moves left from the state found to the goal.
+    int from;
+    int to;
+
+    uint8_t tag;
+
+    auto endgameDistance = [endgame](const Bottle* b) { return (endgame != nullptr ? endgame->distance(b) : -1); };
+
+    auto hashOf = [](const uint8_t* k) { return StateKey<size>(reinterpret_cast<const Bottle*>(k)).hash(); };
+
+    auto partitionOf = [P](uint64_t hash) { return static_cast<size_t>(((hash >> 32) * P) >> 32); };
+
+    auto milliseconds = [](clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); };
+
+    auto account = [&]()
+    {
+        uint64_t states = 0;
+        uint64_t bytes = queues.size() * PIPELINE_QUEUE_BATCHES * sizeof(Batch);
+
+        for (size_t p = 0; p < P; ++p)
+        {
+            states += tables[p].count();
+            bytes += tables[p].bytes() + (layer[p].capacity() + next[p].capacity()) * sizeof(raw_key_t);
+        }
+        memory = std::max(memory, states);
+        peakBytes = std::max(peakBytes, bytes);
+    };
+
+    auto expand = [&](size_t e)
+    {
+        std::vector<Batch*> open(P, nullptr);       // Batch being filled for every partition.
+
+        Bottle bottles[size];
+        Bottle child[size];
+
+        clock::time_point begin = clock::now();
+        clock::duration stalled(0);
+
+        uint64_t batches = 0;
+        uint64_t stalls = 0;
+        uint64_t expanded = 0;
+
+        int d;
+
+        auto send = [&](size_t p)
+        {
+            queues[e * P + p]->publish();
+            open[p] = nullptr;
+            batches += 1;
+        };
+
+        auto push = [&](const Bottle* k, uint64_t hash)
+        {
+            const size_t p = partitionOf(hash);
+
+            if (open[p] == nullptr)
+            {
+                // Backpressure: wait for the dedupe thread to make room.
+                if ((open[p] = queues[e * P + p]->reserve()) == nullptr)
+                {
+                    clock::time_point t = clock::now();
+
+                    stalls += 1;
+
+                    while ((open[p] = queues[e * P + p]->reserve()) == nullptr) {
+                        std::this_thread::yield();
+                    }
+                    stalled += clock::now() - t;
+                }
+                open[p]->count = 0;
+            }
+            open[p]->hashes[open[p]->count] = hash;
+            memcpy(open[p]->keys[open[p]->count].data(), k, KEY_BYTES);
+
+            if (++open[p]->count == PIPELINE_BATCH_KEYS) {
+                send(p);
+            }
+        };
+
+        for (size_t c; !found.load(std::memory_order_relaxed) && !cancelled(cancel) && (c = nextChunk.fetch_add(1)) < chunks.size(); )
+        {
+            const std::vector<raw_key_t>& keys = layer[chunks[c].first];
+            const size_t end = std::min(chunks[c].second + PIPELINE_CHUNK_KEYS, keys.size());
+
+            for (size_t i = chunks[c].second; i < end && !found.load(std::memory_order_relaxed); ++i)
+            {
+                expanded += 1;
+
+                memcpy(bottles, keys[i].data(), KEY_BYTES);
+
+                for (int f = 0; f < static_cast<int>(size) && !found.load(std::memory_order_relaxed); ++f)
+                {
+                    for (int t = 0; t < static_cast<int>(size); ++t)
+                    {
+                        if (f == t || !bottles[f].shouldPourTo(bottles[t])) continue;
+
+                        memcpy(child, bottles, KEY_BYTES);
+                        child[f].pour(child[t]);
+
+                        // Goal state (or endgame state) reached: its parent and the pour are known.
+                        if ((d = (isGoal<size>(child) ? 0 : endgameDistance(child))) >= 0)
+                        {
+                            std::lock_guard<std::mutex> lock(mutex);
+
+                            if (!found.load())
+                            {
+                                memcpy(goal, keys[i].data(), KEY_BYTES);
+                                moves.push_back({ f, t });
+                                distance = d;
+                                found.store(true);
+                            }
+                            break;
+                        }
+                        push(child, hashOf(reinterpret_cast<const uint8_t*>(child)));
+                    }
+                }
+            }
+        }
+        for (size_t p = 0; p < P; ++p) {
+            if (open[p] != nullptr) {
+                send(p);
+            }
+        }
+        examinedCount.fetch_add(expanded);
+        expandersDone.fetch_add(1, std::memory_order_release);
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        report.batches += batches;
+        report.stalls += stalls;
+        report.expandStalledMs += milliseconds(stalled);
+        report.expandBusyMs += milliseconds(clock::now() - begin - stalled);
+    };
+
+    auto dedupe = [&](size_t p)
+    {
+        PartitionTable<size>& table = tables[p];
+
+        clock::time_point begin = clock::now();
+        clock::duration idle(0);
+
+        const uint8_t childTag = static_cast<uint8_t>(depth + 2);
+
+        bool received;
+
+        while (true)
+        {
+            received = false;
+
+            for (size_t e = 0; e < E; ++e)
+            {
+                Batch* batch = queues[e * P + p]->front();
+
+                if (batch == nullptr) continue;
+
+                // The slots of the whole batch are fetched together, then probed.
+                for (size_t i = 0; i < batch->count; ++i) {
+                    table.prefetch(batch->hashes[i]);
+                }
+                for (size_t i = 0; i < batch->count; ++i) {
+                    if (table.insert(batch->keys[i].data(), batch->hashes[i], childTag)) {
+                        next[p].push_back(batch->keys[i]);
+                    }
+                }
+                queues[e * P + p]->pop();
+                received = true;
+            }
+            if (received) continue;
+
+            // Once every expander is done, whatever it sent is visible: only empty queues end the layer.
+            if (expandersDone.load(std::memory_order_acquire) == E)
+            {
+                bool empty = true;
+
+                for (size_t e = 0; e < E && empty; ++e) {
+                    empty = (queues[e * P + p]->front() == nullptr);
+                }
+                if (empty) break;
+                continue;
+            }
+            clock::time_point t = clock::now();
+
+            std::this_thread::yield();
+            idle += clock::now() - t;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        report.dedupeIdleMs += milliseconds(idle);
+        report.dedupeBusyMs += milliseconds(clock::now() - begin - idle);
+    };
+
+    examined = 0;
+    memory = 1;
+    peakBytes = 0;
+    report = PipelineReport();
+    report.expanders = E;
+    report.partitions = P;
+
+    memcpy(start, initial.getBottles(), KEY_BYTES);
+
+    if (initial.isVictorious()) {
+        return initial.copyWholePath();
+    }
+    if ((distance = endgameDistance(initial.getBottles())) >= 0) {
+        return endgame->finish(initial.copyWholePath(), distance);
+    }
+
+    for (size_t p = 0; p < P; ++p) {
+        tables.emplace_back(size * size * 1024 / P);
+    }
+    for (size_t i = 0; i < E * P; ++i) {
+        queues.emplace_back(new SpscQueue<Batch>(PIPELINE_QUEUE_BATCHES));
+    }
+    tables[partitionOf(hashOf(start))].insert(start, hashOf(start), 1);
+    layer[partitionOf(hashOf(start))].emplace_back();
+    memcpy(layer[partitionOf(hashOf(start))].back().data(), start, KEY_BYTES);
+
+    while (!found && depth < 254)
+    {
+        chunks.clear();
+
+        for (size_t p = 0; p < P; ++p) {
+            for (size_t i = 0; i < layer[p].size(); i += PIPELINE_CHUNK_KEYS) {
+                chunks.push_back({ p, i });
+            }
+        }
+        if (chunks.empty()) break;
+
+        nextChunk = 0;
+        expandersDone = 0;
+
+        for (size_t e = 0; e < E; ++e) {
+            threads.emplace_back(expand, e);
+        }
+        for (size_t p = 0; p < P; ++p) {
+            threads.emplace_back(dedupe, p);
+        }
+        for (std::thread& t : threads) {
+            t.join();
+        }
+        threads.clear();
+
+        account();
+
+        if (found || cancelled(cancel)) break;
+
+        layer.swap(next);
+
+        for (std::vector<raw_key_t>& keys : next) {
+            keys.clear();
+        }
+        depth += 1;
+    }
+    examined = examinedCount;
+
+    layer.clear();
+    next.clear();
+    queues.clear();
+
+    if (!found) {
+        return nullptr;
+    }
+
+    // Walk back from the goal's parent (at `depth`) to the initial state.
+    for (int d = depth; d > 0; --d)
+    {
+        auto visitedAt = [&](const uint8_t* k)
+        {
+            const uint64_t hash = hashOf(k);
+
+            return tables[partitionOf(hash)].find(k, hash, tag) && tag == d;
+        };
+
+        if (!findPredecessor<size>(goal, visitedAt, key, from, to)) {
+            return nullptr;
+        }
+        moves.push_back({ from, to });
+        memcpy(goal, key, KEY_BYTES);
+    }
+    std::reverse(moves.begin(), moves.end());
+
+    result = new State<size>(initial);
+
+    for (const auto& m : moves) {
+        result = result->move(m.first, m.second);
+    }
+    return (distance > 0 ? endgame->finish(result, distance) : result);
+}
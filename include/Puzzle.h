@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <istream>
+
+#include "Bottle.h"
+
+
+/*
+ *  Puzzle text format:
+ *
+ *      One puzzle per line, its bottles separated by whitespace. Each bottle
+ *      is written as NUM_OF_COLORS digits ordered from its top to its bottom,
+ *      where every digit is a color code (see colors.h) in base 36 (0-9, then
+ *      a-z in either case; hexadecimal up to 15 colors) and 0 stands for
+ *      NO_COLOR. The number of bottles of the puzzle is the number of
+ *      bottles found on its line, e.g. a game of 5 bottles of 4 mL:
+ *
+ *          c9f5 5ff9 c59c 0000 0000
+ *
+ *      Empty lines and lines starting with '#' are ignored.
+ *
+ *
+ *  Functions:
+ *
+ *  ->  parsePuzzle(const std::string &, std::vector<Bottle> &, std::string &):
+ *          Parses a single puzzle line. On failure false is returned and the
+ *          reason is stored in the error string. Every color present must
+ *          appear exactly NUM_OF_COLORS times and no liquid may float above
+ *          an empty layer.
+ *
+ *  ->  checkPuzzle(const Bottle *, size_t, std::string &):
+ *          Applies the same rules to bottles given in binary form (e.g. by
+ *          library callers), which Bottle's constructor would reject by exiting,
+ *          and rejects color codes above TOTAL_COLORS.
+ *
+ *  ->  readPuzzles(std::istream &, std::vector<std::vector<Bottle>> &, std::string &):
+ *          Parses every puzzle of a stream, skipping comments and blank lines.
+ *
+ *  ->  formatPuzzle(const Bottle *, size_t):
+ *          Inverse of parsePuzzle().
+ */
+
+bool parsePuzzle(const std::string& line, std::vector<Bottle>& bottles, std::string& error);
+
+bool checkPuzzle(const Bottle* bottles, size_t n, std::string& error);
+
+bool readPuzzles(std::istream& is, std::vector<std::vector<Bottle>>& puzzles, std::string& error);
+
+std::string formatPuzzle(const Bottle* bottles, size_t n);
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+
+#include "Bottle.h"
+
+
+/*
+ *  Retrograde moves:
+ *
+ *      Inverse of Bottle::pour() over a whole state: the states from which
+ *      a single legal pour leads to a given one. A pour of k layers of color
+ *      c from bottle `from` into bottle `to` is undone by moving k layers of
+ *      the top run of `to` back onto `from`; as pours always move as much of
+ *      the top run as fits, every candidate is confirmed by pouring it again.
+ *
+ *
+ *  ->  forEachPredecessor(state, visit):
+ *          Calls visit(predecessor, from, to) (0-based bottles) for every
+ *          predecessor of the `size` bottles of `state`, until it returns true.
+ *          Returns true if stopped by `visit`.
+ */
+
+template <size_t size, typename Visit>
+bool forEachPredecessor(const Bottle* state, Visit visit)
+{
+    Bottle candidate[size];
+    Bottle check[size];
+
+    color_t c;
+
+    int top;
+    int run;
+    int space;
+    int from;
+    int to;
+    int k;
+    int i;
+
+    for (to = 0; to < static_cast<int>(size); ++to)
+    {
+        if ((c = state[to].top(top)) == NO_COLOR) continue;
+
+        for (run = 0; top + run < NUM_OF_COLORS && state[to].getColor(top + run) == c; ++run);
+
+        for (from = 0; from < static_cast<int>(size); ++from)
+        {
+            if (from == to) continue;
+
+            state[from].top(space);
+
+            // Undoes a pour of k layers of color c from `from` into `to`.
+            for (k = 1; k <= run && k <= space; ++k)
+            {
+                memcpy(candidate, state, sizeof(candidate));
+
+                for (i = 0; i < k; ++i)
+                {
+                    candidate[to].setColor(top + i, NO_COLOR);
+                    candidate[from].setColor(space - 1 - i, c);
+                }
+                // Only pours the game allows (always of the whole top run) count.
+                if (!candidate[from].shouldPourTo(candidate[to])) continue;
+
+                memcpy(check, candidate, sizeof(check));
+                check[from].pour(check[to]);
+
+                if (memcmp(check, state, sizeof(check)) != 0) continue;
+
+                if (visit(static_cast<const Bottle*>(candidate), from, to)) {
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
@@ -0,0 +1,217 @@
+#pragma once
+
+#include <chrono>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <ostream>
+
+
+/*
+ *  Search instrumentation:
+ *
+ *      Optional telemetry of a search (see also: BFS()). Cheap counters (node
+ *      counts per layer, closed set lookups and duplicate hits) are kept for
+ *      every state, while the expensive measurements (closed set probe
+ *      lengths and the time spent in each phase) are only taken for one of
+ *      every `samplingPeriod` expanded states and extrapolated to the whole
+ *      search.
+ *      Passing no SearchStats object to the search costs a single branch per
+ *      state.
+ *
+ *      Phases:
+ *      ->  PHASE_EXPAND:    move generation and construction of the children.
+ *      ->  PHASE_HASH:      hashing of the children.
+ *      ->  PHASE_LOOKUP:    closed set probes, excluding hashing.
+ *      ->  PHASE_ALLOCATE:  memory pool allocations and releases (see: State::operator new).
+ *
+ *
+ *  Methods:
+ *
+ *  ->  start(engine, bottles):
+ *          Resets every counter and starts the clock.
+ *
+ *  ->  beginLayer(depth), endLayer(frontier, closed, poolBytes):
+ *          Delimit a layer of the search; the sizes are recorded as of its end.
+ *
+ *  ->  sample():
+ *          True if the state about to be expanded is to be measured in detail.
+ *
+ *  ->  progress(frontier, closed, poolBytes):
+ *          Prints a progress line if the progress interval has passed since the last one.
+ *
+ *  ->  finish(solved, depth):
+ *          Stops the clock and closes the last layer.
+ *
+ *  ->  writeJson(std::ostream &), writeChromeTrace(std::ostream &):
+ *          Export of the results, as a JSON summary or as a Chrome trace event
+ *          file (viewable with chrome://tracing or Perfetto).
+ */
+
+enum SearchPhase
+{
+    PHASE_EXPAND,
+    PHASE_HASH,
+    PHASE_LOOKUP,
+    PHASE_ALLOCATE,
+    NUM_OF_PHASES
+};
+
+class SearchStats
+{
+public:
+    struct Layer
+    {
+        int depth;
+        uint64_t expanded;          // States expanded.
+        uint64_t generated;         // Children generated.
+        uint64_t duplicates;        // States discarded as already visited.
+        uint64_t frontier;          // Frontier size at the end of the layer.
+        uint64_t closed;            // Closed set size at the end of the layer.
+        uint64_t poolBytes;         // Pool bytes in use at the end of the layer.
+        uint64_t startUs;
+        uint64_t endUs;
+    };
+
+    typedef std::chrono::steady_clock clock;
+
+    // Accumulates the lifetime of the scope into a phase, if a sampled state is being measured.
+    class ScopedPhase
+    {
+    private:
+        SearchStats* m_stats;
+        SearchPhase m_phase;
+        clock::time_point m_t0;
+
+    public:
+        ScopedPhase(SearchStats* stats, SearchPhase phase) : m_stats(stats), m_phase(phase)
+        {
+            if (m_stats == nullptr) return;
+
+            if (m_phase != PHASE_ALLOCATE) {
+                m_stats->m_enclosing = m_phase;
+            }
+            m_t0 = clock::now();
+        }
+
+        ~ScopedPhase()
+        {
+            if (m_stats == nullptr) return;
+
+            m_stats->addPhaseTime(m_phase, clock::now() - m_t0);
+
+            if (m_phase != PHASE_ALLOCATE) {
+                m_stats->m_enclosing = NUM_OF_PHASES;
+            }
+        }
+    };
+
+private:
+    static inline thread_local SearchStats* s_sampling = nullptr;     // Instance measuring a sampled state on this thread.
+
+    std::ostream* m_progress;
+    uint64_t m_progressIntervalMs;
+    uint32_t m_samplingPeriod;
+
+    std::string m_engine;
+    size_t m_bottles;
+    bool m_solved;
+    int m_solutionDepth;
+
+    clock::time_point m_t0;
+    clock::time_point m_lastProgress;
+    uint64_t m_elapsedUs;
+
+    std::vector<Layer> m_layers;
+
+    uint64_t m_expanded;
+    uint64_t m_lookups;
+    uint64_t m_hits;
+    uint64_t m_probedLookups;
+    uint64_t m_probeLength;
+    uint64_t m_maxProbeLength;
+    uint64_t m_peakPoolBytes;
+
+    uint64_t m_sampledNodes;
+    uint64_t m_sampledNs[NUM_OF_PHASES];
+
+    SearchPhase m_enclosing;        // Phase being measured, whose time excludes the allocations within it.
+
+    uint64_t sinceStartUs() const;
+
+public:
+    explicit SearchStats(std::ostream* progress = nullptr, uint64_t progressIntervalMs = 1000, uint32_t samplingPeriod = 64);
+
+    void start(const char* engine, size_t bottles);
+
+    void beginLayer(int depth);
+
+    void endLayer(uint64_t frontier, uint64_t closed, uint64_t poolBytes);
+
+    void finish(bool solved, int depth);
+
+    bool sample()
+    {
+        m_expanded += 1;
+        m_layers.back().expanded += 1;
+
+        return (m_expanded % m_samplingPeriod) == 1 || m_samplingPeriod == 1;
+    }
+
+    void countGenerated(uint64_t n) { m_layers.back().generated += n; }
+
+    void countLookup(bool hit)
+    {
+        m_lookups += 1;
+
+        if (hit)
+        {
+            m_hits += 1;
+            m_layers.back().duplicates += 1;
+        }
+    }
+
+    void countProbe(uint64_t length)
+    {
+        m_probedLookups += 1;
+        m_probeLength += length;
+
+        if (length > m_maxProbeLength) {
+            m_maxProbeLength = length;
+        }
+    }
+
+    void addPhaseTime(SearchPhase phase, clock::duration d)
+    {
+        uint64_t ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count());
+
+        m_sampledNs[phase] += ns;
+
+        // Unsigned wrap-around is undone once the enclosing phase ends.
+        if (phase == PHASE_ALLOCATE && m_enclosing != NUM_OF_PHASES) {
+            m_sampledNs[m_enclosing] -= ns;
+        }
+    }
+
+    // Measurement of the allocations made while a sampled state is being expanded.
+    void beginSample() { m_sampledNodes += 1; s_sampling = this; }
+
+    void endSample() { s_sampling = nullptr; }
+
+    static SearchStats* sampling() { return s_sampling; }
+
+    void progress(uint64_t frontier, uint64_t closed, uint64_t poolBytes);
+
+    double duplicateRate() const { return (m_lookups > 0 ? static_cast<double>(m_hits) / m_lookups : 0.0); }
+
+    double meanProbeLength() const { return (m_probedLookups > 0 ? static_cast<double>(m_probeLength) / m_probedLookups : 0.0); }
+
+    // Estimated time of a phase over the whole search, in milliseconds.
+    double phaseMs(SearchPhase phase) const;
+
+    const std::vector<Layer>& layers() const { return m_layers; }
+
+    void writeJson(std::ostream& out) const;
+
+    void writeChromeTrace(std::ostream& out) const;
+};
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include "Bottle.h"
+#include "MappedFile.h"
+
+
+/*
+ *  SolutionCache class:
+ *
+ *      Persistent, memory-mapped store of solved puzzles, keyed by their
+ *      canonical encoding (see Canonical.h), so that a puzzle seen before,
+ *      even with its bottles reordered or its colors renamed, is answered
+ *      without searching.
+ *
+ *      The file is a set-associative table of CACHE_WAYS slots per bucket,
+ *      sized once upon creation. A lookup hashes the canonical encoding and
+ *      scans a single bucket. When a bucket is full, its least recently used
+ *      slot is evicted, so the file never outgrows its size limit.
+ *      Values are stored in native byte order; all methods are thread-safe
+ *      within a process.
+ *
+ *      Slot layout (CACHE_SLOT_BYTES):
+ *
+ *          offset  size  field
+ *          0       8     hash of the canonical encoding (0 = empty slot)
+ *          8       4     last use (global tick)
+ *          12      1     number of bottles
+ *          13      1     flags (bit 0: solution is optimal)
+ *          14      1     number of moves
+ *          15      1     reserved
+ *          16      34    canonical encoding (BOTTLE_SIZE bytes per bottle;
+ *                        larger puzzles are not cached)
+ *          50      206   moves as (from, to) byte pairs of canonical bottles
+ *
+ *
+ *  Class' methods:
+ *
+ *  ->  open(const std::string &path, size_t maxBytes, std::string &error):
+ *          Maps the cache file, creating it with room for maxBytes if missing.
+ *          An existing file keeps the geometry it was created with.
+ *
+ *  ->  lookup(bottles, n, requireOptimal, moves, optimal):
+ *          Fetches the solution of a puzzle, with moves translated back to
+ *          its own (1-based) bottle numbers. Non-optimal entries are ignored
+ *          if requireOptimal is set.
+ *
+ *  ->  store(bottles, n, moves, optimal):
+ *          Inserts a solution (1-based moves), replacing the cached one only
+ *          if the new one is better. Solutions longer than CACHE_MAX_MOVES
+ *          are not cached.
+ */
+
+constexpr size_t CACHE_SLOT_BYTES = 256;
+constexpr size_t CACHE_WAYS = 8;
+constexpr size_t CACHE_KEY_OFFSET = 16;
+constexpr size_t CACHE_MOVES_OFFSET = 50;
+constexpr size_t CACHE_MAX_MOVES = (CACHE_SLOT_BYTES - CACHE_MOVES_OFFSET) / 2;
+constexpr size_t CACHE_DEFAULT_BYTES = 64 * 1024 * 1024;
+
+class SolutionCache
+{
+private:
+    MappedFile m_file;
+
+    std::mutex m_mutex;
+
+    uint32_t m_buckets;
+
+    uint64_t m_hits;
+    uint64_t m_misses;
+
+    uint8_t* slot(size_t bucket, size_t way) const;
+
+    uint32_t tick();
+
+    uint8_t* find(const Bottle* canonical, size_t n, uint64_t hash) const;
+
+public:
+    SolutionCache() : m_buckets(0), m_hits(0), m_misses(0) {}
+
+    SolutionCache(const SolutionCache&) = delete;
+
+    bool open(const std::string& path, size_t maxBytes, std::string& error);
+
+    bool lookup(const Bottle* bottles, size_t n, bool requireOptimal, std::vector<std::pair<int, int>>& moves, bool& optimal);
+
+    void store(const Bottle* bottles, size_t n, const std::vector<std::pair<int, int>>& moves, bool optimal);
+
+    uint64_t hits() const { return m_hits; }
+
+    uint64_t misses() const { return m_misses; }
+
+    uint64_t capacity() const { return static_cast<uint64_t>(m_buckets) * CACHE_WAYS; }
+};
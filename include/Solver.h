@@ -0,0 +1,205 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <utility>
+
+#include "BFS.h"
+#include "State.h"
+#include "AnytimeSearch.h"
+#include "ApproximateBFS.h"
+#include "CompactBFS.h"
+#include "DenseBFS.h"
+#include "PipelinedBFS.h"
+#include "SolutionCache.h"
+
+
+/*
+ *  Solver interface:
+ *
+ *      Runtime entry point to the search engines, for callers that only know
+ *      the number of bottles at runtime (see also: dispatch.h).
+ *
+ *
+ *  ->  solvePuzzle(const Bottle *, size_t n, const SolverOptions &, SolveResult &):
+ *          Solves the puzzle with the selected engine, on the calling thread's
+ *          pool, and fills in the solution's moves and the search metrics.
+ *          If a solution cache is given, it is consulted before searching
+ *          (optimal entries only, for the exact engines) and updated afterwards.
+ *          If options.relabelColors is set, the colors are first renumbered by
+ *          order of first appearance (see: relabelColors()), so that puzzles
+ *          which only differ in the naming of their colors are searched alike.
+ *          Returns true if a solution was found. A bottle count outside
+ *          [MIN_BOTTLES, MAX_BOTTLES] is not searched: false is returned and
+ *          result.error says why.
+ *
+ *          The portfolio engine races the engines of options.portfolio, each
+ *          on its own thread and pool, and returns the first solution of the
+ *          requested quality (proven optimal, or any); the other engines are
+ *          then cancelled (see: Cancel.h) and joined. If no engine delivers
+ *          such a solution before they all finish or the deadline expires,
+ *          the best solution found, if any, is returned. Setting
+ *          options.cancel ends the race the same way. The engine that won is
+ *          reported in result.engine and every engine's outcome in
+ *          result.race.
+ *
+ *  ->  verifyMoves(const Bottle *, size_t n, moves):
+ *          True if the (1-based) moves are legal and solve the puzzle.
+ *
+ *  ->  engineName(Engine), parseEngine(const char *, Engine &):
+ *          Command line name of an engine (e.g. "compact"), and back.
+ */
+
+enum class Engine
+{
+    BFS,            // Optimal, see BFS.h
+    ANYTIME,        // Non-optimal, see AnytimeSearch.h
+    APPROXIMATE,    // Optimal with bounded probability, see ApproximateBFS.h
+    COMPACT,        // Optimal, memory-lean, see CompactBFS.h
+    DENSE,          // Optimal, small puzzles only, see DenseBFS.h
+    PIPELINED,      // Optimal, multi-threaded, see PipelinedBFS.h
+    PORTFOLIO       // Races other engines, see solvePuzzle()
+};
+
+struct PortfolioOptions
+{
+    std::vector<Engine> engines = { Engine::BFS, Engine::COMPACT, Engine::ANYTIME };    // Raced, a thread each.
+    bool optimal = true;                // Accept proven optimal solutions only (any solution otherwise).
+    uint64_t deadlineMs = 0;            // Time after which every engine is cancelled (0: none).
+};
+
+struct SolverOptions
+{
+    Engine engine = Engine::BFS;
+    AnytimeOptions anytime;
+    ApproximateOptions approximate;
+    PipelineOptions pipeline;
+    PortfolioOptions portfolio;
+    SolutionCache* cache = nullptr;     // Optional, shared by every thread.
+    const EndgameDatabase* endgame = nullptr;   // Optional, shared by every thread (BFS, compact and pipelined engines).
+    bool relabelColors = false;         // Renumber colors, and merge renamed states in BFS's closed set.
+    const std::atomic<bool>* cancel = nullptr;  // Optional, stops the search once set (see: Cancel.h).
+};
+
+// Outcome of one engine of a portfolio.
+struct RaceEntry
+{
+    Engine engine = Engine::BFS;
+    bool solved = false;
+    bool optimal = false;
+    bool cancelled = false;             // Whether it was still searching when the race ended.
+    int depth = 0;
+    double elapsedMs = 0;
+};
+
+struct SolveResult
+{
+    bool solved = false;
+    bool optimal = false;               // Whether the solution is proven optimal.
+    bool cached = false;                // Whether the solution came from the cache.
+    int depth = 0;                      // Number of moves of the solution.
+    double missProbability = 0;         // Chance that a shorter solution exists (approximate engine).
+    Engine engine = Engine::BFS;        // Engine that found the solution (the winner, for a portfolio).
+
+    std::vector<RaceEntry> race;        // Every engine of a portfolio (empty otherwise).
+
+    std::vector<std::pair<int, int>> moves;   // Pours from bottle `first` to bottle `second` (1-based).
+
+    uint64_t examined = 0;              // Number of states expanded.
+    uint64_t memory = 0;                // Peak number of states stored.
+    uint64_t peakBytes = 0;             // Peak bytes of the thread's state pool.
+    double elapsedMs = 0;               // Wall time of the search.
+
+    std::string error;                  // Why the puzzle was not searched (empty otherwise).
+};
+
+template <size_t size>
+struct SolveTask
+{
+    static int run(const Bottle* bottles, const SolverOptions& options, SolveResult& result)
+    {
+        State<size> start(bottles);
+        State<size>* solution;
+
+        MemoryPool& pool = getPool<size>();
+
+        pool.resetPeak();
+
+        auto t0 = std::chrono::steady_clock::now();
+
+        ApproximateReport report;
+        PipelineReport pipeline;
+
+        uint64_t compactBytes = 0;
+        bool ranked;
+
+        EndgameLookup<size> endgame(options.endgame, bottles);
+
+        result.engine = options.engine;
+
+        const EndgameLookup<size>* lookup = (endgame.active() ? &endgame : nullptr);
+
+        if (options.engine == Engine::ANYTIME) {
+            solution = anytimeBeamSearch<size>(start, options.anytime, result.examined, result.memory, result.optimal,
+                nullptr, options.cancel);
+        }
+        else if (options.engine == Engine::APPROXIMATE)
+        {
+            solution = approximateBFS<size>(start, options.approximate, result.examined, result.memory, report, options.cancel);
+            result.optimal = report.exactFallback;
+            result.missProbability = report.missProbability;
+        }
+        else if (options.engine == Engine::COMPACT)
+        {
+            solution = compactBFS<size>(start, result.examined, result.memory, compactBytes, lookup, nullptr, nullptr, options.cancel);
+            result.optimal = true;
+        }
+        else if (options.engine == Engine::DENSE)
+        {
+            solution = denseBFS<size>(start, result.examined, result.memory, compactBytes, ranked, options.cancel);
+            result.optimal = true;
+        }
+        else if (options.engine == Engine::PIPELINED)
+        {
+            solution = pipelinedBFS<size>(start, options.pipeline, result.examined, result.memory, compactBytes, pipeline, lookup,
+                options.cancel);
+            result.optimal = true;
+        }
+        else
+        {
+            solution = BFS(start, result.examined, result.memory, nullptr, lookup, options.relabelColors, options.cancel);
+            result.optimal = true;
+        }
+
+        result.elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        result.peakBytes = pool.peakBytesInUse() + report.filterBytes + compactBytes;
+        result.solved = (solution != nullptr);
+        result.moves.clear();
+
+        if (solution != nullptr) {
+            solution->getMoves(result.moves);
+        }
+        result.depth = static_cast<int>(result.moves.size());
+
+        State<size>::deleteWholePath(solution);
+
+        return result.solved;
+    }
+};
+
+bool solvePuzzle(const Bottle* bottles, size_t n, const SolverOptions& options, SolveResult& result);
+
+// Whether the engine's solutions are always optimal (and may reuse optimal cache entries only).
+bool isExactEngine(Engine engine);
+
+// Whether the options call for optimal solutions (the exact engines, or a portfolio asked for them).
+bool requiresOptimal(const SolverOptions& options);
+
+const char* engineName(Engine engine);
+
+bool parseEngine(const char* name, Engine& engine);
+
+bool verifyMoves(const Bottle* bottles, size_t n, const std::vector<std::pair<int, int>>& moves);
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <string>
+#include <ostream>
+#include <cstddef>
+
+#include "Solver.h"
+
+
+/*
+ *  Solver server:
+ *
+ *      Long-running solver listening on a Unix domain socket, so that a
+ *      caller pays for process start-up and memory pool pockets once rather
+ *      than per puzzle. Requests from every connection share a bounded queue
+ *      served by a pool of worker threads; each worker keeps its state pool
+ *      arena (see: getPool()) for the lifetime of the server.
+ *
+ *      Protocol (text, one request or reply per line, replies in order of
+ *      completion rather than of request):
+ *
+ *          request:    <id> <deadline-ms> <bottle> <bottle> ...
+ *          reply:      a batch record (see: toJson()) tagged with the client's
+ *                      id, plus "queued_ms" and, if the deadline has passed,
+ *                      "late":true; or {"id":<id>,"error":"<reason>"}
+ *
+ *      e.g.        7 250 c9f5 5ff9 c59c 0000 0000
+ *
+ *      The bottles follow the puzzle text format (see: Puzzle.h). A deadline
+ *      of 0 means none; otherwise it counts from the arrival of the request:
+ *      ->  requests still queued at their deadline are answered with the
+ *          error "deadline exceeded" without being solved,
+ *      ->  the anytime engine's time budget is cut to the time left, and so
+ *          is the portfolio's deadline (see: PortfolioOptions),
+ *      ->  the other engines are cancelled at the deadline (see: Cancel.h)
+ *          and answered with the same error,
+ *      ->  a solution that still arrives after the deadline (e.g. from the
+ *          anytime engine's last round) is flagged as late.
+ *
+ *      Backpressure: once `queueLimit` requests are waiting, further ones are
+ *      answered at once with the error "busy", so that callers can retry or
+ *      fall back rather than queue behind a backlog.
+ *
+ *
+ *  ->  runServer(options, log, error):
+ *          Serves requests until SIGINT or SIGTERM (or stopServer()), then
+ *          drains the queue, removes the socket file and reports the totals
+ *          to `log`. Returns false if the socket could not be set up, or on
+ *          platforms without Unix domain sockets.
+ *
+ *  ->  stopServer():
+ *          Asks a running server to stop (safe to call from signal handlers).
+ */
+
+struct ServerOptions
+{
+    std::string socketPath;
+    size_t threads = 1;
+    size_t queueLimit = 64;             // Requests waiting for a worker, beyond which new ones are refused.
+    SolverOptions solver;
+};
+
+bool runServer(const ServerOptions& options, std::ostream& log, std::string& error);
+
+void stopServer();
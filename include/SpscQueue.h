@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <cstddef>
+
+
+/*
+ *  SpscQueue class:
+ *
+ *      Bounded, lock-free queue between a single producer thread and a single
+ *      consumer thread. The elements live in a ring of `capacity` slots (a
+ *      power of two) that is allocated once: the producer fills a slot in
+ *      place and publishes it, the consumer reads it in place and releases
+ *      it, so nothing is copied or allocated per element. A full queue makes
+ *      reserve() fail, which is how a slow consumer holds its producer back.
+ *
+ *      Each index is written by one side only and read by the other with
+ *      acquire/release ordering; the two indexes sit on separate cache lines.
+ *
+ *
+ *  Class' methods (producer):
+ *
+ *  ->  reserve():
+ *          The next free slot, to be filled and then published, or nullptr
+ *          if the queue is full. Returns the same slot until publish().
+ *
+ *  ->  publish():
+ *          Hands the reserved slot over to the consumer.
+ *
+ *  Class' methods (consumer):
+ *
+ *  ->  front():
+ *          The oldest published slot, or nullptr if the queue is empty.
+ *
+ *  ->  pop():
+ *          Gives the front slot back to the producer.
+ */
+
+template <typename T>
+class SpscQueue
+{
+private:
+    std::unique_ptr<T[]> m_slots;
+    size_t m_mask;
+
+    alignas(64) std::atomic<size_t> m_head;     // Next slot to read, written by the consumer.
+    alignas(64) std::atomic<size_t> m_tail;     // Next slot to write, written by the producer.
+
+public:
+    explicit SpscQueue(size_t capacity) : m_head(0), m_tail(0)
+    {
+        size_t slots = 1;
+
+        while (slots < capacity) {
+            slots *= 2;
+        }
+        m_slots.reset(new T[slots]);
+        m_mask = slots - 1;
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+
+    SpscQueue& operator = (const SpscQueue&) = delete;
+
+    T* reserve()
+    {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+
+        if (tail - m_head.load(std::memory_order_acquire) > m_mask) {
+            return nullptr;
+        }
+        return &m_slots[tail & m_mask];
+    }
+
+    void publish() { m_tail.store(m_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    T* front()
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+
+        if (head == m_tail.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        return &m_slots[head & m_mask];
+    }
+
+    void pop() { m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    size_t capacity() const { return m_mask + 1; }
+};
@@ -7,13 +7,19 @@
 #include <random>
 #include <ctime>
 #include <iomanip>
+#include <algorithm>
 #include <cstring>
 #include <cstddef>
 #include <cstdint>
+#include <utility>
 #include <initializer_list>
 
 #include "Bottle.h"
+#include "dispatch.h"
+#include "StateKey.h"
+#include "Canonical.h"
 #include "MemoryPool.h"
+#include "SearchStats.h"
 #include "colors.h"
 
 #define ACTION_NAME_SIZE 2
@@ -33,13 +39,30 @@
  *  Class' important methods:
  *
  *  ->  init():
- *          Initializes the state's bottles with N - 2 random colors
- *          (4mL each) in a random sequence.
+ *          Initializes the state's bottles with N - 2 random colors (at most
+ *          TOTAL_COLORS, NUM_OF_COLORS mL each) in a random sequence.
+ *
+ *  ->  init(std::mt19937 &):
+ *          Same as init(), drawing from the given generator so that
+ *          puzzles can be reproduced from a seed.
+ *
+ *  ->  key():
+ *          Returns the packed integer key of the state's bottles, through which
+ *          states are compared, hashed and ordered (see: StateKey.h).
+ *
+ *  ->  colorKey():
+ *          Key of the state's bottles with their colors renumbered by order of
+ *          first appearance (see: relabelColors()), shared by exactly the states
+ *          that only differ in the naming of their colors. Such states are
+ *          equally far from the goal, so a search may treat them as one.
  *
  *  ->  hashValue():
  *          Returns the hash code of the state for storing and searching
  *          State instances in the closed set of AI algorithms.
- *          (see also: hash_t)
+ *          (see also: hash_t, StateKey::hash())
+ *
+ *  ->  legacyHashValue():
+ *          The former byte-at-a-time hash, kept for comparisons of hash quality.
  *
  *  ->  toString():
  *          Returns an std::string as an attempt to represent a snapshot of
@@ -51,6 +74,10 @@
  *          If the return value evaluates to true, then the puzzle has reached
  *          the goal state.
  *
+ *  ->  isGoal<size>(const Bottle *):
+ *          The same test for `size` bottles outside of a State, for the
+ *          engines that keep states as packed keys.
+ *
  *  ->  getDepth():
  *          Returns the depth of the state-node in the state tree.
  *
@@ -61,6 +88,27 @@
  *
  *  ->  expand(std::vector<State *> &):
  *          Returns the set of the child states.
+ *
+ *  ->  getAction(int &from, int &to):
+ *          Returns the bottles (1-based) of the pour that created the state,
+ *          false for the initial state.
+ *
+ *  ->  deleteWholePath(State *):
+ *          Releases a path created by copyWholePath().
+ *
+ *  ->  move(int from, int to):
+ *          Pours from bottle[from] to bottle[to] (0-based) into a new child
+ *          state, or returns nullptr if the pour is not allowed.
+ *
+ *  ->  getMoves(std::vector<std::pair<int, int>> &):
+ *          Returns the pours (1-based) leading from the initial state to this one.
+ *
+ *  ->  heuristic():
+ *          Admissible (and consistent) lower bound on the number of moves
+ *          left until the goal: every layer resting on top of another color
+ *          must be poured at least once, and so must all but one of the
+ *          bottom layers sharing the same color. A single pour reduces the
+ *          estimate by at most one.
  */
 
 
@@ -75,7 +123,7 @@ template <size_t size>
 class State
 {
     static_assert(size > 2, "Enter a valid amount of bottles (N > 2).");
-    static_assert(size < 18, "Number of bottles must be less than 18.");
+    static_assert(size <= MAX_BOTTLES, "Number of bottles must not exceed MAX_BOTTLES (see: dispatch.h).");
 
 private:
 
@@ -94,10 +142,14 @@ public:
 
     State(std::initializer_list<Bottle> init);
 
+    explicit State(const Bottle* init);
+
     ~State() = default;
 
     void init();
 
+    void init(std::mt19937& generator);
+
     void setActionName(bsize_t from, bsize_t to);
 
     void setPrevious(State* p) { prev = p; }
@@ -108,10 +160,18 @@ public:
 
     State<size>* getPrevious() const { return prev; }
 
-    hash_t hashValue() const;
+    StateKey<size> key() const { return StateKey<size>(bottles); }
+
+    StateKey<size> colorKey() const;
+
+    hash_t hashValue() const { return static_cast<hash_t>(key().hash()); }
+
+    hash_t legacyHashValue() const;
 
     std::string getActionName() const;
 
+    bool getAction(int& from, int& to) const;
+
     std::string toString() const;
 
     bool isVictorious() const;
@@ -120,10 +180,18 @@ public:
 
     int getDepth() const;
 
+    int heuristic() const;
+
     void expand(std::vector<State<size>*>&);
 
+    State<size>* move(int from, int to);
+
+    void getMoves(std::vector<std::pair<int, int>>& moves) const;
+
     State<size>* copyWholePath() const;
 
+    static void deleteWholePath(State<size>* s);
+
 public:
     State<size>& operator = (const State<size>& other);
 
@@ -159,6 +227,48 @@ namespace std
     };
 }
 
+// If true, then object equality is ignored in case of collision.
+constexpr bool ALLOW_UNSAFE_PRUNNING = false;
+
+// Content equality of pointers (auxiliary struct for maps).
+template <typename T>
+struct EqualContents
+{
+    constexpr bool operator () (const T* a, const T* b) const noexcept
+    {
+        if constexpr (ALLOW_UNSAFE_PRUNNING) {
+            return true;
+        }
+        else return *a == *b;
+    }
+};
+
+// Hash and equality of state pointers for closed sets, optionally up to a
+// renaming of the colors (see: State::colorKey()).
+template <size_t size>
+struct ClosedHash
+{
+    bool relabel = false;
+
+    size_t operator () (const State<size>* s) const noexcept {
+        return (relabel ? static_cast<size_t>(s->colorKey().hash()) : s->hashValue());
+    }
+};
+
+template <size_t size>
+struct ClosedEqual
+{
+    bool relabel = false;
+
+    bool operator () (const State<size>* a, const State<size>* b) const noexcept
+    {
+        if constexpr (ALLOW_UNSAFE_PRUNNING) {
+            return true;
+        }
+        else return (relabel ? a->colorKey() == b->colorKey() : *a == *b);
+    }
+};
+
 /* ------------------------------ IMPLEMENTATION ------------------------------ */
 
 template <size_t size>
@@ -188,6 +298,16 @@ State<size>::State(std::initializer_list<Bottle> l)
     prev = nullptr;
 }
 
+template <size_t size>
+State<size>::State(const Bottle* b)
+{
+    for (size_t i = 0; i < size; ++i) {
+        bottles[i] = b[i];
+    }
+    actionName[0] = '\0';
+    prev = nullptr;
+}
+
 template <size_t size>
 color_t State<size>::pour(State<size>* n, int from, int to)
 {
@@ -211,11 +331,17 @@ color_t State<size>::pour(State<size>* n, int from, int to)
 template <size_t size>
 void State<size>::init()
 {
-    std::vector<color_t> colors(size - 2);
-    std::vector<int> ml_left(colors.size(), 4);
-
     static std::mt19937 generator(static_cast<unsigned int>(time(nullptr) +10));
 
+    init(generator);
+}
+
+template <size_t size>
+void State<size>::init(std::mt19937& generator)
+{
+    std::vector<color_t> colors(std::min(size - 2, TOTAL_COLORS));
+    std::vector<int> ml_left(colors.size(), NUM_OF_COLORS);
+
     std::uniform_int_distribution<size_t> distribution(1, TOTAL_COLORS);
     std::uniform_int_distribution<size_t> color_dist(0, colors.size() - 1);
 
@@ -226,19 +352,15 @@ void State<size>::init()
 
     for (i = 0; i < colors.size(); ++i)
     {
-        c = static_cast<color_t>(distribution(generator));
+        // Draw again until the color differs from every previous one.
+        do {
+            c = static_cast<color_t>(distribution(generator));
+        } while (std::find(colors.begin(), colors.begin() + i, c) != colors.begin() + i);
 
-        for (j = 0; j < i; ++j) {
-            if (c == colors[j])
-            {
-                c = static_cast<color_t>(distribution(generator));
-                j = 0;
-            }
-        }
         colors[i] = c;
     }
 
-    for (k = 0; k < size - 2; ++k)
+    for (k = 0; k < colors.size(); ++k)
     {
         for (i = 0; i < NUM_OF_COLORS; ++i)
         {
@@ -260,7 +382,59 @@ void State<size>::setActionName(bsize_t from, bsize_t to)
 }
 
 template <size_t size>
-hash_t State<size>::hashValue() const
+StateKey<size> State<size>::colorKey() const
+{
+    // Same renumbering as relabelColors(), a byte (two layers, top one in
+    // the high nibble) at a time with 4-bit colors, as closed sets compute
+    // it on every probe. The padding nibble of odd capacities stays 0.
+    const uint8_t* in = reinterpret_cast<const uint8_t*>(bottles);
+
+    uint8_t out[size * BOTTLE_SIZE];
+    uint8_t label[(1u << COLOR_BITS)] = {};
+    uint8_t next = 0;
+    uint8_t hi;
+    uint8_t lo;
+
+    if constexpr (COLOR_BITS == 4)
+    {
+        for (size_t i = 0; i < size * BOTTLE_SIZE; ++i)
+        {
+            hi = in[i] >> 4;
+            lo = in[i] & 0x0F;
+
+            if (hi != NO_COLOR && label[hi] == NO_COLOR) {
+                label[hi] = ++next;
+            }
+            if (lo != NO_COLOR && label[lo] == NO_COLOR) {
+                label[lo] = ++next;
+            }
+            out[i] = static_cast<uint8_t>((label[hi] << 4) | label[lo]);
+        }
+    }
+    else
+    {
+        Bottle* relabeled = reinterpret_cast<Bottle*>(out);
+
+        for (size_t i = 0; i < size; ++i)
+        {
+            relabeled[i] = Bottle();
+
+            for (size_t j = 0; j < NUM_OF_COLORS; ++j)
+            {
+                hi = bottles[i].getColor(j);
+
+                if (hi != NO_COLOR && label[hi] == NO_COLOR) {
+                    label[hi] = ++next;
+                }
+                relabeled[i].setColor(j, label[hi]);
+            }
+        }
+    }
+    return StateKey<size>(reinterpret_cast<const Bottle*>(out));
+}
+
+template <size_t size>
+hash_t State<size>::legacyHashValue() const
 {
     size_t i, j;
     hash_t hash;
@@ -304,6 +478,18 @@ std::string State<size>::getActionName() const
     return oss.str();
 }
 
+template <size_t size>
+bool State<size>::getAction(int& from, int& to) const
+{
+    if (!actionName[0]) {
+        return false;
+    }
+    from = actionName[0];
+    to = actionName[1];
+
+    return true;
+}
+
 template <size_t size>
 std::string State<size>::toString() const
 {
@@ -319,7 +505,7 @@ std::string State<size>::toString() const
 
     oss << '\n';
 
-    for (i = 0; i < 4; ++i)
+    for (i = 0; i < NUM_OF_COLORS; ++i)
     {
         for (size_t k = 0; k < size; ++k)
         {
@@ -336,7 +522,7 @@ std::string State<size>::toString() const
 }
 
 template <size_t size>
-bool State<size>::isVictorious() const
+inline bool isGoal(const Bottle* bottles)
 {
     for (size_t i = 0; i < size; ++i) {
         if (!bottles[i].isComplete()) {
@@ -346,6 +532,12 @@ bool State<size>::isVictorious() const
     return true;
 }
 
+template <size_t size>
+bool State<size>::isVictorious() const
+{
+    return isGoal<size>(bottles);
+}
+
 template <size_t size>
 int State<size>::getDepth() const
 {
@@ -355,6 +547,29 @@ int State<size>::getDepth() const
     return 1 + prev->getDepth();
 }
 
+template <size_t size>
+int State<size>::heuristic() const
+{
+    int bottoms[TOTAL_COLORS + 1] = {};
+    int h = 0;
+
+    size_t i;
+
+    for (i = 0; i < size; ++i)
+    {
+        if (bottles[i].isEmpty()) continue;
+
+        h += bottles[i].segments() - 1;
+        bottoms[bottles[i].getColor(NUM_OF_COLORS - 1)] += 1;
+    }
+    for (i = 1; i <= TOTAL_COLORS; ++i) {
+        if (bottoms[i] > 1) {
+            h += bottoms[i] - 1;
+        }
+    }
+    return h;
+}
+
 template <size_t size>
 void State<size>::expand(std::vector<State<size>*>& children)
 {
@@ -383,6 +598,34 @@ void State<size>::expand(std::vector<State<size>*>& children)
     }
 }
 
+template <size_t size>
+State<size>* State<size>::move(int from, int to)
+{
+    State* child;
+
+    if (from < 0 || to < 0 || from >= static_cast<int>(size) || to >= static_cast<int>(size)
+        || from == to || !bottles[from].shouldPourTo(bottles[to]))
+    {
+        return nullptr;
+    }
+    child = new State<size>(*this);
+
+    pour(child, from, to);
+
+    return child;
+}
+
+template <size_t size>
+void State<size>::getMoves(std::vector<std::pair<int, int>>& moves) const
+{
+    moves.clear();
+
+    for (const State<size>* s = this; s->actionName[0]; s = s->prev) {
+        moves.push_back({ s->actionName[0], s->actionName[1] });
+    }
+    std::reverse(moves.begin(), moves.end());
+}
+
 template <size_t size>
 State<size>* State<size>::copyWholePath() const
 {
@@ -394,6 +637,18 @@ State<size>* State<size>::copyWholePath() const
     return s;
 }
 
+template <size_t size>
+void State<size>::deleteWholePath(State<size>* s)
+{
+    State<size>* p;
+
+    for (; s != nullptr; s = p)
+    {
+        p = s->getPrevious();
+        delete s;
+    }
+}
+
 template <size_t size>
 State<size>& State<size>::operator = (const State<size>& other)
 {
@@ -411,53 +666,38 @@ State<size>& State<size>::operator = (const State<size>& other)
 template <size_t size>
 bool State<size>::operator == (const State<size>& other) const
 {
-    if (this != &other)
-    {
-        for (size_t i = 0; i < size; ++i)
-        {
-            if (bottles[i].getByte(0) != other.bottles[i].getByte(0)
-                || bottles[i].getByte(1) != other.bottles[i].getByte(1)
-                ) {
-                return false;
-            }
-        }
-    }
-    return true;
+    return key() == other.key();
 }
 
 template <size_t size>
 bool State<size>::operator != (const State<size>& other) const
 {
-    if (this != &other)
-    {
-        for (size_t i = 0; i < size; ++i)
-        {
-            if (bottles[i].getColor(0) != other.bottles[i].getColor(0)
-                || bottles[i].getColor(1) != other.bottles[i].getColor(1)
-                || bottles[i].getColor(2) != other.bottles[i].getColor(2)
-                || bottles[i].getColor(3) != other.bottles[i].getColor(3)
-                ) {
-                return true;
-            }
-        }
-    }
-    return false;
+    return !(key() == other.key());
 }
 
-MemoryPool& getPool(size_t bytes)
+// Every bottle count is served by its own pool, as the unit size differs,
+// and every thread by its own arena, so that concurrent solvers never contend.
+// States must therefore be released by the thread that allocated them.
+template <size_t size>
+MemoryPool& getPool()
 {
-    static MemoryPool pool(bytes, 1073741824);  // One gigabyte per pocket
+    static thread_local MemoryPool pool(sizeof(State<size>), 1073741824);  // One gigabyte per pocket
     return pool;
 }
 
+// The size is always sizeof(State<size>), the block size of the pool.
 template <size_t size>
-void* State<size>::operator new(size_t bytes)
+void* State<size>::operator new(size_t)
 {
-    return reinterpret_cast<void*>(getPool(bytes).allocate());
+    SearchStats::ScopedPhase phase(SearchStats::sampling(), PHASE_ALLOCATE);
+
+    return reinterpret_cast<void*>(getPool<size>().allocate());
 }
 
 template <size_t size>
 void State<size>::operator delete(void* memory)
 {
-    getPool(sizeof(State<size>)).deallocate(reinterpret_cast<State<size> *>(memory));
+    SearchStats::ScopedPhase phase(SearchStats::sampling(), PHASE_ALLOCATE);
+
+    getPool<size>().deallocate(reinterpret_cast<State<size> *>(memory));
 }
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+
+#include "Bottle.h"
+
+
+/*
+ *  StateKey class:
+ *
+ *      Fixed-width integer image of a state's bottles, used for comparing,
+ *      hashing and sorting states. The packed bottle bytes (size * BOTTLE_SIZE)
+ *      are copied into the smallest number of 64-bit words and zero-padded,
+ *      so that with the default 2-byte bottles:
+ *      ->  size <= 4:    1 word  (uint64)
+ *      ->  size <= 8:    2 words (uint128)
+ *      ->  size <= 16:   4 words (uint256)
+ *      ->  size == 17:   5 words
+ *
+ *
+ *  Class' methods:
+ *
+ *  ->  StateKey(const Bottle *):
+ *          Key of the `size` bottles starting at the given address.
+ *
+ *  ->  operator == (const StateKey &):
+ *          Branch-free whole-word equality.
+ *
+ *  ->  operator < (const StateKey &):
+ *          Total order (word by word), for sorting keys.
+ *
+ *  ->  hash():
+ *          64-bit hash in which every input bit affects every output bit
+ *          (multiply-xorshift mixing of each word and a final avalanche).
+ */
+
+template <size_t size>
+class StateKey
+{
+public:
+    static constexpr size_t BYTES = size * BOTTLE_SIZE;
+    static constexpr size_t WORDS = (BYTES + 7) / 8;
+
+private:
+    uint64_t words[WORDS];
+
+    static uint64_t mix(uint64_t x)
+    {
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53ULL;
+        x ^= x >> 33;
+
+        return x;
+    }
+
+public:
+    StateKey() : words() {}
+
+    explicit StateKey(const Bottle* bottles) : words()
+    {
+        memcpy(words, bottles, BYTES);
+    }
+
+    uint64_t word(size_t i) const { return words[i]; }
+
+    uint64_t hash() const
+    {
+        uint64_t h = 0x9e3779b97f4a7c15ULL ^ BYTES;
+
+        for (size_t i = 0; i < WORDS; ++i) {
+            h = (h ^ mix(words[i] + i)) * 0x9e3779b97f4a7c15ULL;
+        }
+        return mix(h);
+    }
+
+    bool operator == (const StateKey& other) const
+    {
+        uint64_t diff = 0;
+
+        for (size_t i = 0; i < WORDS; ++i) {
+            diff |= words[i] ^ other.words[i];
+        }
+        return diff == 0;
+    }
+
+    bool operator != (const StateKey& other) const { return !(*this == other); }
+
+    bool operator < (const StateKey& other) const
+    {
+        for (size_t i = 0; i < WORDS; ++i) {
+            if (words[i] != other.words[i]) {
+                return words[i] < other.words[i];
+            }
+        }
+        return false;
+    }
+};
+
+namespace std
+{
+    template<size_t size>
+    struct hash<StateKey<size>>
+    {
+        size_t operator () (const StateKey<size>& k) const noexcept {
+            return static_cast<size_t>(k.hash());
+        }
+    };
+}
@@ -0,0 +1,249 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Bottle.h"
+
+
+/*
+ *  StateRanker class:
+ *
+ *      Perfect, minimal ranking of the states that can be formed from the
+ *      liquid of a given puzzle: every arrangement of its colored layers in
+ *      `size` bottles (liquid always resting at the bottom) is mapped to a
+ *      distinct integer in [0, states()), and back.
+ *
+ *      A state is described by:
+ *      ->  its fill levels, a composition of the U colored layers into
+ *          `size` parts of at most NUM_OF_COLORS, ranked lexicographically
+ *          through the number of ways to fill the remaining bottles, and
+ *      ->  the sequence of its layers' colors (bottle by bottle, bottom to
+ *          top), a permutation of a multiset ranked by counting the
+ *          permutations of the remaining layers (multinomial coefficients).
+ *
+ *          rank = fillRank * arrangements() + sequenceRank
+ *
+ *      The number of states grows quickly: 1.1e7 for 5 bottles of 3 colors,
+ *      6.0e10 for 6 bottles of 4 colors and 1.8e19 for 8 bottles of 6
+ *      colors, so dense tables indexed by rank only fit the smallest puzzles.
+ *
+ *
+ *  Class' methods:
+ *
+ *  ->  StateRanker(const Bottle *):
+ *          Ranker of the states sharing the liquid of the given bottles.
+ *
+ *  ->  rankable():
+ *          True if states() fits in 56 bits, the range within which rank()
+ *          and unrank() are exact.
+ *
+ *  ->  rank(const Bottle *):
+ *          Rank of the given bottles, which must hold the same liquid.
+ *
+ *  ->  unrank(uint64_t, Bottle *):
+ *          Writes the bottles of the given rank.
+ */
+
+template <size_t size>
+class StateRanker
+{
+public:
+    static constexpr size_t MAX_LAYERS = size * NUM_OF_COLORS;
+    static constexpr uint64_t MAX_STATES = static_cast<uint64_t>(1) << 56;
+
+private:
+    color_t m_colors[TOTAL_COLORS];             // Colors present, in increasing order.
+    int m_counts[TOTAL_COLORS];                 // Layers of every color present.
+    int m_index[TOTAL_COLORS + 1];              // Position of every color in m_colors.
+
+    size_t m_numColors;
+    int m_layers;                               // Colored layers in total.
+
+    uint64_t m_ways[size + 1][MAX_LAYERS + 1];  // Fillings of bottles [i, size) with t layers.
+    uint64_t m_arrangements;                    // Color sequences of the layers.
+    uint64_t m_states;
+
+    static uint64_t saturatingAdd(uint64_t a, uint64_t b) { return (a > UINT64_MAX - b ? UINT64_MAX : a + b); }
+
+    static uint64_t saturatingMul(uint64_t a, uint64_t b) { return (a != 0 && b > UINT64_MAX / a ? UINT64_MAX : a * b); }
+
+public:
+    explicit StateRanker(const Bottle* bottles) : m_counts(), m_numColors(0), m_layers(0)
+    {
+        uint64_t binomial[MAX_LAYERS + 1][MAX_LAYERS + 1] = {};
+
+        int seen[TOTAL_COLORS + 1] = {};
+        int running = 0;
+
+        color_t c;
+
+        size_t i;
+        size_t j;
+        int t;
+        int v;
+
+        for (i = 0; i < size; ++i)
+        {
+            for (j = 0; j < NUM_OF_COLORS; ++j)
+            {
+                if ((c = bottles[i].getColor(j)) != NO_COLOR)
+                {
+                    seen[c] += 1;
+                    m_layers += 1;
+                }
+            }
+        }
+        for (c = 1; c <= TOTAL_COLORS; ++c)
+        {
+            m_index[c] = static_cast<int>(m_numColors);
+
+            if (seen[c] > 0)
+            {
+                m_colors[m_numColors] = c;
+                m_counts[m_numColors++] = seen[c];
+            }
+        }
+
+        for (t = 0; t <= static_cast<int>(MAX_LAYERS); ++t) {
+            m_ways[size][t] = (t == 0);
+        }
+        for (i = size; i-- > 0;)
+        {
+            for (t = 0; t <= static_cast<int>(MAX_LAYERS); ++t)
+            {
+                m_ways[i][t] = 0;
+
+                for (v = 0; v <= NUM_OF_COLORS && v <= t; ++v) {
+                    m_ways[i][t] += m_ways[i + 1][t - v];
+                }
+            }
+        }
+
+        // Multinomial coefficient of the color counts, as a product of binomials.
+        for (i = 0; i <= MAX_LAYERS; ++i)
+        {
+            binomial[i][0] = 1;
+
+            for (j = 1; j <= i; ++j) {
+                binomial[i][j] = saturatingAdd(binomial[i - 1][j - 1], binomial[i - 1][j]);
+            }
+        }
+        m_arrangements = 1;
+
+        for (i = 0; i < m_numColors; ++i)
+        {
+            running += m_counts[i];
+            m_arrangements = saturatingMul(m_arrangements, binomial[running][m_counts[i]]);
+        }
+        m_states = saturatingMul(m_ways[0][m_layers], m_arrangements);
+    }
+
+    uint64_t states() const { return m_states; }
+
+    uint64_t arrangements() const { return m_arrangements; }
+
+    bool rankable() const { return m_states <= MAX_STATES; }
+
+    uint64_t rank(const Bottle* bottles) const
+    {
+        int counts[TOTAL_COLORS];
+
+        uint64_t fillRank = 0;
+        uint64_t sequenceRank = 0;
+        uint64_t permutations = m_arrangements;     // Permutations of the layers left.
+
+        int left = m_layers;
+        int smaller;
+        int free;
+        int level;
+        int v;
+        int c;
+
+        size_t i;
+        size_t k;
+
+        for (i = 0; i < m_numColors; ++i) {
+            counts[i] = m_counts[i];
+        }
+        for (i = 0; i < size; ++i)
+        {
+            bottles[i].top(free);
+            level = NUM_OF_COLORS - free;
+
+            for (v = 0; v < level; ++v) {
+                fillRank += m_ways[i + 1][left - v];
+            }
+
+            for (k = NUM_OF_COLORS; k-- > static_cast<size_t>(free);)
+            {
+                c = m_index[bottles[i].getColor(k)];
+
+                // Sequences placing a smaller color here come first (every term
+                // permutations * counts[v] / left is exact, so is their sum).
+                for (v = 0, smaller = 0; v < c; ++v) {
+                    smaller += counts[v];
+                }
+                sequenceRank += permutations * smaller / left;
+                permutations = permutations * counts[c] / left;
+                counts[c] -= 1;
+                left -= 1;
+            }
+        }
+        return fillRank * m_arrangements + sequenceRank;
+    }
+
+    void unrank(uint64_t r, Bottle* bottles) const
+    {
+        int counts[TOTAL_COLORS];
+        int levels[size];
+
+        uint64_t fillRank = r / m_arrangements;
+        uint64_t sequenceRank = r % m_arrangements;
+        uint64_t permutations = m_arrangements;
+        uint64_t block;
+
+        int left = m_layers;
+        int v;
+
+        size_t i;
+        size_t k;
+        size_t c;
+
+        for (i = 0; i < m_numColors; ++i) {
+            counts[i] = m_counts[i];
+        }
+        for (i = 0; i < size; ++i)
+        {
+            for (v = 0; fillRank >= m_ways[i + 1][left - v]; ++v) {
+                fillRank -= m_ways[i + 1][left - v];
+            }
+            levels[i] = v;
+            left -= v;
+        }
+
+        left = m_layers;
+
+        for (i = 0; i < size; ++i)
+        {
+            bottles[i] = Bottle();
+
+            for (k = NUM_OF_COLORS; k-- > static_cast<size_t>(NUM_OF_COLORS - levels[i]);)
+            {
+                for (c = 0;; ++c)
+                {
+                    block = permutations * counts[c] / left;
+
+                    if (sequenceRank < block) break;
+
+                    sequenceRank -= block;
+                }
+                bottles[i].setColor(k, m_colors[c]);
+
+                permutations = block;
+                counts[c] -= 1;
+                left -= 1;
+            }
+        }
+    }
+};
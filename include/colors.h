@@ -7,11 +7,18 @@
  *  ->  Absence of color code value.
  *  ->  Array containing the different colors as strings, each one indexed
  *      with it's matched code.
- *  ->  Size of aforementioned array.
+ *  ->  Size of aforementioned array, bounded by the colors that fit in a
+ *      layer's COLOR_BITS bits (set at configure time, see: README).
  */
 
 typedef unsigned char color_t;
 
+#ifndef WATERSORT_COLOR_BITS
+#   define WATERSORT_COLOR_BITS 4
+#endif
+
+#define COLOR_BITS  WATERSORT_COLOR_BITS
+
 #define NO_COLOR    static_cast<color_t>(0b00000000)  // 0
 
 #define BLACK       static_cast<color_t>(0b00000001)  // 1
@@ -29,12 +36,34 @@ typedef unsigned char color_t;
 #define ORANGE      static_cast<color_t>(0b00001101)  // 13
 #define PINK        static_cast<color_t>(0b00001110)  // 14
 #define RED         static_cast<color_t>(0b00001111)  // 15
+#define TEAL        static_cast<color_t>(0b00010000)  // 16
+#define NAVY        static_cast<color_t>(0b00010001)  // 17
+#define OLIVE       static_cast<color_t>(0b00010010)  // 18
+#define MAROON      static_cast<color_t>(0b00010011)  // 19
+#define CORAL       static_cast<color_t>(0b00010100)  // 20
+#define GOLD        static_cast<color_t>(0b00010101)  // 21
+#define VIOLET      static_cast<color_t>(0b00010110)  // 22
+#define SALMON      static_cast<color_t>(0b00010111)  // 23
+#define BEIGE       static_cast<color_t>(0b00011000)  // 24
+#define INDIGO      static_cast<color_t>(0b00011001)  // 25
+#define KHAKI       static_cast<color_t>(0b00011010)  // 26
+#define MINT        static_cast<color_t>(0b00011011)  // 27
+#define PLUM        static_cast<color_t>(0b00011100)  // 28
+#define SKY         static_cast<color_t>(0b00011101)  // 29
+#define TAN         static_cast<color_t>(0b00011110)  // 30
+#define AMBER       static_cast<color_t>(0b00011111)  // 31
 
 
 static const char* COLOR_STR[] = { "",
         "BLACK  ", "BROWN  ", "GREY   ", "YELLOW ", "CYAN   ",
         "MAGENTA", "LIME   ", "PURPLE ", "GREEN  ", "EMERALD",
-        "WHITE  ", "BLUE   ", "ORANGE ", "PINK   ", "RED    "
+        "WHITE  ", "BLUE   ", "ORANGE ", "PINK   ", "RED    ",
+        "TEAL   ", "NAVY   ", "OLIVE  ", "MAROON ", "CORAL  ",
+        "GOLD   ", "VIOLET ", "SALMON ", "BEIGE  ", "INDIGO ",
+        "KHAKI  ", "MINT   ", "PLUM   ", "SKY    ", "TAN    ",
+        "AMBER  "
 };
 
-constexpr size_t TOTAL_COLORS = (sizeof(COLOR_STR) / sizeof(COLOR_STR[0])) - 1 ;
+constexpr size_t NAMED_COLORS = (sizeof(COLOR_STR) / sizeof(COLOR_STR[0])) - 1;
+
+constexpr size_t TOTAL_COLORS = (COLOR_BITS < 8 && (1u << COLOR_BITS) - 1 < NAMED_COLORS ? (1u << COLOR_BITS) - 1 : NAMED_COLORS);
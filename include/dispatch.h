@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+
+
+/*
+ *  Runtime dispatch of the bottle count:
+ *
+ *      Every State<size> and search engine is specialized at compile time
+ *      for its number of bottles. dispatchBottles() instantiates a task for
+ *      every supported count in [MIN_BOTTLES, MAX_BOTTLES] and forwards
+ *      the call to the specialization matching the runtime value `n`.
+ *
+ *      A task is a class template over the bottle count that exposes
+ *      a static run(...) function returning an int, e.g.:
+ *
+ *          template <size_t size>
+ *          struct Solve
+ *          {
+ *              static int run(const Options &);
+ *          };
+ *
+ *          dispatchBottles<Solve>(n, options);
+ *
+ *      If `n` is out of range, fallback is returned.
+ *
+ *      MAX_BOTTLES is set at configure time (WATERSORT_MAX_BOTTLES, see:
+ *      README): every count adds a specialization of every engine to the
+ *      build, so it is kept no higher than the puzzles played need.
+ */
+
+#ifndef WATERSORT_MAX_BOTTLES
+#   define WATERSORT_MAX_BOTTLES    17
+#endif
+
+constexpr size_t MIN_BOTTLES = 3;
+constexpr size_t MAX_BOTTLES = WATERSORT_MAX_BOTTLES;
+
+template <template <size_t> class Task, size_t size = MIN_BOTTLES, typename... Args>
+int dispatchBottles(size_t n, int fallback, Args&... args)
+{
+    if constexpr (size > MAX_BOTTLES) {
+        return fallback;
+    }
+    else
+    {
+        if (n == size) {
+            return Task<size>::run(args...);
+        }
+        return dispatchBottles<Task, size + 1, Args...>(n, fallback, args...);
+    }
+}
@@ -0,0 +1,199 @@
+#ifndef WATERSORT_H
+#define WATERSORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/*
+ *  libwatersort C API:
+ *
+ *      Solves puzzles in-process through the same engines as the command
+ *      line program (see: Solver.h), for callers in C or any language with a
+ *      C foreign function interface. The library is built both as a static
+ *      (watersort) and a shared (watersort_shared) library.
+ *
+ *      Every call works on the calling thread, in caller-provided buffers,
+ *      with no global state: states are allocated from the calling thread's
+ *      own memory pool, created on its first call and reused by later ones,
+ *      so concurrent calls from different threads never contend. Errors are
+ *      reported by status codes; no C++ exception crosses the API.
+ *
+ *      Puzzles are given as packed bottles, WS_BOTTLE_BYTES per bottle (the
+ *      layout of the binary corpus, see: Corpus.h): WS_CAPACITY layers of
+ *      WS_COLOR_BITS-bit color codes (0 for empty, 1 to WS_MAX_COLOR
+ *      otherwise), most significant bits first, from the top layer in the
+ *      high bits of the first byte down to the bottom one, any padding bits
+ *      being 0. By default a bottle is 4 layers of 4 bits: the top layer in
+ *      the high nibble of the first byte and the bottom layer in the low
+ *      nibble of the last one. Every color present must fill exactly
+ *      WS_CAPACITY layers.
+ *
+ *      The layout and WS_MAX_BOTTLES are fixed when the library is built
+ *      (WATERSORT_CAPACITY, WATERSORT_COLOR_BITS, WATERSORT_MAX_BOTTLES);
+ *      callers must be compiled with the same definitions, which CMake
+ *      targets linking the library inherit. Callers of the shared library
+ *      should call ws_check_layout() once before any other call, as a
+ *      library built for another layout would misread every bottle.
+ *
+ *
+ *  ->  ws_default_options(ws_options *):
+ *          Fills in the default options (optimal BFS).
+ *
+ *  ->  ws_solve(bottles, num_bottles, options, moves, max_moves, num_moves, stats):
+ *          Solves the puzzle and writes the solution's pours to `moves` (up to
+ *          `max_moves` of them; *num_moves is set to the solution's length
+ *          even if they do not fit) and the search metrics to `stats`, both
+ *          optional. `options` may be NULL for the defaults.
+ *          Returns WS_OK, or a negative status.
+ *
+ *  ->  ws_hinter_create(num_bottles, max_states):
+ *          Hint oracle for the positions of a game in progress (see:
+ *          HintOracle.h), or NULL if the number of bottles is unsupported or
+ *          memory is short. `max_states` bounds the states a single hint may
+ *          search (0 for the default). A hinter must not be used by two
+ *          threads at once.
+ *
+ *  ->  ws_hint(hinter, bottles, move, distance):
+ *          Best pour from the position, written to `move` ({0, 0} if the
+ *          position is solved), and the number of moves left with the best
+ *          play to `distance`, both optional. Positions close to those of
+ *          earlier calls are answered without searching.
+ *          Returns WS_OK, or a negative status.
+ *
+ *  ->  ws_hinter_destroy(hinter):
+ *          Releases the hinter (NULL is ignored).
+ *
+ *  ->  ws_status_string(int status):
+ *          Static description of a status code.
+ *
+ *  ->  ws_api_version():
+ *          WS_API_VERSION of the library actually linked, for callers of the
+ *          shared library to check against the header they were built with.
+ *
+ *  ->  ws_layout(capacity, color_bits, max_bottles):
+ *          Layout the linked library was built for: WS_CAPACITY,
+ *          WS_COLOR_BITS and WS_MAX_BOTTLES as it saw them (NULL outputs
+ *          are skipped).
+ *
+ *  ->  ws_check_layout():
+ *          Inline in this header: WS_OK if the linked library has this
+ *          header's API version and layout, WS_LAYOUT_MISMATCH otherwise.
+ */
+
+#define WS_API_VERSION      3
+
+#ifndef WATERSORT_CAPACITY
+#   define WATERSORT_CAPACITY       4
+#endif
+#ifndef WATERSORT_COLOR_BITS
+#   define WATERSORT_COLOR_BITS     4
+#endif
+#ifndef WATERSORT_MAX_BOTTLES
+#   define WATERSORT_MAX_BOTTLES    17
+#endif
+
+#define WS_MIN_BOTTLES      3
+#define WS_MAX_BOTTLES      WATERSORT_MAX_BOTTLES
+#define WS_CAPACITY         WATERSORT_CAPACITY
+#define WS_COLOR_BITS       WATERSORT_COLOR_BITS
+#define WS_BOTTLE_BYTES     ((WS_CAPACITY * WS_COLOR_BITS + 7) / 8)
+#define WS_MAX_COLOR        ((1 << WS_COLOR_BITS) - 1 < 31 ? (1 << WS_COLOR_BITS) - 1 : 31)
+
+#if defined(_WIN32) && defined(WATERSORT_BUILD)
+#   define WS_API __declspec(dllexport)
+#elif defined(_WIN32) && defined(WATERSORT_DLL)
+#   define WS_API __declspec(dllimport)
+#else
+#   define WS_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum ws_status
+{
+    WS_OK = 0,
+    WS_UNSOLVED = -1,               /* The engine found no solution (e.g. the deadline expired). */
+    WS_INVALID_ARGUMENT = -2,       /* Null pointer or unsupported number of bottles. */
+    WS_INVALID_PUZZLE = -3,         /* Floating liquid, unknown color or a color not filling exactly WS_CAPACITY layers. */
+    WS_BUFFER_TOO_SMALL = -4,       /* The solution has more than max_moves pours (see: num_moves). */
+    WS_OUT_OF_MEMORY = -5,
+    WS_INTERNAL_ERROR = -6,
+    WS_LAYOUT_MISMATCH = -7         /* The library was built for another API version or bottle layout. */
+} ws_status;
+
+typedef enum ws_engine
+{
+    WS_ENGINE_BFS = 0,              /* Optimal. */
+    WS_ENGINE_ANYTIME = 1,          /* Beam search within a deadline, not necessarily optimal. */
+    WS_ENGINE_APPROXIMATE = 2,      /* BFS over a Bloom filter, optimal with high probability. */
+    WS_ENGINE_COMPACT = 3,          /* Optimal, memory-lean. */
+    WS_ENGINE_DENSE = 4,            /* Optimal, puzzles of up to 5 bottles (BFS otherwise). */
+    WS_ENGINE_PIPELINED = 5,        /* Optimal, multi-threaded (expansion and deduplication threads). */
+    WS_ENGINE_PORTFOLIO = 6         /* Races BFS, compact and anytime for the first optimal solution. */
+} ws_engine;
+
+typedef struct ws_options
+{
+    int engine;                     /* A ws_engine. */
+    uint64_t beam_width;            /* Initial beam width of the anytime engine. */
+    uint64_t deadline_ms;           /* Time budget of the anytime engine. */
+    uint64_t expected_nodes;        /* States the approximate engine's filter is sized for. */
+    double fp_rate;                 /* Target false positive rate of the approximate engine's filter. */
+    int relabel_colors;             /* Non-zero to merge states differing only in color names (BFS). */
+} ws_options;
+
+typedef struct ws_move
+{
+    uint8_t from;                   /* 1-based bottle numbers. */
+    uint8_t to;
+} ws_move;
+
+typedef struct ws_stats
+{
+    int optimal;                    /* Non-zero if the solution is proven optimal. */
+    size_t depth;                   /* Number of pours of the solution. */
+    uint64_t examined;              /* States expanded. */
+    uint64_t peak_nodes;            /* Peak number of states stored. */
+    uint64_t peak_bytes;            /* Peak bytes of memory of the search. */
+    double elapsed_ms;              /* Wall time of the search. */
+} ws_stats;
+
+WS_API void ws_default_options(ws_options* options);
+
+WS_API int ws_solve(const uint8_t* bottles, size_t num_bottles, const ws_options* options,
+    ws_move* moves, size_t max_moves, size_t* num_moves, ws_stats* stats);
+
+typedef struct ws_hinter ws_hinter;
+
+WS_API ws_hinter* ws_hinter_create(size_t num_bottles, uint64_t max_states);
+
+WS_API int ws_hint(ws_hinter* hinter, const uint8_t* bottles, ws_move* move, size_t* distance);
+
+WS_API void ws_hinter_destroy(ws_hinter* hinter);
+
+WS_API const char* ws_status_string(int status);
+
+WS_API int ws_api_version(void);
+
+WS_API void ws_layout(int* capacity, int* color_bits, int* max_bottles);
+
+static inline int ws_check_layout(void)
+{
+    int capacity, color_bits, max_bottles;
+
+    if (ws_api_version() != WS_API_VERSION) {
+        return WS_LAYOUT_MISMATCH;
+    }
+    ws_layout(&capacity, &color_bits, &max_bottles);
+
+    return (capacity == WS_CAPACITY && color_bits == WS_COLOR_BITS && max_bottles == WS_MAX_BOTTLES ? WS_OK : WS_LAYOUT_MISMATCH);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
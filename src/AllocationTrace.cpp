@@ -0,0 +1,140 @@
+#include "AllocationTrace.h"
+
+#include <cstring>
+
+#include "Endian.h"
+
+
+static const char TRACE_MAGIC[4] = { 'W', 'S', 'A', 'T' };
+
+// --------------------------- PRIVATE ---------------------------
+
+void AllocationTracer::drain()
+{
+    static constexpr size_t CHUNK_EVENTS = 4096;
+
+    uint8_t buffer[CHUNK_EVENTS * TRACE_EVENT_SIZE];
+
+    uint64_t tail = m_tail.load(std::memory_order_relaxed);
+    uint64_t head = m_head.load(std::memory_order_acquire);
+
+    size_t n;
+
+    while (tail != head)
+    {
+        for (n = 0; n < CHUNK_EVENTS && tail != head; ++n, ++tail)
+        {
+            const TraceEvent& e = m_ring[tail & (RING_EVENTS - 1)];
+            uint8_t* at = buffer + n * TRACE_EVENT_SIZE;
+
+            putLE<uint64_t>(at, e.time);
+            putLE<uint32_t>(at + 8, e.offset);
+            putLE<uint16_t>(at + 12, e.pocket);
+            at[14] = e.op;
+            at[15] = 0;
+        }
+        // Slots are handed back to the pool once they are copied out.
+        m_tail.store(tail, std::memory_order_release);
+
+        m_file.write(reinterpret_cast<const char*>(buffer), n * TRACE_EVENT_SIZE);
+    }
+}
+
+// --------------------------- PUBLIC ---------------------------
+
+AllocationTracer::AllocationTracer() : m_head(0), m_tail(0), m_stop(false), m_stalls(0)
+{
+}
+
+AllocationTracer::~AllocationTracer()
+{
+    close();
+}
+
+bool AllocationTracer::open(const std::string& path, size_t unitBytes, size_t pocketBytes)
+{
+    uint8_t header[TRACE_HEADER_SIZE] = {};
+
+    m_file.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+
+    if (!m_file.is_open()) {
+        return false;
+    }
+    memcpy(header, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+    putLE<uint16_t>(header + 4, TRACE_VERSION);
+    putLE<uint32_t>(header + 8, static_cast<uint32_t>(unitBytes));
+    putLE<uint64_t>(header + 16, static_cast<uint64_t>(pocketBytes));
+
+    m_file.write(reinterpret_cast<const char*>(header), TRACE_HEADER_SIZE);
+
+    m_ring.resize(RING_EVENTS);
+    m_t0 = std::chrono::steady_clock::now();
+    m_stop = false;
+
+    m_writer = std::thread([this] ()
+    {
+        while (!m_stop.load(std::memory_order_acquire))
+        {
+            drain();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        drain();
+    });
+
+    return m_file.good();
+}
+
+void AllocationTracer::close()
+{
+    if (!m_writer.joinable()) {
+        return;
+    }
+    m_stop.store(true, std::memory_order_release);
+    m_writer.join();
+    m_file.close();
+}
+
+bool AllocationTraceReader::open(const std::string& path, std::string& error)
+{
+    const uint8_t* header;
+
+    if (!m_file.open(path, false, error)) {
+        return false;
+    }
+    header = m_file.data();
+
+    if (m_file.size() < TRACE_HEADER_SIZE || memcmp(header, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0)
+    {
+        error = "not an allocation trace";
+        return false;
+    }
+    if (getLE<uint16_t>(header + 4) != TRACE_VERSION)
+    {
+        error = "unsupported trace version " + std::to_string(getLE<uint16_t>(header + 4));
+        return false;
+    }
+    m_unitBytes = getLE<uint32_t>(header + 8);
+    m_pocketBytes = static_cast<size_t>(getLE<uint64_t>(header + 16));
+    m_count = (m_file.size() - TRACE_HEADER_SIZE) / TRACE_EVENT_SIZE;
+
+    if (m_unitBytes == 0)
+    {
+        error = "invalid unit size";
+        return false;
+    }
+    return true;
+}
+
+TraceEvent AllocationTraceReader::eventAt(size_t i) const
+{
+    const uint8_t* at = m_file.data() + TRACE_HEADER_SIZE + i * TRACE_EVENT_SIZE;
+
+    TraceEvent e;
+
+    e.time = getLE<uint64_t>(at);
+    e.offset = getLE<uint32_t>(at + 8);
+    e.pocket = getLE<uint16_t>(at + 12);
+    e.op = at[14];
+
+    return e;
+}
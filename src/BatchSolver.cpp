@@ -0,0 +1,127 @@
+#include "BatchSolver.h"
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <iomanip>
+#include <sstream>
+#include <algorithm>
+
+#include "Puzzle.h"
+
+
+std::string toJson(uint64_t id, size_t bottles, const SolveResult& result)
+{
+    std::ostringstream oss;
+
+    oss << "{\"id\":" << id
+        << ",\"bottles\":" << bottles
+        << ",\"solved\":" << (result.solved ? "true" : "false")
+        << ",\"optimal\":" << (result.solved && result.optimal ? "true" : "false")
+        << ",\"cached\":" << (result.cached ? "true" : "false")
+        << ",\"depth\":" << result.depth
+        << ",\"moves\":[";
+
+    for (size_t i = 0; i < result.moves.size(); ++i) {
+        oss << (i > 0 ? "," : "") << '[' << result.moves[i].first << ',' << result.moves[i].second << ']';
+    }
+
+    oss << "],\"examined\":" << result.examined
+        << ",\"peak_nodes\":" << result.memory
+        << ",\"peak_bytes\":" << result.peakBytes
+        << ",\"elapsed_ms\":" << std::fixed << std::setprecision(3) << result.elapsedMs;
+
+    if (!result.error.empty()) {
+        oss << ",\"error\":\"" << result.error << '"';
+    }
+    if (result.engine == Engine::APPROXIMATE) {
+        oss << ",\"miss_probability\":" << std::scientific << std::setprecision(3) << result.missProbability;
+    }
+    if (!result.race.empty())
+    {
+        oss << ",\"engine\":\"" << engineName(result.engine) << "\",\"race\":[";
+
+        for (size_t i = 0; i < result.race.size(); ++i)
+        {
+            const RaceEntry& r = result.race[i];
+
+            oss << (i > 0 ? "," : "") << "{\"engine\":\"" << engineName(r.engine) << '"'
+                << ",\"solved\":" << (r.solved ? "true" : "false")
+                << ",\"optimal\":" << (r.optimal ? "true" : "false")
+                << ",\"cancelled\":" << (r.cancelled ? "true" : "false")
+                << ",\"depth\":" << r.depth
+                << ",\"elapsed_ms\":" << std::fixed << std::setprecision(3) << r.elapsedMs << '}';
+        }
+        oss << ']';
+    }
+    oss << '}';
+
+    return oss.str();
+}
+
+uint64_t runBatch(uint64_t count, const PuzzleSource& source, const BatchOptions& options, std::ostream& out, std::ostream& log)
+{
+    std::vector<std::thread> workers;
+
+    std::atomic<uint64_t> next(0);
+    std::atomic<uint64_t> solved(0);
+
+    std::mutex outputMutex;
+
+    size_t threads = static_cast<size_t>(std::max<uint64_t>(1, std::min<uint64_t>(options.threads, count)));
+
+    auto t0 = std::chrono::steady_clock::now();
+
+    auto work = [&]()
+    {
+        SolveResult result;
+        std::string record;
+        std::string error;
+
+        const Bottle* bottles;
+
+        uint64_t i;
+        size_t n;
+
+        while ((i = next.fetch_add(1)) < count)
+        {
+            bottles = source(i, n);
+
+            // Corpus records are not parsed, so they are checked here (see: checkPuzzle()).
+            if (!checkPuzzle(bottles, n, error))
+            {
+                result = SolveResult();
+                result.error = error;
+            }
+            else if (solvePuzzle(bottles, n, options.solver, result)) {
+                solved += 1;
+            }
+            record = toJson(i, n, result);
+
+            std::lock_guard<std::mutex> lock(outputMutex);
+            out << record << '\n' << std::flush;
+        }
+    };
+
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back(work);
+    }
+    for (std::thread& w : workers) {
+        w.join();
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    log << "> Solved " << solved << " / " << count << " puzzles in "
+        << std::fixed << std::setprecision(3) << seconds << " s using " << threads << " thread(s)\n"
+        << "> Throughput: " << std::setprecision(2) << (seconds > 0 ? count / seconds : 0.0) << " puzzles/s" << std::endl;
+
+    if (options.solver.cache != nullptr)
+    {
+        log << "> Cache: " << options.solver.cache->hits() << " hits, "
+            << options.solver.cache->misses() << " misses" << std::endl;
+    }
+
+    return solved;
+}
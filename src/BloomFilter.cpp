@@ -0,0 +1,61 @@
+#include "BloomFilter.h"
+
+#include <cmath>
+#include <algorithm>
+
+
+BloomFilter::BloomFilter(uint64_t expected, double falsePositiveRate) : m_inserted(0)
+{
+    const double ln2 = std::log(2.0);
+
+    double p = std::min(std::max(falsePositiveRate, 1e-12), 0.5);
+    double n = static_cast<double>(std::max<uint64_t>(expected, 1));
+
+    m_bits = std::max<uint64_t>(64, static_cast<uint64_t>(std::ceil(-n * std::log(p) / (ln2 * ln2))));
+    m_hashes = std::max(1u, static_cast<unsigned int>(std::lround(m_bits / n * ln2)));
+
+    m_words.assign((m_bits + 63) / 64, 0);
+}
+
+bool BloomFilter::insert(uint64_t hash)
+{
+    uint64_t h2 = ((hash >> 32) | (hash << 32)) * 0x9e3779b97f4a7c15ULL | 1;
+    uint64_t bit;
+
+    bool present = true;
+
+    for (unsigned int i = 0; i < m_hashes; ++i, hash += h2)
+    {
+        bit = hash % m_bits;
+
+        if (!((m_words[bit >> 6] >> (bit & 63)) & 1)) {
+            present = false;
+        }
+        m_words[bit >> 6] |= static_cast<uint64_t>(1) << (bit & 63);
+    }
+    if (!present) {
+        m_inserted += 1;
+    }
+    return present;
+}
+
+bool BloomFilter::contains(uint64_t hash) const
+{
+    uint64_t h2 = ((hash >> 32) | (hash << 32)) * 0x9e3779b97f4a7c15ULL | 1;
+    uint64_t bit;
+
+    for (unsigned int i = 0; i < m_hashes; ++i, hash += h2)
+    {
+        bit = hash % m_bits;
+
+        if (!((m_words[bit >> 6] >> (bit & 63)) & 1)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+double BloomFilter::falsePositiveRate() const
+{
+    return std::pow(1.0 - std::exp(-static_cast<double>(m_hashes) * m_inserted / m_bits), m_hashes);
+}
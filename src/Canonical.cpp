@@ -0,0 +1,169 @@
+#include "Canonical.h"
+
+#include <vector>
+#include <numeric>
+#include <algorithm>
+
+
+// Layout of a bottle regardless of its colors: each layer is numbered by
+// the first layer holding the same color (0 if empty), in base NUM_OF_COLORS + 1.
+static int layoutCode(const Bottle& b)
+{
+    int code = 0;
+    int label[NUM_OF_COLORS];
+
+    size_t i;
+    size_t j;
+
+    for (i = 0; i < NUM_OF_COLORS; ++i)
+    {
+        label[i] = 0;
+
+        if (b.getColor(i) != NO_COLOR)
+        {
+            for (j = 0; j < i && b.getColor(j) != b.getColor(i); ++j);
+            label[i] = static_cast<int>(j) + 1;
+        }
+        code = code * (NUM_OF_COLORS + 1) + label[i];
+    }
+    return code;
+}
+
+void canonicalize(const Bottle* bottles, size_t n, Bottle* canonical, size_t* perm)
+{
+    std::vector<std::vector<int>> signature(TOTAL_COLORS + 1);
+    std::vector<color_t> present;
+    std::vector<color_t> label(TOTAL_COLORS + 1);
+    std::vector<color_t> previous;
+    std::vector<size_t> order(n);
+
+    size_t i;
+    size_t j;
+    size_t rounds = 0;
+    color_t c;
+    color_t next;
+
+    // 1. Rank colors by their name-independent signature (equal signatures, equal ranks).
+    for (i = 0; i < n; ++i)
+    {
+        int code = layoutCode(bottles[i]);
+
+        for (j = 0; j < NUM_OF_COLORS; ++j) {
+            if ((c = bottles[i].getColor(j)) != NO_COLOR) {
+                signature[c].push_back(code * NUM_OF_COLORS + static_cast<int>(j));
+            }
+        }
+    }
+    for (c = 1; c <= TOTAL_COLORS; ++c)
+    {
+        if (!signature[c].empty())
+        {
+            std::sort(signature[c].begin(), signature[c].end());
+            present.push_back(c);
+        }
+    }
+    std::sort(present.begin(), present.end(), [&](color_t a, color_t b) {
+        return signature[a] < signature[b];
+    });
+    for (i = 0; i < present.size(); ++i) {
+        label[present[i]] = (i > 0 && signature[present[i]] == signature[present[i - 1]])
+            ? label[present[i - 1]]
+            : static_cast<color_t>(i + 1);
+    }
+
+    auto byLabels = [&](size_t a, size_t b)
+    {
+        for (size_t k = 0; k < NUM_OF_COLORS; ++k)
+        {
+            if (label[bottles[a].getColor(k)] != label[bottles[b].getColor(k)]) {
+                return label[bottles[a].getColor(k)] < label[bottles[b].getColor(k)];
+            }
+        }
+        return false;
+    };
+
+    std::iota(order.begin(), order.end(), 0);
+
+    // 2-3. Sort bottles, renumber colors by first appearance, repeat until stable.
+    while (previous != label && rounds++ < 2 * NUM_OF_COLORS)
+    {
+        std::stable_sort(order.begin(), order.end(), byLabels);
+
+        previous = label;
+        label.assign(TOTAL_COLORS + 1, NO_COLOR);
+        next = 1;
+
+        for (i = 0; i < n; ++i) {
+            for (j = 0; j < NUM_OF_COLORS; ++j) {
+                if ((c = bottles[order[i]].getColor(j)) != NO_COLOR && label[c] == NO_COLOR) {
+                    label[c] = next++;
+                }
+            }
+        }
+    }
+
+    for (i = 0; i < n; ++i)
+    {
+        perm[i] = order[i];
+        canonical[i] = Bottle();
+
+        for (j = 0; j < NUM_OF_COLORS; ++j) {
+            canonical[i].setColor(j, label[bottles[order[i]].getColor(j)]);
+        }
+    }
+}
+
+uint64_t canonicalHash(const Bottle* canonical, size_t n)
+{
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        for (size_t j = 0; j < BOTTLE_SIZE; ++j)
+        {
+            hash ^= canonical[i].getByte(j);
+            hash *= 1099511628211ULL;
+        }
+    }
+    return hash != 0 ? hash : 1;
+}
+
+void relabelColors(const Bottle* bottles, size_t n, Bottle* relabeled, color_t* original)
+{
+    color_t label[TOTAL_COLORS + 1] = {};
+    color_t next = 0;
+    color_t c;
+
+    size_t i;
+    size_t j;
+
+    if (original != nullptr) {
+        std::fill(original, original + TOTAL_COLORS + 1, NO_COLOR);
+    }
+    for (i = 0; i < n; ++i)
+    {
+        const Bottle b = bottles[i];    // bottles and relabeled may alias.
+
+        for (j = 0; j < NUM_OF_COLORS; ++j)
+        {
+            if ((c = b.getColor(j)) != NO_COLOR && label[c] == NO_COLOR)
+            {
+                label[c] = ++next;
+
+                if (original != nullptr) {
+                    original[next] = c;
+                }
+            }
+            relabeled[i].setColor(j, label[c]);
+        }
+    }
+}
+
+void restoreColors(Bottle* bottles, size_t n, const color_t* original)
+{
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = 0; j < NUM_OF_COLORS; ++j) {
+            bottles[i].setColor(j, original[bottles[i].getColor(j)]);
+        }
+    }
+}
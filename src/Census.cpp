@@ -0,0 +1,59 @@
+#include <iomanip>
+#include <sstream>
+
+#include "Census.h"
+#include "dispatch.h"
+
+
+template <size_t size>
+struct TakeCensus
+{
+    static int run(const Bottle*& bottles, const CensusOptions& options, CensusReport& report, const std::atomic<bool>*& cancel)
+    {
+        return census<size>(bottles, options, report, cancel) ? 1 : 0;
+    }
+};
+
+bool takeCensus(const Bottle* bottles, size_t n, const CensusOptions& options, CensusReport& report,
+    const std::atomic<bool>* cancel)
+{
+    report = CensusReport();
+
+    return dispatchBottles<TakeCensus>(n, 0, bottles, options, report, cancel) == 1;
+}
+
+static void writeCounts(std::ostream& out, const char* name, const std::vector<uint64_t>& counts)
+{
+    out << ",\"" << name << "\":[";
+
+    for (size_t i = 0; i < counts.size(); ++i) {
+        out << (i ? "," : "") << counts[i];
+    }
+    out << "]";
+}
+
+std::string censusJson(uint64_t id, const CensusReport& report)
+{
+    std::ostringstream out;
+
+    out << std::fixed << std::setprecision(3)
+        << "{\"id\":" << id
+        << ",\"bottles\":" << report.bottles
+        << ",\"complete\":" << (report.complete ? "true" : "false")
+        << ",\"states\":" << report.states
+        << ",\"goals\":" << report.goals
+        << ",\"dead_ends\":" << report.deadEnds
+        << ",\"solvable\":" << report.solvable
+        << ",\"start_distance\":" << report.startDistance
+        << ",\"depth\":" << report.depth
+        << ",\"eccentricity\":" << report.eccentricity;
+
+    writeCounts(out, "layers", report.layers);
+    writeCounts(out, "distances", report.distances);
+    writeCounts(out, "branching", report.branching);
+
+    out << ",\"peak_bytes\":" << report.peakBytes
+        << ",\"elapsed_ms\":" << report.elapsedMs << "}";
+
+    return out.str();
+}
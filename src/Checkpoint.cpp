@@ -0,0 +1,155 @@
+#include "Checkpoint.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include "Bottle.h"
+#include "Endian.h"
+
+
+static const char CHECKPOINT_MAGIC[4] = { 'W', 'S', 'C', 'K' };
+
+std::string checkpointPath(const std::string& directory)
+{
+    return directory + "/checkpoint.wsck";
+}
+
+bool readCheckpoint(const std::string& directory, CheckpointHeader& header,
+    std::vector<uint8_t>& puzzle, std::vector<uint8_t>& data, std::string& error)
+{
+    std::ifstream file(checkpointPath(directory), std::ios::in | std::ios::binary | std::ios::ate);
+
+    uint8_t bytes[CHECKPOINT_HEADER_SIZE];
+
+    std::streamoff length;
+
+    error.clear();
+
+    if (!file.is_open()) {
+        return false;
+    }
+    length = file.tellg();
+    file.seekg(0);
+
+    if (length < static_cast<std::streamoff>(CHECKPOINT_HEADER_SIZE)
+        || !file.read(reinterpret_cast<char*>(bytes), CHECKPOINT_HEADER_SIZE)
+        || memcmp(bytes, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0)
+    {
+        error = "not a checkpoint";
+        return false;
+    }
+    if (getLE<uint16_t>(bytes + 4) != CHECKPOINT_VERSION)
+    {
+        error = "unsupported checkpoint version " + std::to_string(getLE<uint16_t>(bytes + 4));
+        return false;
+    }
+    if (bytes[24] != BOTTLE_LAYOUT)
+    {
+        error = "the checkpoint was written for another bottle layout (see: Bottle.h)";
+        return false;
+    }
+    header.bottles = bytes[6];
+    header.depth = bytes[7];
+    header.count = getLE<uint64_t>(bytes + 8);
+    header.examined = getLE<uint64_t>(bytes + 16);
+
+    puzzle.resize(header.bottles * BOTTLE_SIZE);
+
+    if (length < static_cast<std::streamoff>(CHECKPOINT_HEADER_SIZE + puzzle.size()))
+    {
+        error = "truncated checkpoint";
+        return false;
+    }
+    data.resize(static_cast<size_t>(length) - CHECKPOINT_HEADER_SIZE - puzzle.size());
+
+    if (!file.read(reinterpret_cast<char*>(puzzle.data()), puzzle.size())
+        || !file.read(reinterpret_cast<char*>(data.data()), data.size()))
+    {
+        error = "could not read the checkpoint";
+        return false;
+    }
+    return true;
+}
+
+CheckpointWriter::CheckpointWriter(const CheckpointOptions& options, CheckpointReport* report)
+    : m_directory(options.directory), m_last(std::chrono::steady_clock::now()), m_intervalMs(options.intervalMs),
+      m_report(report), m_depth(-1), m_failed(false) {}
+
+bool CheckpointWriter::due() const
+{
+    // m_failed is only read once the writing thread is joined.
+    return !m_thread.joinable() && !m_failed
+        && std::chrono::steady_clock::now() - m_last >= std::chrono::milliseconds(m_intervalMs);
+}
+
+void CheckpointWriter::start(const CheckpointHeader& header, const uint8_t* puzzle, size_t keyBytes, const uint8_t* data, size_t bytes)
+{
+    wait();
+
+    m_last = std::chrono::steady_clock::now();
+    m_depth = header.depth;
+    m_thread = std::thread(&CheckpointWriter::write, this, header, puzzle, keyBytes, data, bytes);
+}
+
+void CheckpointWriter::wait()
+{
+    if (!m_thread.joinable()) {
+        return;
+    }
+    m_thread.join();
+
+    if (!m_failed && m_report != nullptr)
+    {
+        m_report->written += 1;
+        m_report->lastDepth = m_depth;
+    }
+}
+
+void CheckpointWriter::write(CheckpointHeader header, const uint8_t* puzzle, size_t keyBytes, const uint8_t* data, size_t bytes)
+{
+    const std::string path = checkpointPath(m_directory);
+    const std::string temporary = path + ".tmp";
+
+    uint8_t bytesOut[CHECKPOINT_HEADER_SIZE] = {};
+
+    {
+        std::ofstream file(temporary, std::ios::out | std::ios::binary | std::ios::trunc);
+
+        memcpy(bytesOut, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+        putLE<uint16_t>(bytesOut + 4, CHECKPOINT_VERSION);
+        bytesOut[6] = static_cast<uint8_t>(header.bottles);
+        bytesOut[7] = static_cast<uint8_t>(header.depth);
+        putLE<uint64_t>(bytesOut + 8, header.count);
+        putLE<uint64_t>(bytesOut + 16, header.examined);
+        bytesOut[24] = BOTTLE_LAYOUT;
+
+        file.write(reinterpret_cast<const char*>(bytesOut), CHECKPOINT_HEADER_SIZE);
+        file.write(reinterpret_cast<const char*>(puzzle), keyBytes);
+        file.write(reinterpret_cast<const char*>(data), bytes);
+        file.close();
+
+        if (!file.good())
+        {
+            m_failed = true;
+
+            if (m_report != nullptr) {
+                m_report->error = "could not write \"" + temporary + "\"";
+            }
+            std::remove(temporary.c_str());
+            return;
+        }
+    }
+
+    // The previous checkpoint is only replaced by a complete one (atomically,
+    // where rename() may replace a file; removed first elsewhere).
+    if (std::rename(temporary.c_str(), path.c_str()) != 0
+        && (std::remove(path.c_str()) != 0 || std::rename(temporary.c_str(), path.c_str()) != 0))
+    {
+        m_failed = true;
+
+        if (m_report != nullptr) {
+            m_report->error = "could not rename \"" + temporary + "\"";
+        }
+    }
+}
@@ -0,0 +1,124 @@
+#include "Corpus.h"
+
+#include <cstring>
+
+#include "Endian.h"
+
+
+// --------------------------- WRITER ---------------------------
+
+bool CorpusWriter::open(const std::string& path, size_t bottles)
+{
+    uint8_t header[CORPUS_HEADER_SIZE] = {};
+
+    close();
+
+    m_bottles = bottles;
+    m_count = 0;
+
+    m_file.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+
+    if (!m_file.is_open()) {
+        return false;
+    }
+
+    memcpy(header, CORPUS_MAGIC, sizeof(CORPUS_MAGIC));
+    putLE<uint16_t>(header + 4, CORPUS_VERSION);
+    putLE<uint16_t>(header + 6, static_cast<uint16_t>(bottles));
+    putLE<uint32_t>(header + 8, static_cast<uint32_t>(bottles * BOTTLE_SIZE));
+    header[12] = BOTTLE_LAYOUT;
+
+    m_file.write(reinterpret_cast<const char*>(header), CORPUS_HEADER_SIZE);
+
+    return m_file.good();
+}
+
+bool CorpusWriter::write(const Bottle* bottles)
+{
+    char record[BOTTLE_SIZE];
+
+    for (size_t i = 0; i < m_bottles; ++i)
+    {
+        for (size_t j = 0; j < BOTTLE_SIZE; ++j) {
+            record[j] = static_cast<char>(bottles[i].getByte(j));
+        }
+        m_file.write(record, BOTTLE_SIZE);
+    }
+    m_count += 1;
+
+    return m_file.good();
+}
+
+bool CorpusWriter::close()
+{
+    uint8_t count[8];
+    bool ok;
+
+    if (!m_file.is_open()) {
+        return true;
+    }
+
+    putLE<uint64_t>(count, m_count);
+
+    m_file.seekp(16);
+    m_file.write(reinterpret_cast<const char*>(count), sizeof(count));
+
+    ok = m_file.good();
+
+    m_file.close();
+
+    return ok;
+}
+
+// --------------------------- READER ---------------------------
+
+bool CorpusReader::open(const std::string& path, std::string& error)
+{
+    const uint8_t* header;
+
+    if (!m_mapping.open(path, false, error)) {
+        return false;
+    }
+    header = m_mapping.data();
+
+    if (m_mapping.size() < CORPUS_HEADER_SIZE || memcmp(header, CORPUS_MAGIC, sizeof(CORPUS_MAGIC)) != 0)
+    {
+        error = "\"" + path + "\" is not a puzzle corpus";
+        return false;
+    }
+    if (getLE<uint16_t>(header + 4) != CORPUS_VERSION)
+    {
+        error = "unsupported corpus version " + std::to_string(getLE<uint16_t>(header + 4));
+        return false;
+    }
+    if (header[12] != BOTTLE_LAYOUT)
+    {
+        error = "\"" + path + "\" was written for another bottle layout (see: Bottle.h)";
+        return false;
+    }
+
+    m_bottles = getLE<uint16_t>(header + 6);
+    m_recordBytes = getLE<uint32_t>(header + 8);
+    m_count = getLE<uint64_t>(header + 16);
+    m_records = header + CORPUS_HEADER_SIZE;
+
+    // Divides rather than multiplies, so a corrupted count cannot overflow.
+    if (m_recordBytes == 0 || m_recordBytes != m_bottles * BOTTLE_SIZE
+        || m_count > (m_mapping.size() - CORPUS_HEADER_SIZE) / m_recordBytes)
+    {
+        error = "\"" + path + "\" is truncated or corrupted";
+        return false;
+    }
+    return true;
+}
+
+bool CorpusReader::isCorpus(const std::string& path)
+{
+    std::ifstream ifs(path, std::ios::in | std::ios::binary);
+
+    char magic[sizeof(CORPUS_MAGIC)] = {};
+
+    ifs.read(magic, sizeof(magic));
+
+    return ifs.good() && memcmp(magic, CORPUS_MAGIC, sizeof(CORPUS_MAGIC)) == 0;
+}
@@ -0,0 +1,203 @@
+#include "EndgameDatabase.h"
+
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <algorithm>
+#include <unordered_set>
+
+#include "dispatch.h"
+#include "Endian.h"
+#include "StateKey.h"
+#include "Retrograde.h"
+
+
+static const char ENDGAME_MAGIC[4] = { 'W', 'S', 'E', 'G' };
+
+template <size_t size>
+struct EndgameBuildTask
+{
+    static constexpr size_t KEY_BYTES = size * BOTTLE_SIZE;
+
+    typedef std::array<uint8_t, KEY_BYTES + 1> record_t;   // Canonical bottles and distance.
+
+    static int run(const std::string& path, const EndgameBuildOptions& options, EndgameBuildReport& report, std::string& error)
+    {
+        const size_t colors = (options.colors > 0 ? options.colors : size - 2);
+
+        std::unordered_set<StateKey<size>> seen;
+
+        std::vector<record_t> records;
+
+        Bottle state[size];
+        Bottle canonical[size];
+
+        uint8_t header[ENDGAME_HEADER_SIZE] = {};
+
+        size_t begin = 0;
+        size_t end;
+        size_t i;
+        int depth;
+
+        auto t0 = std::chrono::steady_clock::now();
+
+        if (colors == 0 || colors > size || colors > TOTAL_COLORS || options.radius < 0 || options.radius > 254)
+        {
+            error = "invalid number of colors or radius";
+            return 0;
+        }
+        report = EndgameBuildReport();
+
+        // The solved position: colors 1, 2, ... each in a full bottle.
+        for (i = 0; i < size; ++i)
+        {
+            const color_t c = static_cast<color_t>(i < colors ? i + 1 : NO_COLOR);
+
+            state[i] = Bottle::filled(c);
+        }
+        sortBottles(state, size);
+
+        seen.insert(StateKey<size>(state));
+        records.emplace_back();
+        memcpy(records.back().data(), state, KEY_BYTES);
+        records.back()[KEY_BYTES] = 0;
+
+        // Records are appended layer by layer: [begin, end) holds the states at `depth`.
+        for (depth = 0; depth < options.radius && begin < records.size(); ++depth)
+        {
+            report.histogram.push_back(records.size() - begin);
+
+            for (end = records.size(); begin < end; ++begin)
+            {
+                memcpy(state, records[begin].data(), KEY_BYTES);
+
+                forEachPredecessor<size>(state, [&](const Bottle* predecessor, int, int)
+                {
+                    memcpy(canonical, predecessor, KEY_BYTES);
+                    sortBottles(canonical, size);
+
+                    if (seen.insert(StateKey<size>(canonical)).second)
+                    {
+                        records.emplace_back();
+                        memcpy(records.back().data(), canonical, KEY_BYTES);
+                        records.back()[KEY_BYTES] = static_cast<uint8_t>(depth + 1);
+                    }
+                    return false;
+                });
+            }
+        }
+        if (begin < records.size()) {
+            report.histogram.push_back(records.size() - begin);
+        }
+        seen = std::unordered_set<StateKey<size>>();
+
+        std::sort(records.begin(), records.end(), [](const record_t& a, const record_t& b) {
+            return memcmp(a.data(), b.data(), KEY_BYTES) < 0;
+        });
+
+        std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+
+        if (!file.is_open())
+        {
+            error = "could not create the file";
+            return 0;
+        }
+        memcpy(header, ENDGAME_MAGIC, sizeof(ENDGAME_MAGIC));
+        putLE<uint16_t>(header + 4, ENDGAME_VERSION);
+        header[6] = static_cast<uint8_t>(size);
+        header[7] = static_cast<uint8_t>(colors);
+        header[8] = static_cast<uint8_t>(options.radius);
+        header[9] = BOTTLE_LAYOUT;
+        putLE<uint64_t>(header + 16, records.size());
+
+        file.write(reinterpret_cast<const char*>(header), ENDGAME_HEADER_SIZE);
+        file.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(record_t));
+
+        if (!file.good())
+        {
+            error = "could not write the file";
+            return 0;
+        }
+        report.records = records.size();
+        report.elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+        return 1;
+    }
+};
+
+bool buildEndgameDatabase(const std::string& path, const EndgameBuildOptions& options, EndgameBuildReport& report, std::string& error)
+{
+    if (dispatchBottles<EndgameBuildTask>(options.bottles, -1, path, options, report, error) < 0)
+    {
+        error = "unsupported number of bottles";
+        return false;
+    }
+    return error.empty();
+}
+
+bool EndgameDatabase::open(const std::string& path, std::string& error)
+{
+    const uint8_t* header;
+
+    if (!m_file.open(path, false, error)) {
+        return false;
+    }
+    header = m_file.data();
+
+    if (m_file.size() < ENDGAME_HEADER_SIZE || memcmp(header, ENDGAME_MAGIC, sizeof(ENDGAME_MAGIC)) != 0)
+    {
+        error = "not an endgame database";
+        return false;
+    }
+    if (getLE<uint16_t>(header + 4) != ENDGAME_VERSION)
+    {
+        error = "unsupported endgame database version " + std::to_string(getLE<uint16_t>(header + 4));
+        return false;
+    }
+    if (header[9] != BOTTLE_LAYOUT)
+    {
+        error = "the endgame database was written for another bottle layout (see: Bottle.h)";
+        return false;
+    }
+    m_bottles = header[6];
+    m_colors = header[7];
+    m_radius = header[8];
+    m_records = getLE<uint64_t>(header + 16);
+
+    if (m_bottles < MIN_BOTTLES || m_bottles > MAX_BOTTLES || m_colors > m_bottles
+        || m_records * (m_bottles * BOTTLE_SIZE + 1) != m_file.size() - ENDGAME_HEADER_SIZE)
+    {
+        error = "invalid endgame database header";
+        return false;
+    }
+    return true;
+}
+
+bool EndgameDatabase::find(const uint8_t* key, int& distance) const
+{
+    const size_t keyBytes = m_bottles * BOTTLE_SIZE;
+    const uint8_t* records = m_file.data() + ENDGAME_HEADER_SIZE;
+
+    uint64_t lo = 0;
+    uint64_t hi = m_records;
+    uint64_t mid;
+
+    int cmp;
+
+    while (lo < hi)
+    {
+        mid = (lo + hi) / 2;
+        cmp = memcmp(key, records + mid * (keyBytes + 1), keyBytes);
+
+        if (cmp == 0)
+        {
+            distance = records[mid * (keyBytes + 1) + keyBytes];
+            return true;
+        }
+        if (cmp < 0)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    return false;
+}
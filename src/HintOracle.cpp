@@ -0,0 +1,23 @@
+#include "HintOracle.h"
+#include "dispatch.h"
+
+
+template <size_t size>
+struct MakeHinter
+{
+    static int run(std::unique_ptr<Hinter>& hinter, const HintOptions& options)
+    {
+        hinter.reset(new HintOracle<size>(options));
+
+        return 1;
+    }
+};
+
+std::unique_ptr<Hinter> makeHinter(size_t n, const HintOptions& options)
+{
+    std::unique_ptr<Hinter> hinter;
+
+    dispatchBottles<MakeHinter>(n, 0, hinter, options);
+
+    return hinter;
+}
@@ -0,0 +1,132 @@
+#include "MappedFile.h"
+
+#if defined(_WIN32)
+#   include <windows.h>
+#else
+#   include <fcntl.h>
+#   include <unistd.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#endif
+
+#include <cstring>
+#include <cerrno>
+
+
+#if defined(_WIN32)
+
+MappedFile::MappedFile()
+    : m_data(nullptr), m_size(0), m_file(INVALID_HANDLE_VALUE), m_mapping(nullptr) {}
+
+bool MappedFile::open(const std::string& path, bool writable, std::string& error)
+{
+    LARGE_INTEGER length;
+
+    close();
+
+    m_file = CreateFileA(path.c_str(), GENERIC_READ | (writable ? GENERIC_WRITE : 0), FILE_SHARE_READ,
+        nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+    if (m_file == INVALID_HANDLE_VALUE || !GetFileSizeEx(m_file, &length) || length.QuadPart == 0)
+    {
+        error = "could not open \"" + path + "\"";
+        close();
+        return false;
+    }
+    m_mapping = CreateFileMappingA(m_file, nullptr, writable ? PAGE_READWRITE : PAGE_READONLY, 0, 0, nullptr);
+
+    if (m_mapping != nullptr) {
+        m_data = reinterpret_cast<uint8_t*>(MapViewOfFile(m_mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0));
+    }
+    if (m_data == nullptr)
+    {
+        error = "could not map \"" + path + "\"";
+        close();
+        return false;
+    }
+    m_size = static_cast<size_t>(length.QuadPart);
+
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (m_data != nullptr) {
+        UnmapViewOfFile(m_data);
+    }
+    if (m_mapping != nullptr) {
+        CloseHandle(m_mapping);
+    }
+    if (m_file != INVALID_HANDLE_VALUE) {
+        CloseHandle(m_file);
+    }
+    m_data = nullptr;
+    m_size = 0;
+    m_mapping = nullptr;
+    m_file = INVALID_HANDLE_VALUE;
+}
+
+bool MappedFile::sync()
+{
+    return m_data != nullptr && FlushViewOfFile(m_data, 0) != 0;
+}
+
+#else
+
+MappedFile::MappedFile()
+    : m_data(nullptr), m_size(0), m_fd(-1) {}
+
+bool MappedFile::open(const std::string& path, bool writable, std::string& error)
+{
+    struct stat st {};
+    void* address;
+
+    close();
+
+    errno = 0;
+    m_fd = ::open(path.c_str(), writable ? O_RDWR : O_RDONLY);
+
+    if (m_fd < 0 || fstat(m_fd, &st) != 0 || st.st_size == 0)
+    {
+        error = "could not open \"" + path + "\": " + (errno ? strerror(errno) : "empty file");
+        close();
+        return false;
+    }
+    address = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ | (writable ? PROT_WRITE : 0), MAP_SHARED, m_fd, 0);
+
+    if (address == MAP_FAILED)
+    {
+        error = "could not map \"" + path + "\": " + strerror(errno);
+        close();
+        return false;
+    }
+    m_data = reinterpret_cast<uint8_t*>(address);
+    m_size = static_cast<size_t>(st.st_size);
+
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (m_data != nullptr) {
+        munmap(m_data, m_size);
+    }
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+    m_data = nullptr;
+    m_size = 0;
+    m_fd = -1;
+}
+
+bool MappedFile::sync()
+{
+    return m_data != nullptr && msync(m_data, m_size, MS_SYNC) == 0;
+}
+
+#endif
+
+MappedFile::~MappedFile()
+{
+    close();
+}
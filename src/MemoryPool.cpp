@@ -1,5 +1,6 @@
 #include "MemoryPool.h"
 
+#include <atomic>
 #include <iostream>
 #include <exception>
 #include <cstdarg>
@@ -26,6 +27,12 @@ std::ofstream& MemoryPool::memoryAllocationLogger()
     return logger;
 }
 
+std::string& MemoryPool::tracePrefix()
+{
+    static std::string prefix;
+    return prefix;
+}
+
 inline void MemoryPool::logMessage(const char* format...)
 {
     if constexpr (MemoryPool::MEMORY_LOGGING_ENABLED)
@@ -55,14 +62,35 @@ MemoryPool::MemoryPool(size_t inst_bytes, size_t alloc_bytes)
     init(m_allocatedPockets[0]);
 
     m_pocketIndex = 0;
+    m_unitsInUse = 0;
+    m_peakUnitsInUse = 0;
 
     m_currentPocket = &m_allocatedPockets[0];
+
+    if (!tracePrefix().empty())
+    {
+        static std::atomic<unsigned int> s_tracedPools(0);
+
+        std::string path = tracePrefix() + "." + std::to_string(s_tracedPools++) + ".wsat";
+
+        m_tracer.reset(new AllocationTracer());
+
+        if (!m_tracer->open(path, m_unitByteSize, m_allocationBytes))
+        {
+            std::cerr << "Could not open allocation trace \"" << path << "\".\n";
+            m_tracer.reset();
+        }
+        else m_tracer->record(TRACE_POCKET, 0, 0);
+    }
 }
 
 MemoryPool::~MemoryPool()
 {
     logMessage("Cleaning, 0x%p\n", reinterpret_cast<void*>(this));
 
+    // Flushed before the pockets are released.
+    m_tracer.reset();
+
     for (pocket& p : m_allocatedPockets) {
         free(p.m_pAllocatedMemBlock);
     }
@@ -75,6 +103,10 @@ void* MemoryPool::allocate()
         m_allocatedPockets.push_back({});
         init(m_allocatedPockets[++m_pocketIndex]);
         m_currentPocket = &m_allocatedPockets[m_pocketIndex];
+
+        if (m_tracer) {
+            m_tracer->record(TRACE_POCKET, m_pocketIndex, 0);
+        }
     }
 
     logMessage("\nPocket [-0x%p-] (%d) has %zu space left in bytes\n",
@@ -84,6 +116,10 @@ void* MemoryPool::allocate()
     );
     logMessage("\t > ALLOCATING %zu bytes: ", m_unitByteSize);
 
+    if (++m_unitsInUse > m_peakUnitsInUse) {
+        m_peakUnitsInUse = m_unitsInUse;
+    }
+
     if (m_pocketsWithGaps.empty())
     {
         char* temp = reinterpret_cast<char*>(m_currentPocket->m_pAllocatedMemBlock);
@@ -92,6 +128,10 @@ void* MemoryPool::allocate()
 
         m_currentPocket->m_totalAvailableBytes -= m_unitByteSize;
 
+        if (m_tracer) {
+            m_tracer->record(TRACE_ALLOCATE, m_pocketIndex, m_currentPocket->m_totalAllocatedUnits);
+        }
+
         return reinterpret_cast<void*>(temp + m_unitByteSize * (m_currentPocket->m_totalAllocatedUnits++));
     }
     size_t at = m_pocketsWithGaps.begin()->first;
@@ -111,6 +151,12 @@ void* MemoryPool::allocate()
         m_pocketsWithGaps.erase(at);
     }
 
+    if (m_tracer)
+    {
+        m_tracer->record(TRACE_REUSE, at,
+            (reinterpret_cast<char*>(freeSpace) - reinterpret_cast<char*>(m_allocatedPockets[at].m_pAllocatedMemBlock)) / m_unitByteSize);
+    }
+
     return freeSpace;
 }
 
@@ -135,10 +181,22 @@ void MemoryPool::deallocate(void* mem)
                 m_allocatedPockets[i].m_gapsInPocket.size() + 1
             );
 
+            m_unitsInUse -= 1;
             m_pocketsWithGaps[static_cast<size_t>(i)] += 1;
             m_allocatedPockets[i].m_gapsInPocket.push(mem);
+
+            if (m_tracer)
+            {
+                m_tracer->record(TRACE_RELEASE, static_cast<size_t>(i),
+                    (reinterpret_cast<char*>(mem) - reinterpret_cast<char*>(m_allocatedPockets[i].m_pAllocatedMemBlock)) / m_unitByteSize);
+            }
             return;
         }
     }
     throw std::exception();
 }
+
+void MemoryPool::enableTracing(const std::string& prefix)
+{
+    tracePrefix() = prefix;
+}
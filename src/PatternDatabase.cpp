@@ -0,0 +1,303 @@
+#include "PatternDatabase.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <cstring>
+#include <fstream>
+
+#include "dispatch.h"
+#include "Endian.h"
+
+
+static const char PDB_MAGIC[4] = { 'W', 'S', 'P', 'D' };
+
+// Runs body(thread) on `threads` threads and waits for all of them.
+template <typename Body>
+static void parallel(size_t threads, Body body)
+{
+    std::vector<std::thread> workers;
+
+    for (size_t t = 1; t < threads; ++t) {
+        workers.emplace_back(body, t);
+    }
+    body(0);
+
+    for (std::thread& w : workers) {
+        w.join();
+    }
+}
+
+template <size_t size>
+struct BuildTask
+{
+    static constexpr size_t CHUNK = 4096;   // Frontier states handed to a thread at a time.
+
+    // Abstract goals: every bottle empty or full of one color, each pattern color in exactly one bottle.
+    static void goals(Bottle* bottles, size_t i, int* left, size_t codes, std::vector<Bottle>& out)
+    {
+        size_t c;
+
+        if (i == size)
+        {
+            out.insert(out.end(), bottles, bottles + size);
+            return;
+        }
+        for (c = 0; c <= codes; ++c)
+        {
+            if (left[c] == 0) continue;
+
+            left[c] -= 1;
+            bottles[i] = Bottle::filled(static_cast<color_t>(c));
+
+            goals(bottles, i + 1, left, codes, out);
+
+            left[c] += 1;
+        }
+    }
+
+    static int run(const std::string& path, const PatternBuildOptions& options, PatternBuildReport& report, std::string& error)
+    {
+        const size_t colors = (options.colors > 0 ? options.colors : size - 2);
+        const size_t threads = std::max<size_t>(options.threads, 1);
+
+        Bottle model[size];
+
+        std::unique_ptr<std::atomic<uint8_t>[]> distances;
+
+        std::vector<Bottle> goalStates;
+        std::vector<uint64_t> layer;
+        std::vector<std::vector<uint64_t>> found(threads);
+
+        std::atomic<size_t> next;
+
+        uint8_t header[PDB_HEADER_SIZE] = {};
+
+        int left[TOTAL_COLORS + 1] = {};
+        int depth = 0;
+
+        auto t0 = std::chrono::steady_clock::now();
+
+        if (colors == 0 || colors > size || options.pattern == 0 || options.pattern > colors || options.pattern + 1 > TOTAL_COLORS)
+        {
+            error = "invalid numbers of colors and pattern colors";
+            return 0;
+        }
+        patternTemplate(colors, options.pattern, model, size);
+
+        StateRanker<size> ranker(model);
+
+        if (!ranker.rankable() || ranker.states() > PDB_MAX_ENTRIES)
+        {
+            error = "the abstract state space is too large (" + std::to_string(ranker.states()) + " states)";
+            return 0;
+        }
+        report = PatternBuildReport();
+        report.entries = ranker.states();
+
+        distances.reset(new std::atomic<uint8_t>[report.entries]);
+
+        parallel(threads, [&](size_t t)
+        {
+            for (uint64_t r = report.entries * t / threads; r < report.entries * (t + 1) / threads; ++r) {
+                distances[r].store(PDB_UNREACHABLE, std::memory_order_relaxed);
+            }
+        });
+
+        left[0] = static_cast<int>(size - colors);
+        left[options.pattern + 1] = static_cast<int>(colors - options.pattern);
+
+        for (size_t c = 1; c <= options.pattern; ++c) {
+            left[c] = 1;
+        }
+        goals(model, 0, left, options.pattern + (colors > options.pattern), goalStates);
+
+        for (size_t i = 0; i < goalStates.size(); i += size)
+        {
+            layer.push_back(ranker.rank(&goalStates[i]));
+            distances[layer.back()].store(0, std::memory_order_relaxed);
+        }
+
+        // Backward BFS: predecessors of the layer are claimed by the first thread to reach them.
+        while (!layer.empty() && depth + 1 < PDB_UNREACHABLE)
+        {
+            report.histogram.push_back(layer.size());
+            report.reachable += layer.size();
+
+            next = 0;
+
+            parallel(threads, [&](size_t t)
+            {
+                Bottle state[size];
+                Bottle p[size];
+
+                color_t c;
+
+                size_t begin;
+                int top;
+                int run;
+                int space;
+                int a;
+                int b;
+                int k;
+                int i;
+
+                uint64_t r;
+
+                uint8_t unseen;
+
+                found[t].clear();
+
+                while ((begin = next.fetch_add(CHUNK)) < layer.size())
+                {
+                    for (size_t n = begin; n < std::min(begin + CHUNK, layer.size()); ++n)
+                    {
+                        ranker.unrank(layer[n], state);
+
+                        for (b = 0; b < static_cast<int>(size); ++b)
+                        {
+                            if ((c = state[b].top(top)) == NO_COLOR) continue;
+
+                            for (run = 0; top + run < NUM_OF_COLORS && state[b].getColor(top + run) == c; ++run);
+
+                            for (a = 0; a < static_cast<int>(size); ++a)
+                            {
+                                if (a == b) continue;
+
+                                state[a].top(space);
+
+                                // Undoes an abstract pour of k layers from `a` into `b`, which
+                                // needed the rest of b to accept color c (same color or empty).
+                                for (k = 1; k <= run && k <= space; ++k)
+                                {
+                                    if (k == run && top + run < NUM_OF_COLORS) break;
+
+                                    memcpy(p, state, sizeof(p));
+
+                                    for (i = 0; i < k; ++i)
+                                    {
+                                        p[b].setColor(top + i, NO_COLOR);
+                                        p[a].setColor(space - 1 - i, c);
+                                    }
+                                    r = ranker.rank(p);
+
+                                    unseen = PDB_UNREACHABLE;
+
+                                    if (distances[r].load(std::memory_order_relaxed) == PDB_UNREACHABLE
+                                        && distances[r].compare_exchange_strong(unseen, static_cast<uint8_t>(depth + 1), std::memory_order_relaxed))
+                                    {
+                                        found[t].push_back(r);
+                                    }
+                                }
+                            }
+                        }
+                    }
+                }
+            });
+
+            layer.clear();
+
+            for (std::vector<uint64_t>& f : found)
+            {
+                layer.insert(layer.end(), f.begin(), f.end());
+                std::vector<uint64_t>().swap(f);
+            }
+            depth += 1;
+        }
+
+        std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+        std::vector<uint8_t> buffer(1 << 20);
+
+        if (!file.is_open())
+        {
+            error = "could not create the file";
+            return 0;
+        }
+        memcpy(header, PDB_MAGIC, sizeof(PDB_MAGIC));
+        putLE<uint16_t>(header + 4, PDB_VERSION);
+        header[6] = static_cast<uint8_t>(size);
+        header[7] = static_cast<uint8_t>(colors);
+        header[8] = static_cast<uint8_t>(options.pattern);
+        header[9] = BOTTLE_LAYOUT;
+        putLE<uint64_t>(header + 16, report.entries);
+
+        file.write(reinterpret_cast<const char*>(header), PDB_HEADER_SIZE);
+
+        for (uint64_t r = 0; r < report.entries; r += buffer.size())
+        {
+            const size_t n = static_cast<size_t>(std::min<uint64_t>(buffer.size(), report.entries - r));
+
+            for (size_t i = 0; i < n; ++i) {
+                buffer[i] = distances[r + i].load(std::memory_order_relaxed);
+            }
+            file.write(reinterpret_cast<const char*>(buffer.data()), n);
+        }
+        if (!file.good())
+        {
+            error = "could not write the file";
+            return 0;
+        }
+        report.elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+        return 1;
+    }
+};
+
+bool buildPatternDatabase(const std::string& path, const PatternBuildOptions& options, PatternBuildReport& report, std::string& error)
+{
+    if (dispatchBottles<BuildTask>(options.bottles, -1, path, options, report, error) < 0)
+    {
+        error = "unsupported number of bottles";
+        return false;
+    }
+    return error.empty();
+}
+
+void patternTemplate(size_t colors, size_t pattern, Bottle* bottles, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        const color_t c = static_cast<color_t>(i < pattern ? i + 1 : pattern + 1);
+
+        bottles[i] = (i < colors ? Bottle::filled(c) : Bottle());
+    }
+}
+
+bool PatternDatabase::open(const std::string& path, std::string& error)
+{
+    const uint8_t* header;
+
+    if (!m_file.open(path, false, error)) {
+        return false;
+    }
+    header = m_file.data();
+
+    if (m_file.size() < PDB_HEADER_SIZE || memcmp(header, PDB_MAGIC, sizeof(PDB_MAGIC)) != 0)
+    {
+        error = "not a pattern database";
+        return false;
+    }
+    if (getLE<uint16_t>(header + 4) != PDB_VERSION)
+    {
+        error = "unsupported pattern database version " + std::to_string(getLE<uint16_t>(header + 4));
+        return false;
+    }
+    if (header[9] != BOTTLE_LAYOUT)
+    {
+        error = "the pattern database was written for another bottle layout (see: Bottle.h)";
+        return false;
+    }
+    m_bottles = header[6];
+    m_colors = header[7];
+    m_pattern = header[8];
+    m_entries = getLE<uint64_t>(header + 16);
+
+    if (m_entries != m_file.size() - PDB_HEADER_SIZE || m_bottles < MIN_BOTTLES || m_bottles > MAX_BOTTLES
+        || m_colors > m_bottles || m_pattern == 0 || m_pattern > m_colors)
+    {
+        error = "invalid pattern database header";
+        return false;
+    }
+    return true;
+}
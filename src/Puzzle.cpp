@@ -0,0 +1,146 @@
+#include "Puzzle.h"
+
+#include <cctype>
+#include <sstream>
+
+
+// Layer digits: color codes in base 36, hexadecimal for up to 15 colors.
+static const char DIGITS[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+
+static_assert(TOTAL_COLORS < sizeof(DIGITS) - 1, "every color code needs a digit");
+
+// Color code of a layer digit (either case), or -1 if it is not one.
+static int layerDigit(char d)
+{
+    d = static_cast<char>(tolower(static_cast<unsigned char>(d)));
+
+    for (size_t c = 0; c <= TOTAL_COLORS; ++c) {
+        if (DIGITS[c] == d) {
+            return static_cast<int>(c);
+        }
+    }
+    return -1;
+}
+
+bool parsePuzzle(const std::string& line, std::vector<Bottle>& bottles, std::string& error)
+{
+    std::istringstream iss(line);
+    std::string token;
+
+    size_t i;
+    color_t c;
+    Bottle b;
+
+    bottles.clear();
+
+    while (iss >> token)
+    {
+        if (token.size() != NUM_OF_COLORS)
+        {
+            error = "bottle \"" + token + "\" must consist of " + std::to_string(NUM_OF_COLORS) + " digits";
+            return false;
+        }
+        for (i = 0; i < NUM_OF_COLORS; ++i)
+        {
+            if (layerDigit(token[i]) < 0)
+            {
+                error = "invalid color '" + std::string(1, token[i]) + "' in bottle \"" + token + "\"";
+                return false;
+            }
+            c = static_cast<color_t>(layerDigit(token[i]));
+
+            if (c == NO_COLOR && i > 0 && b.getColor(i - 1) != NO_COLOR)
+            {
+                error = "liquid floats above an empty layer in bottle \"" + token + "\"";
+                return false;
+            }
+            b.setColor(i, c);
+        }
+        bottles.push_back(b);
+    }
+
+    return checkPuzzle(bottles.data(), bottles.size(), error);
+}
+
+bool checkPuzzle(const Bottle* bottles, size_t n, std::string& error)
+{
+    size_t count[TOTAL_COLORS + 1] = {};
+    size_t i;
+    size_t j;
+    color_t c;
+
+    if (n == 0)
+    {
+        error = "empty puzzle";
+        return false;
+    }
+    for (i = 0; i < n; ++i)
+    {
+        for (j = 0; j < NUM_OF_COLORS; ++j)
+        {
+            c = bottles[i].getColor(j);
+
+            if (c > TOTAL_COLORS)
+            {
+                error = "invalid color " + std::to_string(c) + " in bottle " + std::to_string(i + 1);
+                return false;
+            }
+            if (c == NO_COLOR && j > 0 && bottles[i].getColor(j - 1) != NO_COLOR)
+            {
+                error = "liquid floats above an empty layer in bottle " + std::to_string(i + 1);
+                return false;
+            }
+            count[c] += 1;
+        }
+    }
+    for (i = 1; i <= TOTAL_COLORS; ++i)
+    {
+        if (count[i] != 0 && count[i] != NUM_OF_COLORS)
+        {
+            error = "color " + std::to_string(i) + " appears " + std::to_string(count[i])
+                + " times instead of " + std::to_string(NUM_OF_COLORS);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool readPuzzles(std::istream& is, std::vector<std::vector<Bottle>>& puzzles, std::string& error)
+{
+    std::string line;
+    std::vector<Bottle> bottles;
+
+    size_t lineNumber = 0;
+
+    while (std::getline(is, line))
+    {
+        lineNumber += 1;
+
+        if (line.find_first_not_of(" \t\r") == std::string::npos || line[line.find_first_not_of(" \t\r")] == '#') {
+            continue;
+        }
+        if (!parsePuzzle(line, bottles, error))
+        {
+            error = "line " + std::to_string(lineNumber) + ": " + error;
+            return false;
+        }
+        puzzles.push_back(bottles);
+    }
+    return true;
+}
+
+std::string formatPuzzle(const Bottle* bottles, size_t n)
+{
+    std::string result;
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (i > 0) {
+            result += ' ';
+        }
+        for (size_t j = 0; j < NUM_OF_COLORS; ++j) {
+            result += DIGITS[bottles[i].getColor(j)];
+        }
+    }
+    return result;
+}
@@ -0,0 +1,194 @@
+#include "SearchStats.h"
+
+#include <iomanip>
+#include <algorithm>
+
+
+static const char* PHASE_NAMES[NUM_OF_PHASES] = { "expand", "hash", "lookup", "allocate" };
+
+
+SearchStats::SearchStats(std::ostream* progress, uint64_t progressIntervalMs, uint32_t samplingPeriod) :
+    m_progress(progress),
+    m_progressIntervalMs(progressIntervalMs),
+    m_samplingPeriod(std::max<uint32_t>(samplingPeriod, 1))
+{
+    start("", 0);
+}
+
+void SearchStats::start(const char* engine, size_t bottles)
+{
+    m_engine = engine;
+    m_bottles = bottles;
+    m_solved = false;
+    m_solutionDepth = 0;
+
+    m_t0 = clock::now();
+    m_lastProgress = m_t0;
+    m_elapsedUs = 0;
+
+    m_layers.clear();
+
+    m_expanded = 0;
+    m_lookups = 0;
+    m_hits = 0;
+    m_probedLookups = 0;
+    m_probeLength = 0;
+    m_maxProbeLength = 0;
+    m_peakPoolBytes = 0;
+
+    m_sampledNodes = 0;
+    std::fill(m_sampledNs, m_sampledNs + NUM_OF_PHASES, 0);
+
+    m_enclosing = NUM_OF_PHASES;
+}
+
+uint64_t SearchStats::sinceStartUs() const
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - m_t0).count());
+}
+
+void SearchStats::beginLayer(int depth)
+{
+    Layer layer {};
+
+    layer.depth = depth;
+    layer.startUs = sinceStartUs();
+
+    m_layers.push_back(layer);
+}
+
+void SearchStats::endLayer(uint64_t frontier, uint64_t closed, uint64_t poolBytes)
+{
+    Layer& layer = m_layers.back();
+
+    layer.frontier = frontier;
+    layer.closed = closed;
+    layer.poolBytes = poolBytes;
+    layer.endUs = sinceStartUs();
+
+    m_peakPoolBytes = std::max(m_peakPoolBytes, poolBytes);
+}
+
+void SearchStats::finish(bool solved, int depth)
+{
+    m_solved = solved;
+    m_solutionDepth = depth;
+    m_elapsedUs = sinceStartUs();
+
+    if (!m_layers.empty() && m_layers.back().endUs == 0) {
+        m_layers.back().endUs = m_elapsedUs;
+    }
+    s_sampling = nullptr;
+}
+
+void SearchStats::progress(uint64_t frontier, uint64_t closed, uint64_t poolBytes)
+{
+    clock::time_point now;
+
+    double seconds;
+
+    if (m_progress == nullptr || m_progressIntervalMs == 0) {
+        return;
+    }
+    now = clock::now();
+
+    if (now - m_lastProgress < std::chrono::milliseconds(m_progressIntervalMs)) {
+        return;
+    }
+    m_lastProgress = now;
+    m_peakPoolBytes = std::max(m_peakPoolBytes, poolBytes);
+
+    seconds = std::chrono::duration<double>(now - m_t0).count();
+
+    *m_progress << "> [" << std::fixed << std::setprecision(1) << std::setw(8) << seconds << " s] "
+        << "depth " << std::setw(2) << m_layers.back().depth
+        << " | examined " << std::setw(11) << m_expanded
+        << " (" << std::setprecision(0) << (seconds > 0 ? m_expanded / seconds : 0) << "/s)"
+        << " | frontier " << std::setw(10) << frontier
+        << " | closed " << std::setw(10) << closed
+        << " | duplicates " << std::setprecision(1) << std::setw(5) << 100 * duplicateRate() << "%"
+        << " | pool " << std::setprecision(1) << poolBytes / 1048576.0 << " MB" << std::endl;
+}
+
+double SearchStats::phaseMs(SearchPhase phase) const
+{
+    double ns;
+
+    if (m_sampledNodes == 0) {
+        return 0;
+    }
+    ns = static_cast<double>(m_sampledNs[phase]);
+
+    // Children are hashed once more by their closed set probes.
+    if (phase == PHASE_LOOKUP) {
+        ns = std::max(0.0, ns - static_cast<double>(m_sampledNs[PHASE_HASH]));
+    }
+    return ns * (static_cast<double>(m_expanded) / m_sampledNodes) / 1e6;
+}
+
+void SearchStats::writeJson(std::ostream& out) const
+{
+    size_t i;
+
+    out << std::fixed << std::setprecision(3)
+        << "{\n"
+        << "  \"engine\": \"" << m_engine << "\",\n"
+        << "  \"bottles\": " << m_bottles << ",\n"
+        << "  \"solved\": " << (m_solved ? "true" : "false") << ",\n"
+        << "  \"depth\": " << m_solutionDepth << ",\n"
+        << "  \"elapsed_ms\": " << m_elapsedUs / 1000.0 << ",\n"
+        << "  \"examined\": " << m_expanded << ",\n"
+        << "  \"lookups\": " << m_lookups << ",\n"
+        << "  \"duplicate_rate\": " << duplicateRate() << ",\n"
+        << "  \"mean_probe_length\": " << meanProbeLength() << ",\n"
+        << "  \"max_probe_length\": " << m_maxProbeLength << ",\n"
+        << "  \"peak_pool_bytes\": " << m_peakPoolBytes << ",\n"
+        << "  \"sampled_states\": " << m_sampledNodes << ",\n"
+        << "  \"phase_ms\": {";
+
+    for (i = 0; i < NUM_OF_PHASES; ++i) {
+        out << (i ? ", " : " ") << '"' << PHASE_NAMES[i] << "\": " << phaseMs(static_cast<SearchPhase>(i));
+    }
+    out << " },\n"
+        << "  \"layers\": [";
+
+    for (i = 0; i < m_layers.size(); ++i)
+    {
+        const Layer& l = m_layers[i];
+
+        out << (i ? ",\n" : "\n")
+            << "    {\"depth\":" << l.depth << ",\"expanded\":" << l.expanded << ",\"generated\":" << l.generated
+            << ",\"duplicates\":" << l.duplicates << ",\"frontier\":" << l.frontier << ",\"closed\":" << l.closed
+            << ",\"pool_bytes\":" << l.poolBytes << ",\"elapsed_ms\":" << (l.endUs - l.startUs) / 1000.0 << "}";
+    }
+    out << "\n  ]\n}" << std::endl;
+}
+
+void SearchStats::writeChromeTrace(std::ostream& out) const
+{
+    size_t i;
+
+    out << "{\"traceEvents\":[\n"
+        << "{\"name\":\"search\",\"cat\":\"" << m_engine << "\",\"ph\":\"X\",\"ts\":0,\"dur\":" << m_elapsedUs
+        << ",\"pid\":1,\"tid\":1,\"args\":{\"bottles\":" << m_bottles << ",\"solved\":" << (m_solved ? "true" : "false")
+        << ",\"depth\":" << m_solutionDepth << ",\"examined\":" << m_expanded;
+
+    out << std::fixed << std::setprecision(3);
+
+    for (i = 0; i < NUM_OF_PHASES; ++i) {
+        out << ",\"" << PHASE_NAMES[i] << "_ms\":" << phaseMs(static_cast<SearchPhase>(i));
+    }
+    out << "}}";
+
+    for (const Layer& l : m_layers)
+    {
+        out << ",\n{\"name\":\"layer " << l.depth << "\",\"cat\":\"layer\",\"ph\":\"X\",\"ts\":" << l.startUs
+            << ",\"dur\":" << l.endUs - l.startUs << ",\"pid\":1,\"tid\":2,\"args\":{\"expanded\":" << l.expanded
+            << ",\"generated\":" << l.generated << ",\"duplicates\":" << l.duplicates << "}}"
+            << ",\n{\"name\":\"states\",\"ph\":\"C\",\"ts\":" << l.endUs << ",\"pid\":1,\"args\":{\"frontier\":"
+            << l.frontier << ",\"closed\":" << l.closed << "}}"
+            << ",\n{\"name\":\"pool_bytes\",\"ph\":\"C\",\"ts\":" << l.endUs << ",\"pid\":1,\"args\":{\"bytes\":"
+            << l.poolBytes << "}}";
+    }
+    out << "\n]}" << std::endl;
+}
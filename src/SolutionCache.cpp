@@ -0,0 +1,235 @@
+#include "SolutionCache.h"
+#include "Canonical.h"
+
+#include <fstream>
+#include <cstring>
+#include <climits>
+#include <algorithm>
+
+#define CACHE_MAGIC     "WSSC"
+#define CACHE_VERSION   static_cast<uint16_t>(1)
+
+/*
+ *  Header (first slot of the file):
+ *      0   4   magic "WSSC"
+ *      4   2   version
+ *      6   2   slot size in bytes
+ *      8   4   number of buckets
+ *      12  4   number of ways per bucket
+ *      16  4   global tick (last use stamp)
+ *      20  1   bottle layout (BOTTLE_LAYOUT, see: Bottle.h)
+ */
+
+// --------------------------- PRIVATE ---------------------------
+
+uint8_t* SolutionCache::slot(size_t bucket, size_t way) const
+{
+    return m_file.data() + CACHE_SLOT_BYTES * (1 + bucket * CACHE_WAYS + way);
+}
+
+uint32_t SolutionCache::tick()
+{
+    uint32_t t;
+
+    memcpy(&t, m_file.data() + 16, sizeof(t));
+    t += 1;
+    memcpy(m_file.data() + 16, &t, sizeof(t));
+
+    return t;
+}
+
+uint8_t* SolutionCache::find(const Bottle* canonical, size_t n, uint64_t hash) const
+{
+    uint8_t* s;
+    uint64_t h;
+
+    if (n * BOTTLE_SIZE > CACHE_MOVES_OFFSET - CACHE_KEY_OFFSET) {
+        return nullptr;
+    }
+    for (size_t way = 0; way < CACHE_WAYS; ++way)
+    {
+        s = slot(hash % m_buckets, way);
+
+        memcpy(&h, s, sizeof(h));
+
+        if (h == hash && s[12] == n && memcmp(s + CACHE_KEY_OFFSET, canonical, n * BOTTLE_SIZE) == 0) {
+            return s;
+        }
+    }
+    return nullptr;
+}
+
+// --------------------------- PUBLIC ---------------------------
+
+bool SolutionCache::open(const std::string& path, size_t maxBytes, std::string& error)
+{
+    uint8_t header[CACHE_SLOT_BYTES] = {};
+    uint16_t version;
+    uint16_t slotBytes;
+    uint32_t ways;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (!std::ifstream(path).good())
+    {
+        std::ofstream ofs(path, std::ios::out | std::ios::binary | std::ios::trunc);
+
+        m_buckets = static_cast<uint32_t>(std::max<size_t>(1, maxBytes / (CACHE_SLOT_BYTES * CACHE_WAYS)));
+        ways = CACHE_WAYS;
+        version = CACHE_VERSION;
+        slotBytes = CACHE_SLOT_BYTES;
+
+        memcpy(header, CACHE_MAGIC, 4);
+        memcpy(header + 4, &version, sizeof(version));
+        memcpy(header + 6, &slotBytes, sizeof(slotBytes));
+        memcpy(header + 8, &m_buckets, sizeof(m_buckets));
+        memcpy(header + 12, &ways, sizeof(ways));
+        header[20] = BOTTLE_LAYOUT;
+
+        // Empty slots are left as a sparse, zero-filled tail.
+        ofs.write(reinterpret_cast<const char*>(header), CACHE_SLOT_BYTES);
+        ofs.seekp(static_cast<std::streamoff>(CACHE_SLOT_BYTES * (1 + static_cast<size_t>(m_buckets) * CACHE_WAYS) - 1));
+        ofs.put('\0');
+
+        if (!ofs.good())
+        {
+            error = "could not create \"" + path + "\"";
+            return false;
+        }
+    }
+
+    if (!m_file.open(path, true, error)) {
+        return false;
+    }
+
+    memcpy(&version, m_file.data() + 4, sizeof(version));
+    memcpy(&slotBytes, m_file.data() + 6, sizeof(slotBytes));
+    memcpy(&m_buckets, m_file.data() + 8, sizeof(m_buckets));
+    memcpy(&ways, m_file.data() + 12, sizeof(ways));
+
+    if (memcmp(m_file.data(), CACHE_MAGIC, 4) != 0 || version != CACHE_VERSION || slotBytes != CACHE_SLOT_BYTES
+        || ways != CACHE_WAYS || m_file.data()[20] != BOTTLE_LAYOUT || m_buckets == 0 || m_file.size() < CACHE_SLOT_BYTES * (1 + static_cast<size_t>(m_buckets) * CACHE_WAYS))
+    {
+        error = "\"" + path + "\" is not a compatible solution cache";
+        m_file.close();
+        return false;
+    }
+    return true;
+}
+
+bool SolutionCache::lookup(const Bottle* bottles, size_t n, bool requireOptimal, std::vector<std::pair<int, int>>& moves, bool& optimal)
+{
+    std::vector<Bottle> canonical(n);
+    std::vector<size_t> perm(n);
+
+    uint8_t* s;
+    uint32_t stamp;
+
+    canonicalize(bottles, n, canonical.data(), perm.data());
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (!m_file.isOpen() || (s = find(canonical.data(), n, canonicalHash(canonical.data(), n))) == nullptr
+        || (requireOptimal && !(s[13] & 1)))
+    {
+        m_misses += 1;
+        return false;
+    }
+
+    stamp = tick();
+    memcpy(s + 8, &stamp, sizeof(stamp));
+
+    optimal = (s[13] & 1) != 0;
+    moves.clear();
+
+    for (size_t i = 0; i < s[14]; ++i)
+    {
+        moves.push_back({
+            static_cast<int>(perm[s[CACHE_MOVES_OFFSET + 2 * i]]) + 1,
+            static_cast<int>(perm[s[CACHE_MOVES_OFFSET + 2 * i + 1]]) + 1
+        });
+    }
+    m_hits += 1;
+
+    return true;
+}
+
+void SolutionCache::store(const Bottle* bottles, size_t n, const std::vector<std::pair<int, int>>& moves, bool optimal)
+{
+    std::vector<Bottle> canonical(n);
+    std::vector<size_t> perm(n);
+    std::vector<size_t> inverse(n);
+
+    uint8_t* s;
+    uint8_t* candidate;
+    uint32_t stamp;
+    uint32_t oldest;
+    uint64_t hash;
+    uint64_t h;
+
+    if (moves.size() > CACHE_MAX_MOVES || n * BOTTLE_SIZE > CACHE_MOVES_OFFSET - CACHE_KEY_OFFSET) {
+        return;
+    }
+
+    canonicalize(bottles, n, canonical.data(), perm.data());
+
+    for (size_t i = 0; i < n; ++i) {
+        inverse[perm[i]] = i;
+    }
+    hash = canonicalHash(canonical.data(), n);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (!m_file.isOpen()) {
+        return;
+    }
+
+    if ((s = find(canonical.data(), n, hash)) != nullptr)
+    {
+        // Keep the cached solution unless the new one is better.
+        if ((s[13] & 1) || (!optimal && moves.size() >= s[14])) {
+            return;
+        }
+    }
+    else
+    {
+        // Empty slot of the bucket, otherwise its least recently used one.
+        oldest = UINT32_MAX;
+
+        for (size_t way = 0; way < CACHE_WAYS; ++way)
+        {
+            candidate = slot(hash % m_buckets, way);
+
+            memcpy(&h, candidate, sizeof(h));
+            memcpy(&stamp, candidate + 8, sizeof(stamp));
+
+            if (h == 0)
+            {
+                s = candidate;
+                break;
+            }
+            if (stamp < oldest)
+            {
+                oldest = stamp;
+                s = candidate;
+            }
+        }
+    }
+
+    memset(s, 0, CACHE_SLOT_BYTES);
+
+    stamp = tick();
+
+    memcpy(s, &hash, sizeof(hash));
+    memcpy(s + 8, &stamp, sizeof(stamp));
+    s[12] = static_cast<uint8_t>(n);
+    s[13] = optimal ? 1 : 0;
+    s[14] = static_cast<uint8_t>(moves.size());
+    memcpy(s + CACHE_KEY_OFFSET, canonical.data(), n * BOTTLE_SIZE);
+
+    for (size_t i = 0; i < moves.size(); ++i)
+    {
+        s[CACHE_MOVES_OFFSET + 2 * i] = static_cast<uint8_t>(inverse[moves[i].first - 1]);
+        s[CACHE_MOVES_OFFSET + 2 * i + 1] = static_cast<uint8_t>(inverse[moves[i].second - 1]);
+    }
+}
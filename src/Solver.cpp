@@ -0,0 +1,229 @@
+#include "Solver.h"
+#include "dispatch.h"
+
+#include <mutex>
+#include <thread>
+#include <cstring>
+#include <algorithm>
+#include <condition_variable>
+
+
+static constexpr int PORTFOLIO_POLL_MS = 10;        // Interval at which a race checks the caller's cancel flag.
+
+static const char* const ENGINE_NAMES[] = { "bfs", "anytime", "approx", "compact", "dense", "pipelined", "portfolio" };
+
+// Races the portfolio's engines (see: solvePuzzle()).
+static bool solvePortfolio(const Bottle* bottles, size_t n, const SolverOptions& options, SolveResult& result)
+{
+    const PortfolioOptions& portfolio = options.portfolio;
+    const size_t none = static_cast<size_t>(-1);
+
+    std::vector<Engine> engines;
+    std::vector<SolveResult> results;
+    std::vector<std::thread> racers;
+
+    std::atomic<bool> cancel(false);
+
+    std::mutex mutex;
+    std::condition_variable finished;
+
+    size_t done = 0;
+    size_t winner = none;
+
+    auto t0 = std::chrono::steady_clock::now();
+
+    auto qualifies = [&portfolio](const SolveResult& r) { return r.solved && (r.optimal || !portfolio.optimal); };
+
+    for (Engine e : portfolio.engines) {
+        if (e != Engine::PORTFOLIO && std::find(engines.begin(), engines.end(), e) == engines.end()) {
+            engines.push_back(e);
+        }
+    }
+    if (engines.empty()) {
+        engines.push_back(Engine::BFS);
+    }
+    results.resize(engines.size());
+    result.race.resize(engines.size());
+
+    for (size_t i = 0; i < engines.size(); ++i)
+    {
+        racers.emplace_back([&, i]()
+        {
+            SolverOptions racer = options;
+
+            racer.engine = engines[i];
+            racer.cache = nullptr;
+            racer.cancel = &cancel;
+
+            dispatchBottles<SolveTask>(n, 0, bottles, racer, results[i]);
+
+            std::lock_guard<std::mutex> lock(mutex);
+
+            result.race[i].cancelled = cancel.load() && !results[i].solved;
+
+            if (winner == none && qualifies(results[i]))
+            {
+                winner = i;
+                cancel = true;
+            }
+            done += 1;
+            finished.notify_one();
+        });
+    }
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        const auto deadline = (portfolio.deadlineMs > 0 ? t0 + std::chrono::milliseconds(portfolio.deadlineMs)
+            : std::chrono::steady_clock::time_point::max());
+
+        // The caller's flag (e.g. a server's deadline) ends the race too; nothing notifies it, so it is polled.
+        auto over = [&]() { return winner != none || done == engines.size() || cancelled(options.cancel); };
+
+        if (options.cancel == nullptr && portfolio.deadlineMs == 0) {
+            finished.wait(lock, over);
+        }
+        else if (options.cancel == nullptr) {
+            finished.wait_until(lock, deadline, over);
+        }
+        else
+        {
+            while (!over() && std::chrono::steady_clock::now() < deadline) {
+                finished.wait_until(lock, std::min(deadline, std::chrono::steady_clock::now() + std::chrono::milliseconds(PORTFOLIO_POLL_MS)), over);
+            }
+        }
+        cancel = true;
+    }
+    for (std::thread& t : racers) {
+        t.join();
+    }
+
+    // No engine qualified in time: the best solution found, optimal ones first, then the shortest.
+    if (winner == none)
+    {
+        for (size_t i = 0; i < engines.size(); ++i)
+        {
+            if (results[i].solved && (winner == none || (results[i].optimal && !results[winner].optimal)
+                || (results[i].optimal == results[winner].optimal && results[i].depth < results[winner].depth)))
+            {
+                winner = i;
+            }
+        }
+    }
+    for (size_t i = 0; i < engines.size(); ++i)
+    {
+        result.race[i].engine = engines[i];
+        result.race[i].solved = results[i].solved;
+        result.race[i].optimal = results[i].solved && results[i].optimal;
+        result.race[i].depth = results[i].depth;
+        result.race[i].elapsedMs = results[i].elapsedMs;
+    }
+    if (winner != none)
+    {
+        std::vector<RaceEntry> race = std::move(result.race);
+
+        result = std::move(results[winner]);
+        result.race = std::move(race);
+    }
+    else result.engine = Engine::PORTFOLIO;
+
+    result.elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+    return result.solved;
+}
+
+
+bool solvePuzzle(const Bottle* bottles, size_t n, const SolverOptions& options, SolveResult& result)
+{
+    auto t0 = std::chrono::steady_clock::now();
+
+    std::vector<Bottle> relabeled;
+
+    result = SolveResult();
+
+    if (n < MIN_BOTTLES || n > MAX_BOTTLES)
+    {
+        result.error = "unsupported bottle count " + std::to_string(n) + ", must be within ["
+            + std::to_string(MIN_BOTTLES) + ", " + std::to_string(MAX_BOTTLES) + "]";
+        return false;
+    }
+
+    // Moves need no mapping back, as the bottles keep their positions.
+    if (options.relabelColors)
+    {
+        relabeled.resize(n);
+        relabelColors(bottles, n, relabeled.data());
+        bottles = relabeled.data();
+    }
+
+    if (options.cache != nullptr
+        && options.cache->lookup(bottles, n, requiresOptimal(options), result.moves, result.optimal)
+        && verifyMoves(bottles, n, result.moves))
+    {
+        result.solved = true;
+        result.cached = true;
+        result.depth = static_cast<int>(result.moves.size());
+        result.elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+        return true;
+    }
+    result.moves.clear();
+
+    if (options.engine == Engine::PORTFOLIO ? !solvePortfolio(bottles, n, options, result)
+        : dispatchBottles<SolveTask>(n, 0, bottles, options, result) == 0)
+    {
+        return false;
+    }
+    if (options.cache != nullptr) {
+        options.cache->store(bottles, n, result.moves, result.optimal);
+    }
+    return true;
+}
+
+bool isExactEngine(Engine engine)
+{
+    return engine == Engine::BFS || engine == Engine::COMPACT || engine == Engine::DENSE || engine == Engine::PIPELINED;
+}
+
+bool requiresOptimal(const SolverOptions& options)
+{
+    return (options.engine == Engine::PORTFOLIO ? options.portfolio.optimal : isExactEngine(options.engine));
+}
+
+const char* engineName(Engine engine)
+{
+    return ENGINE_NAMES[static_cast<size_t>(engine)];
+}
+
+bool parseEngine(const char* name, Engine& engine)
+{
+    for (size_t i = 0; i < sizeof(ENGINE_NAMES) / sizeof(ENGINE_NAMES[0]); ++i)
+    {
+        if (!strcmp(name, ENGINE_NAMES[i]))
+        {
+            engine = static_cast<Engine>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool verifyMoves(const Bottle* bottles, size_t n, const std::vector<std::pair<int, int>>& moves)
+{
+    std::vector<Bottle> state(bottles, bottles + n);
+
+    for (const auto& m : moves)
+    {
+        if (m.first < 1 || m.second < 1 || m.first > static_cast<int>(n) || m.second > static_cast<int>(n)
+            || m.first == m.second || !state[m.first - 1].shouldPourTo(state[m.second - 1]))
+        {
+            return false;
+        }
+        state[m.first - 1].pour(state[m.second - 1]);
+    }
+    for (const Bottle& b : state) {
+        if (!b.isComplete()) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,579 @@
+#include "SolverServer.h"
+
+#include <csignal>
+
+
+#if defined(_WIN32)
+
+bool runServer(const ServerOptions&, std::ostream&, std::string& error)
+{
+    error = "Unix domain sockets are not supported on this platform";
+    return false;
+}
+
+void stopServer() {}
+
+#else
+
+#include <list>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <iomanip>
+#include <sstream>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <condition_variable>
+
+#include <poll.h>
+#include <unistd.h>
+#include <sys/un.h>
+#include <sys/socket.h>
+
+#include "Puzzle.h"
+#include "dispatch.h"
+#include "BatchSolver.h"
+
+
+typedef std::chrono::steady_clock server_clock;
+
+static std::atomic<bool> s_stop(false);      // Lock-free, so safe to set from signal handlers.
+
+static constexpr int POLL_MS = 200;                 // Interval at which blocked threads check for a stop request.
+static constexpr size_t MAX_REQUEST_BYTES = 4096;   // Longest request line accepted.
+
+static void onSignal(int)
+{
+    s_stop = true;
+}
+
+// Client connection, closed once its reader and every reply still pending are done with it.
+class Connection
+{
+private:
+    int m_fd;
+
+    std::mutex m_writeMutex;
+
+public:
+    explicit Connection(int fd) : m_fd(fd) {}
+
+    ~Connection() { close(m_fd); }
+
+    int fd() const { return m_fd; }
+
+    // Writes a line whole, even if replies of several workers are ready at once.
+    void reply(const std::string& line)
+    {
+        const std::string data = line + '\n';
+
+        size_t sent = 0;
+        ssize_t n;
+
+        std::lock_guard<std::mutex> lock(m_writeMutex);
+
+        while (sent < data.size())
+        {
+            if ((n = write(m_fd, data.data() + sent, data.size() - sent)) < 0)
+            {
+                if (errno == EINTR) continue;
+
+                return;     // The client is gone, its reply with it.
+            }
+            sent += static_cast<size_t>(n);
+        }
+    }
+};
+
+struct Request
+{
+    std::shared_ptr<Connection> connection;
+    uint64_t id;
+    std::vector<Bottle> bottles;
+    server_clock::time_point arrival;
+    server_clock::time_point deadline;
+    bool hasDeadline;
+};
+
+struct ServerCounters
+{
+    std::atomic<uint64_t> received{ 0 };
+    std::atomic<uint64_t> solved{ 0 };
+    std::atomic<uint64_t> unsolved{ 0 };
+    std::atomic<uint64_t> busy{ 0 };
+    std::atomic<uint64_t> expired{ 0 };
+    std::atomic<uint64_t> invalid{ 0 };
+};
+
+// Bounded FIFO queue between the connections' readers and the workers.
+class RequestQueue
+{
+private:
+    std::deque<Request> m_requests;
+
+    std::mutex m_mutex;
+    std::condition_variable m_ready;
+
+    size_t m_limit;
+    bool m_closed;
+
+public:
+    explicit RequestQueue(size_t limit) : m_limit(limit), m_closed(false) {}
+
+    // False if the queue is full: the request is refused rather than waited for.
+    bool push(Request&& request)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            if (m_requests.size() >= m_limit) {
+                return false;
+            }
+            m_requests.push_back(std::move(request));
+        }
+        m_ready.notify_one();
+
+        return true;
+    }
+
+    // Blocks until a request is available; false once closed and drained.
+    bool pop(Request& request)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        m_ready.wait(lock, [this]() { return !m_requests.empty() || m_closed; });
+
+        if (m_requests.empty()) {
+            return false;
+        }
+        request = std::move(m_requests.front());
+        m_requests.pop_front();
+
+        return true;
+    }
+
+    void close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_closed = true;
+        }
+        m_ready.notify_all();
+    }
+};
+
+// Sets the cancel flag of every request being solved once its deadline passes (see: Cancel.h), on a thread of its own.
+class DeadlineWatcher
+{
+private:
+    std::vector<std::pair<server_clock::time_point, std::atomic<bool>*>> m_watched;
+
+    std::mutex m_mutex;
+    std::condition_variable m_changed;
+
+    bool m_stopped;
+
+    std::thread m_thread;
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        while (!m_stopped)
+        {
+            if (m_watched.empty())
+            {
+                m_changed.wait(lock);
+                continue;
+            }
+            auto earliest = std::min_element(m_watched.begin(), m_watched.end());
+
+            if (server_clock::now() < earliest->first)
+            {
+                m_changed.wait_until(lock, earliest->first);
+                continue;
+            }
+            earliest->second->store(true);
+            m_watched.erase(earliest);
+        }
+    }
+
+public:
+    DeadlineWatcher() : m_stopped(false), m_thread(&DeadlineWatcher::run, this) {}
+
+    ~DeadlineWatcher()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopped = true;
+        }
+        m_changed.notify_one();
+        m_thread.join();
+    }
+
+    void watch(server_clock::time_point deadline, std::atomic<bool>* cancel)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_watched.push_back({ deadline, cancel });
+        }
+        m_changed.notify_one();
+    }
+
+    // Stops watching a flag (whether it was set or not), before it goes out of scope.
+    void unwatch(std::atomic<bool>* cancel)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        m_watched.erase(std::remove_if(m_watched.begin(), m_watched.end(),
+            [cancel](const std::pair<server_clock::time_point, std::atomic<bool>*>& w) { return w.second == cancel; }), m_watched.end());
+    }
+};
+
+// Reasons may quote the client's input, which is escaped (control characters are dropped).
+static std::string errorJson(const std::string& id, const std::string& reason)
+{
+    std::string json = "{\"id\":" + id + ",\"error\":\"";
+
+    for (char c : reason)
+    {
+        if (c == '"' || c == '\\') {
+            json += '\\';
+        }
+        if (static_cast<unsigned char>(c) >= 0x20) {
+            json += c;
+        }
+    }
+    return json + "\"}";
+}
+
+static bool isNumber(const std::string& token)
+{
+    return !token.empty() && token.size() <= 18 && std::all_of(token.begin(), token.end(), [](char c) { return c >= '0' && c <= '9'; });
+}
+
+// Parses and enqueues a request line, or answers it at once if it cannot be served.
+static void handleLine(const std::shared_ptr<Connection>& connection, std::string line, RequestQueue& queue, ServerCounters& counters)
+{
+    std::istringstream iss;
+
+    std::string idToken;
+    std::string deadlineToken;
+    std::string puzzle;
+    std::string error;
+
+    Request request;
+
+    uint64_t deadlineMs;
+
+    if (!line.empty() && line.back() == '\r') {
+        line.pop_back();
+    }
+    if (line.find_first_not_of(" \t") == std::string::npos || line[line.find_first_not_of(" \t")] == '#') {
+        return;
+    }
+    counters.received += 1;
+
+    request.arrival = server_clock::now();
+
+    iss.str(line);
+    iss >> idToken >> deadlineToken;
+    std::getline(iss, puzzle);
+
+    if (!isNumber(idToken) || !isNumber(deadlineToken))
+    {
+        counters.invalid += 1;
+        connection->reply(errorJson(isNumber(idToken) ? idToken : "null", "expected <id> <deadline-ms> <bottles>"));
+        return;
+    }
+    if (!parsePuzzle(puzzle, request.bottles, error))
+    {
+        counters.invalid += 1;
+        connection->reply(errorJson(idToken, error));
+        return;
+    }
+    if (request.bottles.size() < MIN_BOTTLES || request.bottles.size() > MAX_BOTTLES)
+    {
+        counters.invalid += 1;
+        connection->reply(errorJson(idToken, "number of bottles must be within [" + std::to_string(MIN_BOTTLES) + ", " + std::to_string(MAX_BOTTLES) + "]"));
+        return;
+    }
+    request.connection = connection;
+    request.id = std::stoull(idToken);
+
+    deadlineMs = std::stoull(deadlineToken);
+
+    request.hasDeadline = (deadlineMs > 0);
+    request.deadline = request.arrival + std::chrono::milliseconds(deadlineMs);
+
+    if (!queue.push(std::move(request)))
+    {
+        counters.busy += 1;
+        connection->reply(errorJson(idToken, "busy"));
+    }
+}
+
+// Reads the requests of a connection until the client closes it or the server stops.
+static void readRequests(std::shared_ptr<Connection> connection, RequestQueue& queue, ServerCounters& counters)
+{
+    std::string buffer;
+
+    char chunk[4096];
+
+    pollfd p;
+
+    size_t end;
+    ssize_t n;
+    int ready;
+
+    p.fd = connection->fd();
+    p.events = POLLIN;
+
+    while (!s_stop)
+    {
+        if ((ready = poll(&p, 1, POLL_MS)) <= 0)
+        {
+            if (ready == 0 || errno == EINTR) continue;
+            break;
+        }
+        if ((n = read(connection->fd(), chunk, sizeof(chunk))) <= 0)
+        {
+            if (n < 0 && errno == EINTR) continue;
+            break;
+        }
+        buffer.append(chunk, static_cast<size_t>(n));
+
+        while ((end = buffer.find('\n')) != std::string::npos)
+        {
+            handleLine(connection, buffer.substr(0, end), queue, counters);
+            buffer.erase(0, end + 1);
+        }
+        if (buffer.size() > MAX_REQUEST_BYTES)
+        {
+            counters.invalid += 1;
+            connection->reply(errorJson("null", "request too long"));
+            break;
+        }
+    }
+}
+
+// Serves queued requests on the calling thread, with its own pool arena, until the queue is closed and drained.
+static void serveRequests(const ServerOptions& options, RequestQueue& queue, DeadlineWatcher& watcher, ServerCounters& counters)
+{
+    SolverOptions solver;
+    SolveResult result;
+    Request request;
+
+    std::atomic<bool> cancel;
+
+    std::ostringstream extra;
+    std::string record;
+
+    server_clock::time_point start;
+
+    while (queue.pop(request))
+    {
+        start = server_clock::now();
+
+        const double queuedMs = std::chrono::duration<double, std::milli>(start - request.arrival).count();
+
+        if (request.hasDeadline && start >= request.deadline)
+        {
+            counters.expired += 1;
+            request.connection->reply(errorJson(std::to_string(request.id), "deadline exceeded"));
+            request.connection.reset();
+            continue;
+        }
+        solver = options.solver;
+
+        if (request.hasDeadline)
+        {
+            const uint64_t left = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(request.deadline - start).count());
+
+            solver.anytime.deadlineMs = std::max<uint64_t>(1, std::min(solver.anytime.deadlineMs, left));
+            solver.portfolio.deadlineMs = std::max<uint64_t>(1, solver.portfolio.deadlineMs > 0 ? std::min(solver.portfolio.deadlineMs, left) : left);
+
+            // The other engines are cancelled at the deadline.
+            cancel = false;
+            solver.cancel = &cancel;
+            watcher.watch(request.deadline, &cancel);
+        }
+
+        const bool solved = solvePuzzle(request.bottles.data(), request.bottles.size(), solver, result);
+
+        if (request.hasDeadline) {
+            watcher.unwatch(&cancel);
+        }
+        if (!solved && request.hasDeadline && cancel.load())
+        {
+            counters.expired += 1;
+            request.connection->reply(errorJson(std::to_string(request.id), "deadline exceeded"));
+            request.connection.reset();
+            continue;
+        }
+        if (solved) {
+            counters.solved += 1;
+        }
+        else counters.unsolved += 1;
+
+        extra.str("");
+        extra << ",\"queued_ms\":" << std::fixed << std::setprecision(3) << queuedMs;
+
+        if (request.hasDeadline && server_clock::now() > request.deadline) {
+            extra << ",\"late\":true";
+        }
+
+        // Extra fields of the server go before the record's closing brace.
+        record = toJson(request.id, request.bottles.size(), result);
+        record.insert(record.size() - 1, extra.str());
+
+        request.connection->reply(record);
+        request.connection.reset();
+    }
+}
+
+// Binds the socket, replacing a stale socket file but never one a live server still listens on.
+static int listenOn(const std::string& path, std::string& error)
+{
+    sockaddr_un address;
+
+    int fd;
+
+    if (path.empty() || path.size() >= sizeof(address.sun_path))
+    {
+        error = "invalid socket path \"" + path + "\"";
+        return -1;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, path.c_str(), path.size());
+
+    if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+    {
+        error = std::string("could not create a socket: ") + strerror(errno);
+        return -1;
+    }
+    if (connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0)
+    {
+        close(fd);
+        error = "another server is listening on \"" + path + "\"";
+        return -1;
+    }
+    close(fd);
+    unlink(path.c_str());
+
+    if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0
+        || bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0
+        || listen(fd, SOMAXCONN) < 0)
+    {
+        error = "could not listen on \"" + path + "\": " + strerror(errno);
+
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    return fd;
+}
+
+struct Reader
+{
+    std::thread thread;
+    std::shared_ptr<std::atomic<bool>> done;
+};
+
+bool runServer(const ServerOptions& options, std::ostream& log, std::string& error)
+{
+    RequestQueue queue(std::max<size_t>(options.queueLimit, 1));
+    DeadlineWatcher watcher;
+    ServerCounters counters;
+
+    std::vector<std::thread> workers;
+    std::list<Reader> readers;
+
+    const size_t threads = std::max<size_t>(options.threads, 1);
+
+    pollfd p;
+
+    int listener;
+    int client;
+    int ready;
+
+    if ((listener = listenOn(options.socketPath, error)) < 0) {
+        return false;
+    }
+    s_stop = false;
+
+    auto previousInt = std::signal(SIGINT, onSignal);
+    auto previousTerm = std::signal(SIGTERM, onSignal);
+    auto previousPipe = std::signal(SIGPIPE, SIG_IGN);     // Write errors are handled where they occur.
+
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back(serveRequests, std::cref(options), std::ref(queue), std::ref(watcher), std::ref(counters));
+    }
+
+    log << "> Listening on \"" << options.socketPath << "\" with " << threads << " worker(s), queue limit "
+        << std::max<size_t>(options.queueLimit, 1) << std::endl;
+
+    p.fd = listener;
+    p.events = POLLIN;
+
+    while (!s_stop)
+    {
+        if ((ready = poll(&p, 1, POLL_MS)) <= 0 || (client = accept(listener, nullptr, nullptr)) < 0) continue;
+
+        // Readers of closed connections are joined as new ones arrive.
+        readers.remove_if([](Reader& r)
+        {
+            if (!r.done->load()) {
+                return false;
+            }
+            r.thread.join();
+            return true;
+        });
+
+        auto done = std::make_shared<std::atomic<bool>>(false);
+        auto connection = std::make_shared<Connection>(client);
+
+        readers.push_back({ std::thread([connection, done, &queue, &counters]()
+        {
+            readRequests(connection, queue, counters);
+            done->store(true);
+        }), done });
+    }
+
+    close(listener);
+    unlink(options.socketPath.c_str());
+
+    // Requests already queued are still answered.
+    for (Reader& r : readers) {
+        r.thread.join();
+    }
+    queue.close();
+
+    for (std::thread& w : workers) {
+        w.join();
+    }
+
+    std::signal(SIGINT, previousInt);
+    std::signal(SIGTERM, previousTerm);
+    std::signal(SIGPIPE, previousPipe);
+
+    log << "> Served " << counters.received << " requests: " << counters.solved << " solved, "
+        << counters.unsolved << " unsolved, " << counters.busy << " refused (busy), "
+        << counters.expired << " expired, " << counters.invalid << " invalid" << std::endl;
+
+    return true;
+}
+
+void stopServer()
+{
+    s_stop = true;
+}
+
+#endif
@@ -1,18 +1,30 @@
-#include <queue>
 #include <ctime>
 #include <thread>
 #include <chrono>
 #include <fstream>
 #include <iomanip>
 #include <cstdint>
+#include <memory>
+#include <cstring>
+#include <sstream>
 #include <iostream>
-#include <unordered_set>
 
+#include "BFS.h"
 #include "State.h"
+#include "Puzzle.h"
+#include "Corpus.h"
+#include "Solver.h"
+#include "dispatch.h"
+#include "BatchSolver.h"
+#include "SearchStats.h"
+#include "SolverServer.h"
+#include "HintOracle.h"
+#include "Census.h"
+#include "AnytimeSearch.h"
 #include "output_util.h"
 
-// Number of Bottles.
-constexpr static size_t BOTTLES_N = static_cast<size_t>(8);
+// Number of Bottles, unless specified otherwise at the command line.
+constexpr static size_t DEFAULT_BOTTLES_N = static_cast<size_t>(8);
 
 // Record current time.
 inline auto READ_TIME() { 
@@ -26,254 +38,948 @@ constexpr auto MS_DIFF(const timestamp_t& x, const timestamp_t& y) {
     return std::chrono::duration_cast<std::chrono::milliseconds>(y - x).count();
 }
 
-// If true, then object equality is ignored in case of collision.
-constexpr bool ALLOW_UNSAFE_PRUNNING = false;
 
+std::string getSystemTimestamp()
+{
+    constexpr char DAY[][4] = {
+        "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"
+    };
+
+    std::ostringstream oss;
+
+    time_t t = time(nullptr);
+
+    tm now{};
+
+#if defined(_MSC_VER)
+    localtime_s(&now, &t);
+#else
+    localtime_r(&t, &now);
+#endif
+
+    oss << DAY[now.tm_wday] << " " 
+        << now.tm_mday << "/" 
+        << now.tm_mon + 1 << "/" 
+        << now.tm_year + 1900 << "  -  " 
+        << (now.tm_hour != 0 ? now.tm_hour % 12 : 12) << ":" 
+        << std::setw(2) << std::setfill('0') << now.tm_min << (now.tm_hour / 12 ? " PM" : " AM");
+
+    return oss.str();
+}
 
-// Content equality of pointers (auxiliary struct for maps).
-template <typename T>
-struct EqualContents
+// Command line configuration of a run.
+struct Options
 {
-    constexpr bool operator () (const T* a, const T* b) const noexcept
+    size_t bottles = DEFAULT_BOTTLES_N;   // Number of bottles of a random puzzle.
+    std::vector<Bottle> input;            // Initial state read from file (random if empty).
+    SolverOptions solver;
+    std::string batchInput;               // File of puzzles to be solved in batch mode.
+    std::string batchOutput = "results.jsonl";
+    size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    std::string corpusOutput;             // Binary corpus to be generated.
+    uint64_t corpusCount = 1000;
+    unsigned int seed = 0;
+    std::string cachePath;                // Persistent solution cache (disabled if empty).
+    size_t cacheBytes = CACHE_DEFAULT_BYTES;
+    uint64_t progressMs = 1000;           // Interval of the BFS progress lines (disabled if 0).
+    std::string statsOutput;              // JSON summary of the search instrumentation.
+    std::string traceOutput;              // Chrome trace of the search instrumentation.
+    std::string allocationTrace;          // Prefix of the memory pools' binary traces (disabled if empty).
+    std::string databasePath;             // Pattern database of the anytime engine (disabled if empty).
+    std::string endgamePath;              // Endgame database of the BFS, compact and pipelined engines (disabled if empty).
+    std::string serverSocket;             // Unix domain socket of the server mode.
+    std::string hintInput;                // Positions of a game to be given hints for.
+    HintOptions hints;
+    std::string censusInput;              // Start positions whose reachable states are to be enumerated.
+    uint64_t censusMaxStates = 0;         // States after which a census stops (unlimited if 0).
+    size_t queueLimit = 64;               // Requests the server queues before refusing new ones.
+    CheckpointOptions checkpoint;         // Checkpoints of the compact engine (disabled if the directory is empty).
+};
+
+// Writes the instrumentation results to the files requested at the command line.
+bool exportStats(const SearchStats& stats, const Options& options)
+{
+    if (!options.statsOutput.empty())
+    {
+        std::ofstream ofs(options.statsOutput, std::ios::out);
+
+        if (!ofs.is_open()) {
+            return false;
+        }
+        stats.writeJson(ofs);
+    }
+    if (!options.traceOutput.empty())
     {
-        if constexpr (ALLOW_UNSAFE_PRUNNING) {
-            return true;
+        std::ofstream ofs(options.traceOutput, std::ios::out);
+
+        if (!ofs.is_open()) {
+            return false;
         }
-        else return *a == *b;
+        stats.writeChromeTrace(ofs);
     }
-};
+    return true;
+}
 
-// Implementation of Breadth First Search AI algorithm
+// Solves a single puzzle of `size` bottles and exports the results.
 template <size_t size>
-State<size>* BFS(State<size>& initial, uint64_t& examined, uint64_t& memory)
+struct Solve
 {
-    std::queue<State<size>*> frontier;
+    static int run(const Options& options)
+    {
+        uint64_t memory = 0;      // Number of total nodes stored (frontier + closed set).
+        uint64_t examined = 0;    // Number of nodes examined by the BFS algorithm.
+        uint64_t duration;        // Duration of BFS runtime in milliseconds.
 
-    std::unordered_set<State<size>*, std::hash<State<size>*>, EqualContents<State<size>>> closed(size * size * 10000);
+        bool optimal = true;      // Whether the solution is proven optimal.
+        bool cached = false;      // Whether the solution was found in the cache.
 
-    std::vector<State<size>*> children;
+        std::vector<std::pair<int, int>> moves;   // Moves of the solution, as stored in the cache.
 
-    State<size>* s;
+        ApproximateReport approximation;          // Accuracy of the approximate engine.
+        uint64_t compactBytes = 0;                // Peak memory of the compact engine.
+        bool ranked = false;                      // Whether the dense engine could rank the state space.
 
-    auto clearMemory = [&]()
-    {
-        while (!frontier.empty())
+        SearchStats stats(&std::cout, options.progressMs);
+
+        std::unique_ptr<EndgameLookup<size>> endgame;   // Lookup of the endgame database, if it matches the puzzle.
+
+        color_t original[TOTAL_COLORS + 1];       // Original color of every renumbered one (see: relabelColors()).
+
+        // Instrumentation of the BFS engine, requested explicitly or for the progress lines.
+        const bool instrumented = (options.solver.engine == Engine::BFS
+            && (options.progressMs > 0 || !options.statsOutput.empty() || !options.traceOutput.empty()));
+
+        std::ofstream ofs("results.txt", std::ios::out);  // File for exporting metrics and solution's path.
+        std::ostream& out = (ofs.is_open() ? ofs : std::cout);  // Unless opened successfully, logging is continued at the command line.
+
+        std::chrono::time_point<std::chrono::system_clock> t0;  // Object for recording start time of BFS.
+        std::chrono::time_point<std::chrono::system_clock> t1;  // Object for recording stop time of BFS
+
+        State<size>  start;    // Initial state.
+        State<size>* solution; // Goal State
+
+        bool s_finished = false;
+
+
+        // Program descripton.
+        std::cout << getSystemTimestamp() << "\n\n";
+        std::cout << "> Implementation of Water Sort game AI, by Dimitris Yfantidis." << '\n';
+        std::cout << "> Currently Running a game of " << size << " bottles." << '\n';
+        std::cout << "> Total size of each state in memory: " << sizeof(State<size>) << " bytes.\n\n" << std::endl;
+
+
+#if defined(_MSC_VER)
+        std::thread loadingAnimation
+        (
+            [&] () 
+            {
+                size_t q;
+
+                // Progress lines take the place of the animation.
+                if (instrumented && options.progressMs > 0) return;
+
+                std::string gap(13, ' ');
+            
+                std::chrono::milliseconds ms(20);
+
+
+                cmd::removeCursor();
+
+                while (!s_finished) 
+                {
+                    for (q = 0; q < cmd::loading_bar.size() && !s_finished; ++q)
+                    {
+                        std::cout << gap << cmd::loading_bar[q];
+                        std::this_thread::sleep_for(ms);
+                        std::cout << '\r';
+                    }
+                }
+                std::cout << std::string(gap.size() + cmd::loading_bar[0].size(), ' ') << std::endl;
+            }
+        );
+#else
+        std::cout << "Calculating solution ..." << std::endl;
+#endif
+
+
+        if (!options.input.empty()) {
+            start = State<size>(options.input.data());
+        }
+        else {
+            // Initialization of state's bottles with N - 2 random colors (NUM_OF_COLORS mL each), in a random sequence.
+            start.init();
+        }
+
+        if (options.solver.relabelColors) {
+            relabelColors(start.getBottles(), size, start.getBottles(), original);
+        }
+
+        if (options.solver.endgame != nullptr)
         {
-            delete frontier.front();
+            endgame.reset(new EndgameLookup<size>(options.solver.endgame, start.getBottles()));
 
-            frontier.pop();
+            if (!endgame->active())
+            {
+                std::cout << "> The endgame database does not match the puzzle, searching without it." << std::endl;
+                endgame.reset();
+            }
         }
-    };
 
-    frontier.push(new State<size>(initial));
-    examined = 0;
-    memory = 1;
+        t0 = READ_TIME();
 
-    while (!frontier.empty())
-    {
-        if (frontier.size() + closed.size() > memory) {
-            memory = frontier.size() + closed.size();
+        if (options.solver.cache != nullptr
+            && options.solver.cache->lookup(start.getBottles(), size, requiresOptimal(options.solver), moves, optimal)
+            && verifyMoves(start.getBottles(), size, moves))
+        {
+            // Replay of the cached solution.
+            cached = true;
+            solution = new State<size>(start);
+
+            for (const auto& m : moves) {
+                solution = solution->move(m.first - 1, m.second - 1);
+            }
         }
+        else if (options.solver.engine == Engine::ANYTIME)
+        {
+            if (options.solver.anytime.database != nullptr && !PatternHeuristic<size>(options.solver.anytime.database, start.getBottles()).active()) {
+                std::cout << "> The pattern database does not match the puzzle, using the default heuristic only." << std::endl;
+            }
+            solution = anytimeBeamSearch<size>(start, options.solver.anytime, examined, memory, optimal,
+                [] (const State<size>*, int depth, size_t width, uint64_t elapsed)
+                {
+                    std::cout << "> [" << std::setw(6) << std::setfill(' ') << elapsed << " ms] "
+                        << "Solution of depth " << depth << " (beam width " << width << ")" << std::endl;
+                }
+            );
+        }
+        else if (options.solver.engine == Engine::COMPACT)
+        {
+            CheckpointReport checkpoints;
 
-        s = frontier.front();
+            solution = compactBFS<size>(start, examined, memory, compactBytes, endgame.get(),
+                options.checkpoint.directory.empty() ? nullptr : &options.checkpoint, &checkpoints);
 
-        frontier.pop();
+            if (checkpoints.resumedDepth >= 0) {
+                std::cout << "> Resumed from the checkpoint of depth " << checkpoints.resumedDepth << std::endl;
+            }
+            if (checkpoints.written > 0) {
+                std::cout << "> Checkpoints written: " << checkpoints.written << " (last at depth " << checkpoints.lastDepth << ")" << std::endl;
+            }
+            if (!checkpoints.error.empty()) {
+                std::cout << "> Checkpoint error: " << checkpoints.error << std::endl;
+            }
 
-        if (closed.find(s) == closed.end())
+            std::cout << "> Peak memory of the compressed states: " << compactBytes << " bytes ("
+                << std::fixed << std::setprecision(2) << static_cast<double>(compactBytes) / std::max<uint64_t>(memory, 1)
+                << " bytes per state)" << std::endl;
+        }
+        else if (options.solver.engine == Engine::PORTFOLIO)
         {
-            examined += 1;
+            SolverOptions race = options.solver;
+            SolveResult raced;
+
+            race.cache = nullptr;
+
+            solution = nullptr;
 
-            // Goal state reached.
-            if (s->isVictorious())
+            if (solvePuzzle(start.getBottles(), size, race, raced))
             {
-                State<size>* result = s->copyWholePath();
+                solution = new State<size>(start);
+
+                for (const auto& m : raced.moves) {
+                    solution = solution->move(m.first - 1, m.second - 1);
+                }
+            }
+            examined = raced.examined;
+            memory = raced.memory;
+            optimal = raced.optimal;
 
-                delete s;
+            for (const RaceEntry& r : raced.race)
+            {
+                std::cout << "> " << std::left << std::setw(10) << engineName(r.engine) << std::right
+                    << (r.solved ? "depth " + std::to_string(r.depth) + (r.optimal ? " (optimal)" : "") : r.cancelled ? "cancelled" : "unsolved")
+                    << " after " << std::fixed << std::setprecision(1) << r.elapsedMs << " ms" << std::endl;
+            }
+            if (raced.solved) {
+                std::cout << "> Portfolio winner: " << engineName(raced.engine) << std::endl;
+            }
+            else std::cout << "> No engine of the portfolio found a solution." << std::endl;
+        }
+        else if (options.solver.engine == Engine::PIPELINED)
+        {
+            PipelineReport pipeline;
+
+            solution = pipelinedBFS<size>(start, options.solver.pipeline, examined, memory, compactBytes, pipeline, endgame.get());
+
+            std::cout << "> Pipeline: " << pipeline.expanders << " expanders, " << pipeline.partitions << " partitions, "
+                << pipeline.batches << " batches, " << pipeline.stalls << " stalls on a full queue" << std::endl;
+            std::cout << std::fixed << std::setprecision(1)
+                << "> Expanders: " << 100 * pipeline.expandUtilization() << "% busy ("
+                << pipeline.expandBusyMs << " ms working, " << pipeline.expandStalledMs << " ms stalled)" << std::endl
+                << "> Dedupers: " << 100 * pipeline.dedupeUtilization() << "% busy ("
+                << pipeline.dedupeBusyMs << " ms working, " << pipeline.dedupeIdleMs << " ms idle)" << std::endl;
+            std::cout << "> Peak memory of the tables, layers and queues: " << compactBytes << " bytes" << std::endl;
+        }
+        else if (options.solver.engine == Engine::DENSE)
+        {
+            solution = denseBFS<size>(start, examined, memory, compactBytes, ranked);
 
-                clearMemory();
+            if (ranked)
+            {
+                std::cout << "> States ranked: " << StateRanker<size>(start.getBottles()).states()
+                    << ", depth table and frontier: " << compactBytes << " bytes" << std::endl;
+            }
+            else std::cout << "> The state space is too large to rank, solved with BFS." << std::endl;
+        }
+        else if (options.solver.engine == Engine::APPROXIMATE)
+        {
+            solution = approximateBFS<size>(start, options.solver.approximate, examined, memory, approximation);
+            optimal = approximation.exactFallback;
 
-                return result;
+            if (approximation.exactFallback) {
+                std::cout << "> Every solution was cut by false positives, solved again with exact BFS." << std::endl;
             }
-            closed.insert(s);
+        }
+        else if (instrumented)
+        {
+            stats.start("bfs", size);
+
+            solution = BFS(start, examined, memory, &stats, endgame.get(), options.solver.relabelColors);
+
+            stats.finish(solution != nullptr, solution != nullptr ? solution->getDepth() : 0);
+        }
+        else solution = BFS(start, examined, memory, nullptr, endgame.get(), options.solver.relabelColors);
+
+        t1 = READ_TIME();
+
+        if (instrumented && !cached && !exportStats(stats, options)) {
+            std::cerr << "Could not write the search statistics." << std::endl;
+        }
 
-            s->expand(children);
+        if (!cached && solution != nullptr && options.solver.cache != nullptr)
+        {
+            solution->getMoves(moves);
+            options.solver.cache->store(start.getBottles(), size, moves, optimal);
+        }
+
+        duration = MS_DIFF(t0, t1);
 
-            for (State<size>* child : children)
+
+        if (solution != nullptr)
+        {
+            out << "METRICS FOR " << size << " BOTTLES:\n"
+                << "-> Depth:          \t" << solution->getDepth() << '\n'
+                << "-> Total Nodes:    \t" << memory << '\n'
+                << "-> Examined Nodes: \t" << examined << '\n'
+                << "-> Elapsed Time:   \t" << clockFormat(duration) << '\n'
+                << "-> Proven Optimal: \t" << (optimal ? "Yes" : "No") << '\n'
+                << "-> From Cache:     \t" << (cached ? "Yes" : "No") << '\n';
+
+            if (options.solver.engine == Engine::APPROXIMATE && !cached && !optimal)
             {
-                if (closed.find(child) == closed.end())
-                    frontier.push(child);
-                else
-                    delete child;
+                out << "-> Filter Size:    \t" << approximation.filterBytes << " bytes (false positive rate "
+                    << approximation.falsePositiveRate << ")\n"
+                    << "-> Miss Probability:\t" << approximation.missProbability << '\n';
             }
+            out << "\n" << std::endl;
         }
         else
         {
-            delete s;
+            /*  The given problem is not actually unsolvable. If BFS() returns null, then that means
+             *  there were collisions of hash values, such that paths to all victorious nodes were blocked.
+             *  This scenario is very unlikely, but possible.
+             */
+            out << "Problem unsolvable" << std::endl;
+        }
+
+        // Path between start node and goal node.
+        std::vector<State<size>*> path;
+
+        for (State<size>* s = solution; s != nullptr; s = s->getPrevious())
+        {
+            // The moves hold for the original colors, as relabeling keeps the bottles in place.
+            if (options.solver.relabelColors) {
+                restoreColors(s->getBottles(), size, original);
+            }
+            path.push_back(s);
         }
+
+        // Logging of solution (visually + transitions) from start to finish.
+        for (int i = (int)path.size() - 1; i >= 0; --i) {
+            out << path[i]->toString() << "\n\n"
+                << std::setw(2) << std::setfill(' ') << path.size() - i 
+                << ". " << path[i]->getActionName() << "\n\n" << std::endl;
+        }
+
+        if (ofs.is_open()) 
+        {
+            std::cout << "\n\nSolution generated at \"results.txt\" within the current working directory" << std::endl;
+            ofs.close();
+        }
+
+        s_finished = true;
+
+#if defined(_MSC_VER)
+        loadingAnimation.join();
+#endif
+
+        return EXIT_SUCCESS;
     }
-    clearMemory();
+};
+
+// Batch mode: every puzzle of the input file (text or binary corpus) is solved by the worker pool.
+int runBatchMode(const Options& options)
+{
+    std::vector<std::vector<Bottle>> puzzles;
+    std::string error;
+
+    CorpusReader corpus;
+    PuzzleSource source;
+
+    uint64_t count;
+
+    if (CorpusReader::isCorpus(options.batchInput))
+    {
+        if (!corpus.open(options.batchInput, error))
+        {
+            std::cerr << "Could not read corpus: " << error << std::endl;
+            return EXIT_FAILURE;
+        }
+        if (corpus.bottles() < MIN_BOTTLES || corpus.bottles() > MAX_BOTTLES)
+        {
+            std::cerr << "Corpus puzzles have " << corpus.bottles() << " bottles, must be within ["
+                << MIN_BOTTLES << ", " << MAX_BOTTLES << "]." << std::endl;
+            return EXIT_FAILURE;
+        }
+        count = corpus.size();
+        source = [&corpus] (uint64_t i, size_t& n)
+        {
+            n = corpus.bottles();
+            return corpus.bottlesAt(i);
+        };
+    }
+    else
+    {
+        std::ifstream ifs(options.batchInput);
+
+        if (!ifs.is_open() || !readPuzzles(ifs, puzzles, error))
+        {
+            std::cerr << "Could not read puzzles from \"" << options.batchInput << "\""
+                << (error.empty() ? "" : ": " + error) << std::endl;
+            return EXIT_FAILURE;
+        }
+        for (size_t i = 0; i < puzzles.size(); ++i)
+        {
+            if (puzzles[i].size() < MIN_BOTTLES || puzzles[i].size() > MAX_BOTTLES)
+            {
+                std::cerr << "Puzzle " << i << " has " << puzzles[i].size() << " bottles, must be within ["
+                    << MIN_BOTTLES << ", " << MAX_BOTTLES << "]." << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+        count = puzzles.size();
+        source = [&puzzles] (uint64_t i, size_t& n)
+        {
+            n = puzzles[i].size();
+            return puzzles[i].data();
+        };
+    }
+
+    std::ofstream ofs(options.batchOutput, std::ios::out);
+
+    if (!ofs.is_open())
+    {
+        std::cerr << "Could not open \"" << options.batchOutput << "\" for writing." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    BatchOptions batch;
 
-    return nullptr;
+    batch.threads = options.threads;
+    batch.solver = options.solver;
+
+    std::cout << "> Solving " << count << " puzzles from \"" << options.batchInput << "\" ..." << std::endl;
+
+    runBatch(count, source, batch, ofs, std::cout);
+
+    std::cout << "> Records generated at \"" << options.batchOutput << "\"" << std::endl;
+
+    return EXIT_SUCCESS;
 }
 
-/*
-State<14> startValue()
+// Server mode: requests from a Unix domain socket are solved by the worker pool until interrupted.
+int runServerMode(const Options& options)
 {
-    return 
-    { 
-        {BLUE, GREEN, CYAN, CYAN}, 
-        {PURPLE, PINK, EMERALD, GREY}, 
-        {ORANGE, PURPLE, RED, BROWN}, 
-        {ORANGE, PINK, RED, ORANGE},
-        {GREEN, RED, YELLOW, BLUE},
-        {YELLOW, GREEN, BROWN, GREEN}, 
-        {BROWN, PURPLE, RED, LIME}, 
-        {LIME, PURPLE, PINK, LIME}, 
-        {EMERALD, GREY, CYAN, BLUE},
-        {BROWN, YELLOW, GREY, EMERALD},
-        {GREY, YELLOW, LIME, BLUE},
-        {EMERALD, CYAN, PINK, ORANGE}, 
-        {NO_COLOR, NO_COLOR, NO_COLOR, NO_COLOR}, 
-        {NO_COLOR, NO_COLOR, NO_COLOR, NO_COLOR}
-    };
+    ServerOptions server;
+    std::string error;
+
+    server.socketPath = options.serverSocket;
+    server.threads = options.threads;
+    server.queueLimit = options.queueLimit;
+    server.solver = options.solver;
+
+    if (!runServer(server, std::cout, error))
+    {
+        std::cerr << "Could not start the server: " << error << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
 }
-*/
 
-std::string getSystemTimestamp()
+// Hint mode: the best move from every position of the input file, in order, by one oracle per number of bottles.
+int runHintMode(const Options& options)
 {
-    constexpr char DAY[][4] = {
-        "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"
-    };
+    std::vector<std::vector<Bottle>> positions;
+    std::unique_ptr<Hinter> hinter;
+    std::string error;
 
-    std::ostringstream oss;
+    HintResult hint;
 
-    time_t t = time(nullptr);
+    size_t bottles = 0;
 
-    tm now{};
+    std::ifstream ifs(options.hintInput);
 
-    localtime_s(&now, &t);
+    if (!ifs.is_open() || !readPuzzles(ifs, positions, error))
+    {
+        std::cerr << "Could not read positions from \"" << options.hintInput << "\""
+            << (error.empty() ? "" : ": " + error) << std::endl;
+        return EXIT_FAILURE;
+    }
+    for (size_t i = 0; i < positions.size(); ++i)
+    {
+        if (positions[i].size() != bottles)
+        {
+            bottles = positions[i].size();
+            hinter = makeHinter(bottles, options.hints);
+        }
+        if (hinter == nullptr)
+        {
+            std::cerr << "Position " << i << " has " << bottles << " bottles, must be within ["
+                << MIN_BOTTLES << ", " << MAX_BOTTLES << "]." << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::cout << "> Position " << i << ": ";
 
-    oss << DAY[now.tm_wday] << " " 
-        << now.tm_mday << "/" 
-        << now.tm_mon + 1 << "/" 
-        << now.tm_year + 1900 << "  -  " 
-        << (now.tm_hour != 0 ? now.tm_hour % 12 : 12) << ":" 
-        << std::setw(2) << std::setfill('0') << now.tm_min << (now.tm_hour / 12 ? " PM" : " AM");
+        if (!hinter->hint(positions[i].data(), hint)) {
+            std::cout << "no solution found";
+        }
+        else if (hint.distance == 0) {
+            std::cout << "solved";
+        }
+        else std::cout << "pour " << hint.from + 1 << " -> " << hint.to + 1 << ", " << hint.distance << " moves left";
 
-    return oss.str();
+        std::cout << " (" << (hint.searched ? "searched " + std::to_string(hint.expanded) + " states" : std::string("known"))
+            << ", " << std::fixed << std::setprecision(1) << hint.elapsedUs << " us)" << std::endl;
+    }
+    if (hinter != nullptr) {
+        std::cout << "> States with a known distance: " << hinter->known() << std::endl;
+    }
+    return EXIT_SUCCESS;
 }
 
-int main()
+// Census mode: every state reachable from each puzzle of the input file, one JSON record per puzzle.
+int runCensusMode(const Options& options)
 {
-    uint64_t memory = 0;      // Number of total nodes stored (frontier + closed set).
-    uint64_t examined = 0;    // Number of nodes examined by the BFS algorithm.
-    uint64_t duration;        // Duration of BFS runtime in milliseconds.
+    std::vector<std::vector<Bottle>> puzzles;
+    std::string error;
 
-    std::ofstream ofs("results.txt", std::ios::out);  // File for exporting metrics and solution's path.
-    std::ostream& out = (ofs.is_open() ? ofs : std::cout);  // Unless opened successfully, logging is continued at the command line.
+    CensusOptions census;
+    CensusReport report;
 
-    std::chrono::time_point<std::chrono::system_clock> t0;  // Object for recording start time of BFS.
-    std::chrono::time_point<std::chrono::system_clock> t1;  // Object for recording stop time of BFS
+    std::ifstream ifs(options.censusInput);
 
-    State<BOTTLES_N>  start;    // Initial state.
-    State<BOTTLES_N>* solution; // Goal State
+    if (!ifs.is_open() || !readPuzzles(ifs, puzzles, error))
+    {
+        std::cerr << "Could not read puzzles from \"" << options.censusInput << "\""
+            << (error.empty() ? "" : ": " + error) << std::endl;
+        return EXIT_FAILURE;
+    }
+    for (size_t i = 0; i < puzzles.size(); ++i)
+    {
+        if (puzzles[i].size() < MIN_BOTTLES || puzzles[i].size() > MAX_BOTTLES)
+        {
+            std::cerr << "Puzzle " << i << " has " << puzzles[i].size() << " bottles, must be within ["
+                << MIN_BOTTLES << ", " << MAX_BOTTLES << "]." << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::ofstream ofs(options.batchOutput, std::ios::out);
 
-    bool s_finished = false;
+    if (!ofs.is_open())
+    {
+        std::cerr << "Could not open \"" << options.batchOutput << "\" for writing." << std::endl;
+        return EXIT_FAILURE;
+    }
+    census.threads = options.threads;
+    census.maxStates = options.censusMaxStates;
 
+    for (size_t i = 0; i < puzzles.size(); ++i)
+    {
+        takeCensus(puzzles[i].data(), puzzles[i].size(), census, report);
 
-    // Program descripton.
-    std::cout << getSystemTimestamp() << "\n\n";
-    std::cout << "> Implementation of Water Sort game AI, by Dimitris Yfantidis." << '\n';
-    std::cout << "> Currently Running a game of " << BOTTLES_N << " bottles." << '\n';
-    std::cout << "> Total size of each state in memory: " << sizeof(State<BOTTLES_N>) << " bytes.\n\n" << std::endl;
+        ofs << censusJson(i, report) << std::endl;
 
+        std::cout << "> Puzzle " << i << ": " << report.states << " states";
 
-#if defined(_MSC_VER)
-    std::thread loadingAnimation
-    (
-        [&] () 
+        if (!report.complete) {
+            std::cout << " enumerated before stopping (" << report.depth << " layers)";
+        }
+        else
         {
-            size_t q;
+            std::cout << ", " << report.goals << " goals, " << report.deadEnds << " dead ends, "
+                << report.states - report.solvable << " unsolvable; depth " << report.depth
+                << ", optimal solution " << report.startDistance << ", eccentricity " << report.eccentricity;
+        }
+        std::cout << " (" << std::fixed << std::setprecision(1) << report.elapsedMs << " ms, "
+            << report.peakBytes / (1024 * 1024) << " MB)" << std::endl;
+    }
+    std::cout << "> Records generated at \"" << options.batchOutput << "\"" << std::endl;
 
-            std::string gap(13, ' ');
-            
-            std::chrono::milliseconds ms(20);
+    return EXIT_SUCCESS;
+}
+
+// Writes `count` random puzzles of `size` bottles, reproducible from the seed, to a binary corpus.
+template <size_t size>
+struct GenerateCorpus
+{
+    static int run(const Options& options)
+    {
+        CorpusWriter writer;
+        State<size> s;
+
+        std::mt19937 generator(options.seed);
+
+        if (!writer.open(options.corpusOutput, size))
+        {
+            std::cerr << "Could not open \"" << options.corpusOutput << "\" for writing." << std::endl;
+            return EXIT_FAILURE;
+        }
+        for (uint64_t i = 0; i < options.corpusCount; ++i)
+        {
+            s.init(generator);
+            writer.write(s.getBottles());
+        }
+        if (!writer.close())
+        {
+            std::cerr << "Could not write \"" << options.corpusOutput << "\"." << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::cout << "> Generated " << options.corpusCount << " puzzles of " << size
+            << " bottles (seed " << options.seed << ") at \"" << options.corpusOutput << "\"" << std::endl;
+
+        return EXIT_SUCCESS;
+    }
+};
+
+void printUsage(const char* program)
+{
+    std::cerr << "Usage: " << program << " [--bottles N | --input FILE] [--engine ENGINE] [--beam-width W] [--deadline MS] [--pdb FILE] [--endgame FILE]\n"
+        << "       " << std::string(strlen(program), ' ') << " [--relabel-colors] [--cache FILE [--cache-size MB]]\n"
+        << "       " << std::string(strlen(program), ' ') << " [--checkpoint DIR [--checkpoint-interval MS] [--resume]] [--expanders E] [--partitions P]\n"
+        << "       " << std::string(strlen(program), ' ') << " [--portfolio E1,E2,... [--accept-any] [--portfolio-deadline MS]]\n"
+        << "       " << std::string(strlen(program), ' ') << " [--progress MS] [--stats FILE] [--trace FILE] [--trace-alloc PREFIX]\n"
+        << "       " << program << " --generate FILE [--count C] [--bottles N] [--seed S]\n"
+        << "       " << program << " --batch FILE [--threads K] [--output FILE] [--engine ENGINE] [--beam-width W] [--deadline MS] [--pdb FILE] [--endgame FILE] [--relabel-colors] [--cache FILE]\n"
+        << "       " << program << " --serve SOCKET [--threads K] [--queue Q] [--engine ...] [--pdb FILE] [--endgame FILE] [--cache FILE]\n"
+        << "       " << program << " --hints FILE [--hint-radius R] [--hint-max-states S]\n"
+        << "       " << program << " --census FILE [--threads K] [--output FILE] [--census-max-states S]\n\n"
+        << "  --bottles      Number of bottles of a random puzzle, " << MIN_BOTTLES << " to " << MAX_BOTTLES << " (default " << DEFAULT_BOTTLES_N << ")\n"
+        << "  --input        Solve the first puzzle of a text file or binary corpus instead (see Puzzle.h, Corpus.h)\n"
+        << "  --batch        Solve every puzzle of a text file or binary corpus concurrently, writing JSON Lines records\n"
+        << "  --serve        Solve requests received on a Unix domain socket until interrupted (see SolverServer.h)\n"
+        << "  --hints        Best move from every position of a game (one per line, in order), reusing earlier searches\n"
+        << "  --hint-radius  Moves off a solution path whose positions are solved in advance (default 1)\n"
+        << "  --hint-max-states  States a hint's search may expand before giving up (default 10000000)\n"
+        << "  --census       Enumerate every state reachable from each puzzle of a text file, writing JSON Lines records of\n"
+        << "                 counts per depth and per distance to the goal, branching factors and dead ends\n"
+        << "  --census-max-states  States after which a census stops (default: unlimited)\n"
+        << "  --threads      Number of worker threads of the batch, server and census modes (default: number of cores)\n"
+        << "  --queue        Requests waiting in the server's queue, beyond which new ones are refused (default 64)\n"
+        << "  --output       Output file of the batch and census modes (default results.jsonl)\n"
+        << "  --cache        Reuse and record solutions in a persistent cache file\n"
+        << "  --cache-size   Size limit of a new cache file in MB (default " << CACHE_DEFAULT_BYTES / (1024 * 1024) << ")\n"
+        << "  --generate     Write --count random puzzles of --bottles bottles, seeded by --seed, to a binary corpus\n"
+        << "  --engine       bfs (optimal, default), anytime (beam search, non-optimal), approx (BFS with a Bloom filter)\n"
+        << "                 compact (optimal, layered BFS over compressed keys), dense (optimal, BFS over ranked\n"
+        << "                 states with a byte per possible state, for puzzles of up to 5 bottles), pipelined\n"
+        << "                 (optimal, layered BFS with expansion and deduplication threads) or portfolio (races the\n"
+        << "                 --portfolio engines on a thread each and keeps the first acceptable solution)\n"
+        << "  --beam-width   Initial beam width of the anytime engine (default 100)\n"
+        << "  --deadline     Time budget of the anytime engine in milliseconds (default 1000)\n"
+        << "  --pdb          Pattern database bounding the anytime engine's search (see ai_water_sort_pdb)\n"
+        << "  --endgame      Endgame database ending the BFS, compact and pipelined engines' search early (see ai_water_sort_endgame)\n"
+        << "  --relabel-colors  Renumber the colors by first appearance and let BFS skip states that only differ in\n"
+        << "                 the naming of their colors\n"
+        << "  --checkpoint   Periodically save the compact engine's search to a directory, to be continued with --resume\n"
+        << "  --checkpoint-interval  Minimum time between two checkpoints in milliseconds (default 60000)\n"
+        << "  --resume       Continue the search from the checkpoint of the --checkpoint directory, if any\n"
+        << "  --expanders    Expansion threads of the pipelined engine (default: half of the cores)\n"
+        << "  --partitions   Deduplication threads of the pipelined engine, each owning a part of the visited states\n"
+        << "                 (default: the other cores)\n"
+        << "  --portfolio    Engines raced by the portfolio engine, comma-separated (default bfs,compact,anytime)\n"
+        << "  --accept-any   Let the portfolio keep the first solution, not only the first proven optimal one\n"
+        << "  --portfolio-deadline  Time after which every engine of the portfolio is cancelled, in milliseconds\n"
+        << "  --expected-nodes  States the approx engine's filter is sized for (default 10000000)\n"
+        << "  --fp-rate      Target false positive probability of the approx engine's filter (default 0.0001)\n"
+        << "  --progress     Interval of the BFS progress lines in milliseconds, 0 to disable (default 1000)\n"
+        << "  --stats        Write per-layer counters and per-phase times of the BFS engine to a JSON file\n"
+        << "  --trace        Write the same instrumentation as a Chrome trace event file\n"
+        << "  --trace-alloc  Trace every memory pool operation to binary files PREFIX.<pool>.wsat\n";
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    SolutionCache cache;
+    PatternDatabase database;
+    EndgameDatabase endgame;
+
+    std::vector<std::vector<Bottle>> puzzles;
+    std::string error;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "--engine") && i + 1 < argc)
+        {
+            ++i;
 
+            if (!parseEngine(argv[i], options.solver.engine))
+            {
+                printUsage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        }
+        else if (!strcmp(argv[i], "--bottles") && i + 1 < argc) {
+            options.bottles = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--input") && i + 1 < argc)
+        {
+            ++i;
 
-            cmd::removeCursor();
+            if (CorpusReader::isCorpus(argv[i]))
+            {
+                CorpusReader corpus;
 
-            while (!s_finished) 
+                if (!corpus.open(argv[i], error) || corpus.size() == 0
+                    || !checkPuzzle(corpus.bottlesAt(0), corpus.bottles(), error))
+                {
+                    std::cerr << "Could not read a puzzle from \"" << argv[i] << "\""
+                        << (error.empty() ? "" : ": " + error) << std::endl;
+                    return EXIT_FAILURE;
+                }
+                options.input.assign(corpus.bottlesAt(0), corpus.bottlesAt(0) + corpus.bottles());
+            }
+            else
             {
-                for (q = 0; q < cmd::loading_bar.size() && !s_finished; ++q)
+                std::ifstream ifs(argv[i]);
+
+                if (!ifs.is_open() || !readPuzzles(ifs, puzzles, error) || puzzles.empty())
                 {
-                    std::cout << gap << cmd::loading_bar[q];
-                    std::this_thread::sleep_for(ms);
-                    std::cout << '\r';
+                    std::cerr << "Could not read a puzzle from \"" << argv[i] << "\""
+                        << (error.empty() ? "" : ": " + error) << std::endl;
+                    return EXIT_FAILURE;
                 }
+                options.input = puzzles.front();
             }
-            std::cout << std::string(gap.size() + cmd::loading_bar[0].size(), ' ') << std::endl;
+            options.bottles = options.input.size();
         }
-    );
-#else
-    std::cout << "Calculating solution ..." << std::endl;
-#endif
+        else if (!strcmp(argv[i], "--cache") && i + 1 < argc) {
+            options.cachePath = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--cache-size") && i + 1 < argc) {
+            options.cacheBytes = std::strtoull(argv[++i], nullptr, 10) * 1024 * 1024;
+        }
+        else if (!strcmp(argv[i], "--generate") && i + 1 < argc) {
+            options.corpusOutput = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--count") && i + 1 < argc) {
+            options.corpusCount = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+            options.seed = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (!strcmp(argv[i], "--batch") && i + 1 < argc) {
+            options.batchInput = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--hints") && i + 1 < argc) {
+            options.hintInput = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--hint-radius") && i + 1 < argc) {
+            options.hints.radius = static_cast<int>(std::strtol(argv[++i], nullptr, 10));
+        }
+        else if (!strcmp(argv[i], "--hint-max-states") && i + 1 < argc) {
+            options.hints.maxStates = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--census") && i + 1 < argc) {
+            options.censusInput = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--census-max-states") && i + 1 < argc) {
+            options.censusMaxStates = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+            options.threads = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--output") && i + 1 < argc) {
+            options.batchOutput = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--beam-width") && i + 1 < argc) {
+            options.solver.anytime.beamWidth = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--deadline") && i + 1 < argc) {
+            options.solver.anytime.deadlineMs = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--pdb") && i + 1 < argc) {
+            options.databasePath = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--endgame") && i + 1 < argc) {
+            options.endgamePath = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--serve") && i + 1 < argc) {
+            options.serverSocket = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--queue") && i + 1 < argc) {
+            options.queueLimit = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--checkpoint") && i + 1 < argc) {
+            options.checkpoint.directory = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--checkpoint-interval") && i + 1 < argc) {
+            options.checkpoint.intervalMs = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--resume")) {
+            options.checkpoint.resume = true;
+        }
+        else if (!strcmp(argv[i], "--relabel-colors")) {
+            options.solver.relabelColors = true;
+        }
+        else if (!strcmp(argv[i], "--portfolio") && i + 1 < argc)
+        {
+            std::istringstream names(argv[++i]);
+            std::string name;
 
+            Engine engine;
 
-    // Initialization of state's bottles with N - 2 random colors (4mL each), in a random sequence.
-    start.init();
+            options.solver.portfolio.engines.clear();
 
-    t0 = READ_TIME();
-    
-    solution = BFS(start, examined, memory);
+            while (std::getline(names, name, ','))
+            {
+                if (!parseEngine(name.c_str(), engine) || engine == Engine::PORTFOLIO)
+                {
+                    printUsage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                options.solver.portfolio.engines.push_back(engine);
+            }
+        }
+        else if (!strcmp(argv[i], "--accept-any")) {
+            options.solver.portfolio.optimal = false;
+        }
+        else if (!strcmp(argv[i], "--portfolio-deadline") && i + 1 < argc) {
+            options.solver.portfolio.deadlineMs = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--expanders") && i + 1 < argc) {
+            options.solver.pipeline.expanders = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--partitions") && i + 1 < argc) {
+            options.solver.pipeline.partitions = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--expected-nodes") && i + 1 < argc) {
+            options.solver.approximate.expectedNodes = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--fp-rate") && i + 1 < argc) {
+            options.solver.approximate.falsePositiveRate = std::strtod(argv[++i], nullptr);
+        }
+        else if (!strcmp(argv[i], "--progress") && i + 1 < argc) {
+            options.progressMs = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--stats") && i + 1 < argc) {
+            options.statsOutput = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--trace") && i + 1 < argc) {
+            options.traceOutput = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--trace-alloc") && i + 1 < argc) {
+            options.allocationTrace = argv[++i];
+        }
+        else
+        {
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
 
-    t1 = READ_TIME();
+    // Before any pool is constructed.
+    if (!options.allocationTrace.empty()) {
+        MemoryPool::enableTracing(options.allocationTrace);
+    }
 
-    duration = MS_DIFF(t0, t1);
+    if (!options.cachePath.empty())
+    {
+        if (!cache.open(options.cachePath, options.cacheBytes, error))
+        {
+            std::cerr << "Could not open solution cache: " << error << std::endl;
+            return EXIT_FAILURE;
+        }
+        options.solver.cache = &cache;
+    }
 
+    if (!options.databasePath.empty())
+    {
+        if (!database.open(options.databasePath, error))
+        {
+            std::cerr << "Could not open pattern database: " << error << std::endl;
+            return EXIT_FAILURE;
+        }
+        options.solver.anytime.database = &database;
+    }
 
-    if (solution != nullptr)
+    if (!options.endgamePath.empty())
     {
-        out << "METRICS FOR " << BOTTLES_N << " BOTTLES:\n"
-            << "-> Depth:          \t" << solution->getDepth() << '\n'
-            << "-> Total Nodes:    \t" << memory << '\n'
-            << "-> Examined Nodes: \t" << examined << '\n'
-            << "-> Elapsed Time:   \t" << clockFormat(duration)
-            << "\n\n" << std::endl;
+        if (!endgame.open(options.endgamePath, error))
+        {
+            std::cerr << "Could not open endgame database: " << error << std::endl;
+            return EXIT_FAILURE;
+        }
+        options.solver.endgame = &endgame;
     }
-    else
+
+    if (!options.checkpoint.directory.empty() && (options.solver.engine != Engine::COMPACT || !options.batchInput.empty() || !options.serverSocket.empty()))
     {
-        /*  The given problem is not actually unsolvable. If BFS() returns null, then that means
-         *  there were collisions of hash values, such that paths to all victorious nodes were blocked.
-         *  This scenario is very unlikely, but possible.
-         */
-        out << "Problem unsolvable" << std::endl;
+        std::cerr << "Checkpoints are only supported by the compact engine, for a single puzzle." << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (options.checkpoint.resume && options.checkpoint.directory.empty())
+    {
+        std::cerr << "--resume requires a --checkpoint directory." << std::endl;
+        return EXIT_FAILURE;
     }
 
-    // Path between start node and goal node.
-    std::vector<State<BOTTLES_N>*> path;
+    if (!options.batchInput.empty()) {
+        return runBatchMode(options);
+    }
 
-    for (State<BOTTLES_N>* s = solution; s != nullptr; s = s->getPrevious()) {
-        path.push_back(s);
+    if (!options.serverSocket.empty()) {
+        return runServerMode(options);
     }
 
-    // Logging of solution (visually + transitions) from start to finish.
-    for (int i = (int)path.size() - 1; i >= 0; --i) {
-        out << path[i]->toString() << "\n\n"
-            << std::setw(2) << std::setfill(' ') << path.size() - i 
-            << ". " << path[i]->getActionName() << "\n\n" << std::endl;
+    if (!options.hintInput.empty()) {
+        return runHintMode(options);
     }
 
-    if (ofs.is_open()) 
-    {
-        std::cout << "\n\nSolution generated at \"results.txt\" within the current working directory" << std::endl;
-        ofs.close();
+    if (!options.censusInput.empty()) {
+        return runCensusMode(options);
     }
 
-    s_finished = true;
+    if (options.bottles < MIN_BOTTLES || options.bottles > MAX_BOTTLES)
+    {
+        std::cerr << "Number of bottles must be within [" << MIN_BOTTLES << ", " << MAX_BOTTLES << "]." << std::endl;
+        return EXIT_FAILURE;
+    }
 
-#if defined(_MSC_VER)
-    loadingAnimation.join();
-#endif
+    if (!options.corpusOutput.empty()) {
+        return dispatchBottles<GenerateCorpus>(options.bottles, EXIT_FAILURE, options);
+    }
 
-    return EXIT_SUCCESS;
+    return dispatchBottles<Solve>(options.bottles, EXIT_FAILURE, options);
 }
@@ -0,0 +1,211 @@
+#include "watersort.h"
+
+#include <new>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstring>
+
+#include "Puzzle.h"
+#include "Solver.h"
+#include "HintOracle.h"
+#include "dispatch.h"
+
+
+static_assert(WS_BOTTLE_BYTES == BOTTLE_SIZE && WS_CAPACITY == NUM_OF_COLORS && WS_COLOR_BITS == COLOR_BITS,
+    "packed bottles must match Bottle's layout");
+static_assert(WS_MIN_BOTTLES == MIN_BOTTLES && WS_MAX_BOTTLES == MAX_BOTTLES, "supported numbers of bottles must match dispatch.h");
+static_assert(WS_MAX_COLOR == TOTAL_COLORS, "color codes must match colors.h");
+
+void ws_default_options(ws_options* options)
+{
+    const SolverOptions defaults;
+
+    if (options == nullptr) {
+        return;
+    }
+    options->engine = WS_ENGINE_BFS;
+    options->beam_width = defaults.anytime.beamWidth;
+    options->deadline_ms = defaults.anytime.deadlineMs;
+    options->expected_nodes = defaults.approximate.expectedNodes;
+    options->fp_rate = defaults.approximate.falsePositiveRate;
+    options->relabel_colors = 0;
+}
+
+int ws_solve(const uint8_t* bottles, size_t num_bottles, const ws_options* options,
+    ws_move* moves, size_t max_moves, size_t* num_moves, ws_stats* stats)
+{
+    static const Engine ENGINES[] = { Engine::BFS, Engine::ANYTIME, Engine::APPROXIMATE, Engine::COMPACT, Engine::DENSE, Engine::PIPELINED, Engine::PORTFOLIO };
+
+    ws_options defaults;
+
+    SolverOptions solver;
+    SolveResult result;
+
+    std::vector<Bottle> puzzle;
+    std::string error;
+
+    size_t i;
+
+    if (options == nullptr)
+    {
+        ws_default_options(&defaults);
+        options = &defaults;
+    }
+    if (bottles == nullptr || num_bottles < MIN_BOTTLES || num_bottles > MAX_BOTTLES || (moves == nullptr && max_moves > 0)
+        || options->engine < 0 || options->engine >= static_cast<int>(sizeof(ENGINES) / sizeof(ENGINES[0])))
+    {
+        return WS_INVALID_ARGUMENT;
+    }
+
+    try
+    {
+        // Bottles are validated before being used: Bottle's constructor would exit on floating liquid.
+        puzzle.resize(num_bottles);
+        memcpy(puzzle.data(), bottles, num_bottles * BOTTLE_SIZE);
+
+        if (!checkPuzzle(puzzle.data(), num_bottles, error)) {
+            return WS_INVALID_PUZZLE;
+        }
+        solver.engine = ENGINES[options->engine];
+        solver.anytime.beamWidth = static_cast<size_t>(options->beam_width > 0 ? options->beam_width : 1);
+        solver.anytime.deadlineMs = options->deadline_ms;
+        solver.approximate.expectedNodes = options->expected_nodes;
+        solver.approximate.falsePositiveRate = options->fp_rate;
+        solver.relabelColors = (options->relabel_colors != 0);
+
+        solvePuzzle(puzzle.data(), num_bottles, solver, result);
+    }
+    catch (const std::bad_alloc&) {
+        return WS_OUT_OF_MEMORY;
+    }
+    catch (...) {
+        return WS_INTERNAL_ERROR;
+    }
+
+    if (stats != nullptr)
+    {
+        stats->optimal = (result.solved && result.optimal);
+        stats->depth = result.moves.size();
+        stats->examined = result.examined;
+        stats->peak_nodes = result.memory;
+        stats->peak_bytes = result.peakBytes;
+        stats->elapsed_ms = result.elapsedMs;
+    }
+    if (num_moves != nullptr) {
+        *num_moves = result.moves.size();
+    }
+    if (!result.solved) {
+        return WS_UNSOLVED;
+    }
+    for (i = 0; i < result.moves.size() && i < max_moves; ++i)
+    {
+        moves[i].from = static_cast<uint8_t>(result.moves[i].first);
+        moves[i].to = static_cast<uint8_t>(result.moves[i].second);
+    }
+    return (result.moves.size() <= max_moves ? WS_OK : WS_BUFFER_TOO_SMALL);
+}
+
+struct ws_hinter
+{
+    std::unique_ptr<Hinter> oracle;
+    size_t bottles;
+};
+
+ws_hinter* ws_hinter_create(size_t num_bottles, uint64_t max_states)
+{
+    HintOptions options;
+
+    if (max_states > 0) {
+        options.maxStates = max_states;
+    }
+    try
+    {
+        std::unique_ptr<ws_hinter> hinter(new ws_hinter{ makeHinter(num_bottles, options), num_bottles });
+
+        return (hinter->oracle != nullptr ? hinter.release() : nullptr);
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+int ws_hint(ws_hinter* hinter, const uint8_t* bottles, ws_move* move, size_t* distance)
+{
+    std::vector<Bottle> position;
+    std::string error;
+
+    HintResult hint;
+
+    if (hinter == nullptr || bottles == nullptr) {
+        return WS_INVALID_ARGUMENT;
+    }
+
+    try
+    {
+        position.resize(hinter->bottles);
+        memcpy(position.data(), bottles, hinter->bottles * BOTTLE_SIZE);
+
+        if (!checkPuzzle(position.data(), hinter->bottles, error)) {
+            return WS_INVALID_PUZZLE;
+        }
+        if (!hinter->oracle->hint(position.data(), hint)) {
+            return WS_UNSOLVED;
+        }
+    }
+    catch (const std::bad_alloc&) {
+        return WS_OUT_OF_MEMORY;
+    }
+    catch (...) {
+        return WS_INTERNAL_ERROR;
+    }
+
+    if (move != nullptr)
+    {
+        move->from = static_cast<uint8_t>(hint.from + 1);
+        move->to = static_cast<uint8_t>(hint.to + 1);
+    }
+    if (distance != nullptr) {
+        *distance = static_cast<size_t>(hint.distance);
+    }
+    return WS_OK;
+}
+
+void ws_hinter_destroy(ws_hinter* hinter)
+{
+    delete hinter;
+}
+
+const char* ws_status_string(int status)
+{
+    switch (status)
+    {
+        case WS_OK:                 return "solved";
+        case WS_UNSOLVED:           return "no solution found";
+        case WS_INVALID_ARGUMENT:   return "invalid argument";
+        case WS_INVALID_PUZZLE:     return "invalid puzzle";
+        case WS_BUFFER_TOO_SMALL:   return "move buffer too small";
+        case WS_OUT_OF_MEMORY:      return "out of memory";
+        case WS_INTERNAL_ERROR:     return "internal error";
+        case WS_LAYOUT_MISMATCH:    return "library built for another layout";
+        default:                    return "unknown status";
+    }
+}
+
+int ws_api_version(void)
+{
+    return WS_API_VERSION;
+}
+
+void ws_layout(int* capacity, int* color_bits, int* max_bottles)
+{
+    if (capacity != nullptr) {
+        *capacity = WS_CAPACITY;
+    }
+    if (color_bits != nullptr) {
+        *color_bits = WS_COLOR_BITS;
+    }
+    if (max_bottles != nullptr) {
+        *max_bottles = WS_MAX_BOTTLES;
+    }
+}
@@ -0,0 +1,180 @@
+/*
+ *  C API smoke test (capi_test):
+ *
+ *      Plain C client of the shared library (see: watersort.h). Checks the
+ *      library's layout against the header's, solves a seeded puzzle and
+ *      replays the solution's pours, checks the statuses of a short move
+ *      buffer and of invalid arguments and puzzles, and asks the hint
+ *      oracle for the same puzzle's distance.
+ *      Exits with a non-zero status on the first failure.
+ *
+ *  Usage:
+ *      capi_test
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "watersort.h"
+
+#define TEST_BOTTLES    5
+#define TEST_COLORS     (WS_MAX_COLOR < 3 ? WS_MAX_COLOR : 3)
+#define TEST_MOVES      256
+
+
+static int fail(const char* what, int status)
+{
+    fprintf(stderr, "%s: %s\n", what, ws_status_string(status));
+    return 1;
+}
+
+/* Packs layers (top first) as described in watersort.h. */
+static void pack(const int* layers, uint8_t* bottle)
+{
+    int i, b, bit;
+
+    memset(bottle, 0, WS_BOTTLE_BYTES);
+
+    for (i = 0; i < WS_CAPACITY; ++i)
+    {
+        for (b = 0; b < WS_COLOR_BITS; ++b)
+        {
+            bit = i * WS_COLOR_BITS + b;
+
+            if (layers[i] & (1 << (WS_COLOR_BITS - 1 - b))) {
+                bottle[bit / 8] |= (uint8_t)(0x80 >> (bit % 8));
+            }
+        }
+    }
+}
+
+/* Seeded shuffle of TEST_COLORS full colors into the first bottles, the others left empty. */
+static void makePuzzle(int layers[TEST_BOTTLES][WS_CAPACITY], uint8_t* bottles)
+{
+    int liquid[TEST_COLORS * WS_CAPACITY];
+    uint32_t seed = 20240601u;
+    int i, j, t;
+
+    for (i = 0; i < TEST_COLORS * WS_CAPACITY; ++i) {
+        liquid[i] = 1 + i / WS_CAPACITY;
+    }
+    for (i = TEST_COLORS * WS_CAPACITY - 1; i > 0; --i)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        j = (int)((seed >> 8) % (uint32_t)(i + 1));
+        t = liquid[i];
+        liquid[i] = liquid[j];
+        liquid[j] = t;
+    }
+    for (i = 0; i < TEST_BOTTLES; ++i)
+    {
+        for (j = 0; j < WS_CAPACITY; ++j) {
+            layers[i][j] = (i < TEST_COLORS ? liquid[i * WS_CAPACITY + j] : 0);
+        }
+        pack(layers[i], bottles + i * WS_BOTTLE_BYTES);
+    }
+}
+
+/* Replays the pours on unpacked layers; returns 1 if each is legal and the puzzle ends sorted. */
+static int replay(int layers[TEST_BOTTLES][WS_CAPACITY], const ws_move* moves, size_t count)
+{
+    int level[TEST_BOTTLES];
+    int i, j, from, to;
+    size_t m;
+
+    for (i = 0; i < TEST_BOTTLES; ++i)
+    {
+        for (level[i] = 0; level[i] < WS_CAPACITY && layers[i][WS_CAPACITY - 1 - level[i]] != 0; ++level[i]) {}
+    }
+    for (m = 0; m < count; ++m)
+    {
+        from = moves[m].from - 1;
+        to = moves[m].to - 1;
+
+        if (from < 0 || from >= TEST_BOTTLES || to < 0 || to >= TEST_BOTTLES || from == to || level[from] == 0
+            || level[to] == WS_CAPACITY
+            || (level[to] > 0 && layers[to][WS_CAPACITY - level[to]] != layers[from][WS_CAPACITY - level[from]]))
+        {
+            return 0;
+        }
+        do
+        {
+            layers[to][WS_CAPACITY - 1 - level[to]] = layers[from][WS_CAPACITY - level[from]];
+            layers[from][WS_CAPACITY - level[from]] = 0;
+            level[to] += 1;
+            level[from] -= 1;
+        }
+        while (level[from] > 0 && level[to] < WS_CAPACITY
+            && layers[from][WS_CAPACITY - level[from]] == layers[to][WS_CAPACITY - level[to]]);
+    }
+    for (i = 0; i < TEST_BOTTLES; ++i)
+    {
+        for (j = 1; j < WS_CAPACITY; ++j) {
+            if (layers[i][j] != layers[i][0]) return 0;
+        }
+    }
+    return 1;
+}
+
+int main(void)
+{
+    int layers[TEST_BOTTLES][WS_CAPACITY];
+    int floating[WS_CAPACITY] = { 1 };
+
+    uint8_t bottles[TEST_BOTTLES * WS_BOTTLE_BYTES];
+    uint8_t invalid[TEST_BOTTLES * WS_BOTTLE_BYTES];
+
+    ws_move moves[TEST_MOVES];
+    ws_move hint;
+    ws_stats stats;
+    ws_options options;
+    ws_hinter* hinter;
+
+    size_t count = 0;
+    size_t short_count = 0;
+    size_t distance = 0;
+    int status;
+
+    if ((status = ws_check_layout()) != WS_OK) {
+        return fail("ws_check_layout", status);
+    }
+
+    makePuzzle(layers, bottles);
+    ws_default_options(&options);
+
+    if ((status = ws_solve(bottles, TEST_BOTTLES, &options, moves, TEST_MOVES, &count, &stats)) != WS_OK) {
+        return fail("ws_solve", status);
+    }
+    if (!stats.optimal || stats.depth != count || count == 0 || !replay(layers, moves, count)) {
+        return fail("ws_solve returned an invalid solution", WS_INTERNAL_ERROR);
+    }
+
+    if ((status = ws_solve(bottles, TEST_BOTTLES, NULL, moves, 1, &short_count, NULL)) != WS_BUFFER_TOO_SMALL
+        || short_count != count)
+    {
+        return fail("ws_solve with a short move buffer", status);
+    }
+    if ((status = ws_solve(bottles, WS_MIN_BOTTLES - 1, NULL, moves, TEST_MOVES, NULL, NULL)) != WS_INVALID_ARGUMENT) {
+        return fail("ws_solve with too few bottles", status);
+    }
+
+    memcpy(invalid, bottles, sizeof(bottles));
+    pack(floating, invalid + (TEST_BOTTLES - 1) * WS_BOTTLE_BYTES);
+
+    if ((status = ws_solve(invalid, TEST_BOTTLES, NULL, moves, TEST_MOVES, NULL, NULL)) != WS_INVALID_PUZZLE) {
+        return fail("ws_solve with floating liquid", status);
+    }
+
+    if ((hinter = ws_hinter_create(TEST_BOTTLES, 0)) == NULL) {
+        return fail("ws_hinter_create", WS_OUT_OF_MEMORY);
+    }
+    status = ws_hint(hinter, bottles, &hint, &distance);
+    ws_hinter_destroy(hinter);
+
+    if (status != WS_OK || distance != count || hint.from == 0 || hint.to == 0) {
+        return fail("ws_hint", status);
+    }
+
+    printf("solved %d bottles in %u moves, hint %d -> %d\n", TEST_BOTTLES, (unsigned)count, hint.from, hint.to);
+    return 0;
+}
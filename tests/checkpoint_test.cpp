@@ -0,0 +1,133 @@
+/*
+ *  Checkpoint write and resume (checkpoint_test):
+ *
+ *      Solves a seeded puzzle with compactBFS() three times: without
+ *      checkpoints, then checkpointing every layer to DIRECTORY, then
+ *      resuming from the last checkpoint written (see: Checkpoint.h). The
+ *      checkpoint must be readable and match the report, and the resumed
+ *      search must find a valid solution of the same length. A checkpoint
+ *      must not be resumed for another puzzle.
+ *      Exits with a non-zero status on the first failure.
+ *
+ *  Usage:
+ *      checkpoint_test DIRECTORY
+ */
+
+#include <random>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <iostream>
+
+#include "State.h"
+#include "Solver.h"
+#include "CompactBFS.h"
+#include "Checkpoint.h"
+
+constexpr unsigned int TEST_SEED = 20240601;
+constexpr size_t TEST_BOTTLES = 7;
+
+
+static bool fail(const std::string& message)
+{
+    std::cerr << message << std::endl;
+    return false;
+}
+
+template <size_t size>
+static bool checkpointAndResume(const std::string& directory)
+{
+    std::mt19937 generator(TEST_SEED);
+    State<size> start;
+    State<size> other;
+
+    State<size>* solution;
+    int depth;
+
+    CheckpointOptions options;
+    CheckpointReport written;
+    CheckpointReport resumed;
+    CheckpointReport rejected;
+
+    CheckpointHeader header;
+    std::vector<uint8_t> puzzle;
+    std::vector<uint8_t> data;
+    std::vector<std::pair<int, int>> moves;
+    std::string error;
+
+    uint64_t examined;
+    uint64_t memory;
+    uint64_t peakBytes;
+
+    // Seeded puzzles may be unsolvable: the first solvable one is used.
+    do {
+        start.init(generator);
+    } while ((solution = compactBFS<size>(start, examined, memory, peakBytes)) == nullptr);
+
+    depth = solution->getDepth();
+    State<size>::deleteWholePath(solution);
+
+    other.init(generator);
+
+    std::remove(checkpointPath(directory).c_str());
+
+    options.directory = directory;
+    options.intervalMs = 0;
+
+    solution = compactBFS<size>(start, examined, memory, peakBytes, nullptr, &options, &written);
+
+    if (solution == nullptr || solution->getDepth() != depth) {
+        return fail("The checkpointed search did not find a solution of " + std::to_string(depth) + " moves");
+    }
+    State<size>::deleteWholePath(solution);
+
+    if (written.written == 0 || !written.error.empty()) {
+        return fail("No checkpoint was written: " + written.error);
+    }
+    if (!readCheckpoint(directory, header, puzzle, data, error)) {
+        return fail("The checkpoint cannot be read: " + error);
+    }
+    if (header.bottles != size || header.depth != written.lastDepth || header.count == 0) {
+        return fail("The checkpoint does not match the search's report");
+    }
+
+    options.resume = true;
+
+    solution = compactBFS<size>(start, examined, memory, peakBytes, nullptr, &options, &resumed);
+
+    if (resumed.resumedDepth != written.lastDepth) {
+        return fail("The search did not resume from depth " + std::to_string(written.lastDepth) + ": " + resumed.error);
+    }
+    if (solution == nullptr || solution->getDepth() != depth) {
+        return fail("The resumed search did not find a solution of " + std::to_string(depth) + " moves");
+    }
+    solution->getMoves(moves);
+    State<size>::deleteWholePath(solution);
+
+    if (!verifyMoves(start.getBottles(), size, moves)) {
+        return fail("The resumed search's solution does not solve the puzzle");
+    }
+
+    solution = compactBFS<size>(other, examined, memory, peakBytes, nullptr, &options, &rejected);
+
+    if (solution != nullptr || rejected.error.empty())
+    {
+        State<size>::deleteWholePath(solution);
+        return fail("A checkpoint was resumed for another puzzle");
+    }
+
+    std::cout << written.written << " checkpoint(s) written, resumed from depth " << resumed.resumedDepth
+        << " of " << depth << std::endl;
+
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc != 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " DIRECTORY" << std::endl;
+        return 2;
+    }
+    return (checkpointAndResume<TEST_BOTTLES>(argv[1]) ? 0 : 1);
+}
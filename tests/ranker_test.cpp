@@ -0,0 +1,151 @@
+/*
+ *  StateRanker round trip (ranker_test):
+ *
+ *      For every number of bottles from MIN_BOTTLES to 5, takes the liquid
+ *      of a seeded puzzle and unranks every rank in [0, states()), or a
+ *      seeded sample of RANKER_SAMPLE ranks if there are more than
+ *      RANKER_EXHAUSTIVE of them (larger bottle layouts): each state must
+ *      be valid (no floating liquid, see: checkPuzzle()), hold the puzzle's
+ *      liquid, and rank back to the same integer. The states reachable from
+ *      the puzzle (up to RANKER_SAMPLE of them) must then unrank back to
+ *      themselves. Exits with a non-zero status on the first mismatch.
+ *
+ *  Usage:
+ *      ranker_test
+ */
+
+#include <random>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+#include <unordered_set>
+
+#include "State.h"
+#include "Puzzle.h"
+#include "StateRanker.h"
+#include "dispatch.h"
+
+constexpr unsigned int TEST_SEED = 20240601;
+constexpr uint64_t RANKER_EXHAUSTIVE = static_cast<uint64_t>(1) << 24;
+constexpr uint64_t RANKER_SAMPLE = static_cast<uint64_t>(1) << 20;
+
+
+template <size_t size>
+static void countColors(const Bottle* bottles, int counts[TOTAL_COLORS + 1])
+{
+    for (size_t c = 0; c <= TOTAL_COLORS; ++c) {
+        counts[c] = 0;
+    }
+    for (size_t b = 0; b < size; ++b)
+    {
+        for (size_t i = 0; i < NUM_OF_COLORS; ++i) {
+            counts[bottles[b].getColor(i)] += 1;
+        }
+    }
+}
+
+template <size_t size>
+static bool roundTrip()
+{
+    std::mt19937 generator(TEST_SEED + size);
+    State<size> start;
+
+    std::vector<State<size>*> queue;
+    std::vector<State<size>*> children;
+    std::unordered_set<State<size>*, std::hash<State<size>*>, EqualContents<State<size>>> seen;
+
+    Bottle bottles[size];
+    int liquid[TOTAL_COLORS + 1];
+    int counts[TOTAL_COLORS + 1];
+
+    std::string error;
+    bool ok = true;
+    bool exhaustive;
+
+    uint64_t checked;
+    uint64_t r;
+
+    start.init(generator);
+    countColors<size>(start.getBottles(), liquid);
+
+    StateRanker<size> ranker(start.getBottles());
+
+    if (!ranker.rankable())
+    {
+        std::cerr << size << " bottles: " << ranker.states() << " states cannot be ranked" << std::endl;
+        return false;
+    }
+
+    exhaustive = (ranker.states() <= RANKER_EXHAUSTIVE);
+
+    std::uniform_int_distribution<uint64_t> sample(0, ranker.states() - 1);
+
+    for (checked = 0; checked < (exhaustive ? ranker.states() : RANKER_SAMPLE) && ok; ++checked)
+    {
+        r = (exhaustive ? checked : sample(generator));
+
+        ranker.unrank(r, bottles);
+        countColors<size>(bottles, counts);
+
+        if (!checkPuzzle(bottles, size, error) || memcmp(counts, liquid, sizeof(liquid)) != 0)
+        {
+            std::cerr << size << " bottles: rank " << r << " unranks to an invalid state ("
+                << formatPuzzle(bottles, size) << ")" << std::endl;
+            ok = false;
+        }
+        else if (ranker.rank(bottles) != r)
+        {
+            std::cerr << size << " bottles: rank " << r << " ranks back to " << ranker.rank(bottles) << std::endl;
+            ok = false;
+        }
+    }
+
+    queue.push_back(new State<size>(start));
+    seen.insert(queue.back());
+
+    for (size_t head = 0; head < queue.size() && head < RANKER_SAMPLE && ok; ++head)
+    {
+        ranker.unrank(ranker.rank(queue[head]->getBottles()), bottles);
+
+        if (memcmp(bottles, queue[head]->getBottles(), sizeof(bottles)) != 0)
+        {
+            std::cerr << size << " bottles: " << formatPuzzle(queue[head]->getBottles(), size)
+                << " unranks to " << formatPuzzle(bottles, size) << std::endl;
+            ok = false;
+        }
+
+        queue[head]->expand(children);
+
+        for (State<size>* c : children)
+        {
+            if (seen.insert(c).second) {
+                queue.push_back(c);
+            }
+            else delete c;
+        }
+    }
+    for (State<size>* s : queue) {
+        delete s;
+    }
+
+    if (ok) {
+        std::cout << size << " bottles: " << checked << (exhaustive ? "" : " sampled") << " of " << ranker.states() << " ranks, "
+            << std::min<uint64_t>(queue.size(), RANKER_SAMPLE) << " reachable states" << std::endl;
+    }
+    return ok;
+}
+
+int main()
+{
+    static_assert(MIN_BOTTLES <= 5 && MAX_BOTTLES >= 5, "The round trip covers 3 to 5 bottles.");
+
+    bool ok = true;
+
+    ok = roundTrip<3>() && ok;
+    ok = roundTrip<4>() && ok;
+    ok = roundTrip<5>() && ok;
+
+    return (ok ? 0 : 1);
+}
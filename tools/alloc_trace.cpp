@@ -0,0 +1,212 @@
+/*
+ *  Allocation trace decoder (ai_water_sort_alloc_trace target):
+ *
+ *      Replays a MemoryPool trace (see: AllocationTrace.h) and reports:
+ *      ->  peak usage:      most units in use at once, and when.
+ *      ->  gap reuse:       share of allocations served from gaps left by
+ *                           releases, and how long gaps stayed empty.
+ *      ->  fragmentation:   share of the touched part of the pockets that is
+ *                           made of gaps, at the peak, at its worst while at
+ *                           least half the peak is in use, and at the end.
+ *      ->  occupancy:       units in use and touched per pocket, at the peak and at the end.
+ *
+ *      With --timeline K, usage and fragmentation are also printed at K
+ *      evenly spaced points in time.
+ *
+ *  Usage:
+ *      ai_water_sort_alloc_trace TRACE [--timeline K]
+ */
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <unordered_map>
+
+#include "AllocationTrace.h"
+
+
+struct PocketUsage
+{
+    uint64_t live = 0;          // Units in use.
+    uint64_t touched = 0;       // Units ever taken from the unused end of the pocket.
+};
+
+static double fragmentation(uint64_t live, uint64_t touched)
+{
+    return (touched > 0 ? 1.0 - static_cast<double>(live) / touched : 0.0);
+}
+
+static void printOccupancy(const std::vector<PocketUsage>& pockets, uint64_t capacity, size_t unitBytes)
+{
+    for (size_t p = 0; p < pockets.size(); ++p)
+    {
+        std::cout << "    pocket " << std::setw(3) << p << ": "
+            << std::setw(12) << pockets[p].live << " in use, "
+            << std::setw(12) << pockets[p].touched << " touched of " << capacity << " units ("
+            << std::fixed << std::setprecision(1) << 100.0 * pockets[p].live / capacity << "% occupied, "
+            << pockets[p].live * unitBytes / 1048576.0 << " MB)\n";
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    AllocationTraceReader trace;
+    std::string error;
+
+    std::vector<PocketUsage> pockets;
+    std::vector<PocketUsage> pocketsAtPeak;
+
+    std::unordered_map<uint64_t, uint64_t> releasedAt;     // Release time of every gap, by (pocket, offset).
+
+    size_t timeline = 0;
+    size_t nextPoint = 0;
+
+    uint64_t live = 0, touched = 0;
+    uint64_t peak = 0, peakTime = 0;
+    uint64_t allocations = 0, reuses = 0, releases = 0;
+    uint64_t gapLifetime = 0, maxGapLifetime = 0;
+    uint64_t endTime, capacity, finalPeak;
+
+    double worstFragmentation = 0;
+    double peakFragmentation = 0;
+
+    const char* path = nullptr;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "--timeline") && i + 1 < argc) {
+            timeline = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (path == nullptr && argv[i][0] != '-') {
+            path = argv[i];
+        }
+        else
+        {
+            path = nullptr;
+            break;
+        }
+    }
+    if (path == nullptr)
+    {
+        std::cerr << "Usage: " << argv[0] << " TRACE [--timeline K]\n";
+        return EXIT_FAILURE;
+    }
+    if (!trace.open(path, error))
+    {
+        std::cerr << "Could not read \"" << path << "\": " << error << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // First pass: peak usage, which qualifies the fragmentation figures of the second one.
+    for (size_t i = 0; i < trace.size(); ++i)
+    {
+        TraceEvent e = trace.eventAt(i);
+
+        if (e.op == TRACE_ALLOCATE || e.op == TRACE_REUSE) {
+            peak = std::max(peak, ++live);
+        }
+        else if (e.op == TRACE_RELEASE) {
+            live -= 1;
+        }
+    }
+    finalPeak = peak;
+    live = 0;
+    peak = 0;
+
+    capacity = trace.pocketBytes() / trace.unitBytes();
+    endTime = (trace.size() > 0 ? trace.eventAt(trace.size() - 1).time : 0);
+
+    if (timeline > 0) {
+        std::cout << "> Timeline:\n" << "    time_ms,bytes_in_use,fragmentation\n";
+    }
+
+    for (size_t i = 0; i < trace.size(); ++i)
+    {
+        TraceEvent e = trace.eventAt(i);
+        uint64_t key = (static_cast<uint64_t>(e.pocket) << 32) | e.offset;
+
+        if (e.pocket >= pockets.size()) {
+            pockets.resize(e.pocket + 1);
+        }
+        switch (e.op)
+        {
+        case TRACE_ALLOCATE:
+            allocations += 1;
+            live += 1;
+            touched += 1;
+            pockets[e.pocket].live += 1;
+            pockets[e.pocket].touched += 1;
+            break;
+
+        case TRACE_REUSE:
+            allocations += 1;
+            reuses += 1;
+            live += 1;
+            pockets[e.pocket].live += 1;
+
+            if (releasedAt.count(key))
+            {
+                gapLifetime += e.time - releasedAt[key];
+                maxGapLifetime = std::max(maxGapLifetime, e.time - releasedAt[key]);
+                releasedAt.erase(key);
+            }
+            break;
+
+        case TRACE_RELEASE:
+            releases += 1;
+            live -= 1;
+            pockets[e.pocket].live -= 1;
+            releasedAt[key] = e.time;
+            break;
+
+        default:
+            break;
+        }
+
+        if (live > peak)
+        {
+            peak = live;
+            peakTime = e.time;
+            peakFragmentation = fragmentation(live, touched);
+            pocketsAtPeak = pockets;
+        }
+        // Only while the pool is busy: a search releasing everything at its end is not fragmented.
+        if (2 * live >= finalPeak) {
+            worstFragmentation = std::max(worstFragmentation, fragmentation(live, touched));
+        }
+
+        while (timeline > 0 && nextPoint < timeline && e.time >= endTime * nextPoint / timeline)
+        {
+            std::cout << "    " << std::fixed << std::setprecision(3) << e.time / 1e6 << ','
+                << live * trace.unitBytes() << ',' << std::setprecision(4) << fragmentation(live, touched) << '\n';
+            nextPoint += 1;
+        }
+    }
+
+    std::cout << std::fixed
+        << "> Trace:               " << path << '\n'
+        << "> Events:              " << trace.size() << " over " << std::setprecision(3) << endTime / 1e6 << " ms\n"
+        << "> Unit / pocket size:  " << trace.unitBytes() << " B / " << trace.pocketBytes() << " B (" << capacity << " units)\n"
+        << "> Pockets:             " << pockets.size() << '\n'
+        << "> Allocations:         " << allocations << " (" << releases << " released)\n"
+        << "> Peak usage:          " << peak << " units, " << std::setprecision(1) << peak * trace.unitBytes() / 1048576.0
+        << " MB at " << std::setprecision(3) << peakTime / 1e6 << " ms\n"
+        << "> Final usage:         " << live << " units, " << std::setprecision(1) << live * trace.unitBytes() / 1048576.0 << " MB\n"
+        << "> Gap reuse:           " << reuses << " of " << allocations << " allocations ("
+        << (allocations > 0 ? 100.0 * reuses / allocations : 0.0) << "%), " << releasedAt.size() << " gaps left\n"
+        << "> Gap lifetime:        " << std::setprecision(3) << (reuses > 0 ? gapLifetime / 1e6 / reuses : 0.0)
+        << " ms mean, " << maxGapLifetime / 1e6 << " ms max\n"
+        << "> Fragmentation:       " << std::setprecision(1) << 100 * peakFragmentation << "% at peak, "
+        << 100 * worstFragmentation << "% worst above half the peak, " << 100 * fragmentation(live, touched) << "% at the end\n"
+        << "> Occupancy at peak:\n";
+
+    printOccupancy(pocketsAtPeak, capacity, trace.unitBytes());
+
+    std::cout << "> Occupancy at the end:\n";
+
+    printOccupancy(pockets, capacity, trace.unitBytes());
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,75 @@
+/*
+ *  Endgame database builder (ai_water_sort_endgame target):
+ *
+ *      Generates, by retrograde analysis, the endgame database of puzzles
+ *      of N bottles and C colors up to R moves from the goal (see:
+ *      EndgameDatabase.h) and writes it to FILE, to be loaded by the solver
+ *      with --endgame FILE. Reports the number of states at every distance.
+ *
+ *  Usage:
+ *      ai_water_sort_endgame FILE --bottles N [--colors C] [--radius R]
+ */
+
+#include <string>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+#include "EndgameDatabase.h"
+
+
+int main(int argc, char* argv[])
+{
+    EndgameBuildOptions options;
+    EndgameBuildReport report;
+
+    std::string error;
+
+    const char* path = nullptr;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "--bottles") && i + 1 < argc) {
+            options.bottles = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--colors") && i + 1 < argc) {
+            options.colors = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--radius") && i + 1 < argc) {
+            options.radius = std::atoi(argv[++i]);
+        }
+        else if (path == nullptr && argv[i][0] != '-') {
+            path = argv[i];
+        }
+        else
+        {
+            path = nullptr;
+            break;
+        }
+    }
+    if (path == nullptr)
+    {
+        std::cerr << "Usage: " << argv[0] << " FILE --bottles N [--colors C] [--radius R]\n\n"
+            << "  --bottles   Number of bottles of the puzzles (default 8)\n"
+            << "  --colors    Number of colors of the puzzles (default: bottles - 2)\n"
+            << "  --radius    Largest distance to the goal stored (default 6)\n";
+        return EXIT_FAILURE;
+    }
+    if (!buildEndgameDatabase(path, options, report, error))
+    {
+        std::cerr << "Could not build the endgame database: " << error << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << std::fixed
+        << "> Database:            " << path << '\n'
+        << "> Records:             " << report.records << " (" << std::setprecision(1)
+        << report.records * (options.bottles * BOTTLE_SIZE + 1) / 1048576.0 << " MB)\n"
+        << "> Built in:            " << std::setprecision(3) << report.elapsedMs / 1000 << " s\n"
+        << "> States by distance:\n";
+
+    for (size_t d = 0; d < report.histogram.size(); ++d) {
+        std::cout << "    " << std::setw(3) << d << ": " << report.histogram[d] << '\n';
+    }
+    return EXIT_SUCCESS;
+}
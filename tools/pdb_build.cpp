@@ -0,0 +1,84 @@
+/*
+ *  Pattern database builder (ai_water_sort_pdb target):
+ *
+ *      Computes the pattern database of puzzles of N bottles and C colors
+ *      (see: PatternDatabase.h) on K threads and writes it to FILE, to be
+ *      loaded by the solver with --pdb FILE. Reports the number of entries,
+ *      the share reachable from a goal and the number of entries at every
+ *      distance.
+ *
+ *  Usage:
+ *      ai_water_sort_pdb FILE --bottles N [--colors C] [--pattern P] [--threads K]
+ */
+
+#include <string>
+#include <thread>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+#include "PatternDatabase.h"
+
+
+int main(int argc, char* argv[])
+{
+    PatternBuildOptions options;
+    PatternBuildReport report;
+
+    std::string error;
+
+    const char* path = nullptr;
+
+    options.threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "--bottles") && i + 1 < argc) {
+            options.bottles = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--colors") && i + 1 < argc) {
+            options.colors = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--pattern") && i + 1 < argc) {
+            options.pattern = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+            options.threads = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (path == nullptr && argv[i][0] != '-') {
+            path = argv[i];
+        }
+        else
+        {
+            path = nullptr;
+            break;
+        }
+    }
+    if (path == nullptr)
+    {
+        std::cerr << "Usage: " << argv[0] << " FILE --bottles N [--colors C] [--pattern P] [--threads K]\n\n"
+            << "  --bottles   Number of bottles of the puzzles (default 6)\n"
+            << "  --colors    Number of colors of the puzzles (default: bottles - 2)\n"
+            << "  --pattern   Number of colors kept apart by the abstraction (default 1)\n"
+            << "  --threads   Number of worker threads (default: number of cores)\n";
+        return EXIT_FAILURE;
+    }
+    if (!buildPatternDatabase(path, options, report, error))
+    {
+        std::cerr << "Could not build the pattern database: " << error << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << std::fixed
+        << "> Database:            " << path << '\n'
+        << "> Entries:             " << report.entries << " (" << std::setprecision(1) << report.entries / 1048576.0 << " MB)\n"
+        << "> Reachable:           " << report.reachable << " (" << 100.0 * report.reachable / report.entries << "%)\n"
+        << "> Largest distance:    " << report.histogram.size() - 1 << '\n'
+        << "> Built in:            " << std::setprecision(3) << report.elapsedMs / 1000 << " s\n"
+        << "> Entries by distance:\n";
+
+    for (size_t d = 0; d < report.histogram.size(); ++d) {
+        std::cout << "    " << std::setw(3) << d << ": " << report.histogram[d] << '\n';
+    }
+    return EXIT_SUCCESS;
+}